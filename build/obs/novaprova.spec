@@ -10,9 +10,9 @@ Source1: novaprova-manual-%{version}.tar.bz2
 @endif
 Url: http://www.novaprova.org/
 BuildRoot: /var/tmp/%{name}-root
-Requires: valgrind, binutils-devel
+Requires: valgrind
 BuildRequires: autoconf, automake, gcc-c++
-BuildRequires: valgrind-devel, binutils-devel, libxml2-devel, pkgconfig
+BuildRequires: valgrind-devel, libxml2-devel, pkgconfig
 BuildRequires: doxygen, perl-XML-LibXML
 Vendor: Greg Banks <gnb@fmeh.org>
 
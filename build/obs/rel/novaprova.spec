@@ -8,9 +8,9 @@ Source: http://sourceforge.net/projects/novaprova/files/novaprova-%{version}.tar
 Source1: novaprova-manual-%{version}.tar.bz2
 Url: http://www.novaprova.org/
 BuildRoot: /var/tmp/%{name}-root
-Requires: valgrind, binutils-devel
+Requires: valgrind
 BuildRequires: autoconf, automake, gcc-c++
-BuildRequires: valgrind-devel, binutils-devel, libxml2-devel, pkgconfig
+BuildRequires: valgrind-devel, libxml2-devel, pkgconfig
 BuildRequires: doxygen, perl-XML-LibXML
 Vendor: Greg Banks <gnb@fmeh.org>
 
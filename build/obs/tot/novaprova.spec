@@ -7,9 +7,9 @@ Group: Development/C
 Source: http://sourceforge.net/projects/novaprova/files/novaprova-%{version}.tar.gz
 Url: http://www.novaprova.org/
 BuildRoot: /var/tmp/%{name}-root
-Requires: valgrind, binutils-devel
+Requires: valgrind
 BuildRequires: autoconf, automake, gcc-c++
-BuildRequires: valgrind-devel, binutils-devel, libxml2-devel, pkgconfig
+BuildRequires: valgrind-devel, libxml2-devel, pkgconfig
 BuildRequires: doxygen, perl-XML-LibXML
 Vendor: Greg Banks <gnb@fmeh.org>
 
@@ -32,6 +32,6 @@ fi
 
 yum -y groupinstall 'Development Tools'
 yum -y install \
-    git valgrind-devel binutils-devel libxml2-devel \
+    git valgrind-devel libxml2-devel \
     doxygen perl-XML-LibXML strace python-pip
 pip install breathe Sphinx
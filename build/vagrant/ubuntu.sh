@@ -7,8 +7,7 @@ apt-get install -y \
     <% if @gcc_version %>gcc-<%= @gcc_version %><% end %> \
     <% if @gcc_version %>g++-<%= @gcc_version %><% end %> \
     git autoconf automake libxml2-dev libxml2-utils \
-    pkg-config valgrind binutils-dev doxygen \
-    zlib1g-dev libiberty-dev python-pip
+    pkg-config valgrind doxygen python-pip
 pip install breathe Sphinx
 <% if @gcc_version %>
 update-alternatives --install /usr/bin/gcc gcc /usr/bin/gcc-<%= @gcc_version %> \
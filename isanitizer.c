@@ -0,0 +1,146 @@
+/* isanitizer.c - turn sanitizer reports into test failures */
+/*
+ * Copyright 2011-2012 Gregory Banks
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "np_priv.h"
+#include "except.h"
+
+/*
+ * These are defined by the sanitizer runtimes when the test executable
+ * is built with -fsanitize=address, -fsanitize=leak or
+ * -fsanitize=undefined, and are null otherwise.
+ */
+extern "C" int __lsan_do_recoverable_leak_check(void) __attribute__((weak));
+extern "C" void __lsan_disable(void) __attribute__((weak));
+extern "C" void __lsan_enable(void) __attribute__((weak));
+extern "C" void __asan_set_error_report_callback(void (*)(const char *)) __attribute__((weak));
+extern "C" void __ubsan_get_current_report_data(const char **kind,
+                                                const char **message,
+                                                const char **filename,
+                                                unsigned *line,
+                                                unsigned *column,
+                                                char **address) __attribute__((weak));
+
+namespace np
+{
+    using namespace std;
+
+    /* Called by ASan with the whole text of a report, which has
+     * already gone to stderr, before it kills the process. */
+    static void asan_report(const char *report)
+    {
+        static char desc[256];
+
+        /* the interesting line reads "==pid==ERROR: AddressSanitizer: ..." */
+        const char *p = strstr(report, "ERROR: ");
+        p = (p ? p + 7 : report);
+        size_t len = strcspn(p, "\n");
+        if(len >= sizeof(desc))
+        {
+            len = sizeof(desc)-1;
+        }
+        memcpy(desc, p, len);
+        desc[len] = '\0';
+
+        np_raise(event_t(EV_SANITIZER, desc).with_stack());
+    }
+
+    bool is_running_under_sanitizer()
+    {
+        return (__lsan_do_recoverable_leak_check != 0);
+    }
+
+    void init_sanitizer_hooks()
+    {
+        if(__asan_set_error_report_callback)
+        {
+            __asan_set_error_report_callback(asan_report);
+        }
+    }
+
+    /* LeakSanitizer never reports memory allocated while ignoring */
+    void ignore_leaks(bool ignore)
+    {
+        if(!__lsan_disable)
+        {
+            return;
+        }
+        if(ignore)
+        {
+            __lsan_disable();
+        }
+        else
+        {
+            __lsan_enable();
+        }
+    }
+
+    /* Returns true if LeakSanitizer found any leaks */
+    bool sanitizer_leak_check()
+    {
+        if(!__lsan_do_recoverable_leak_check)
+        {
+            return false;
+        }
+        return !!__lsan_do_recoverable_leak_check();
+    }
+
+    // close the namespace
+};
+
+/*
+ * UBSan calls this after printing each report, and usually lets the
+ * process carry on afterwards.
+ */
+extern "C" void __ubsan_on_report(void)
+{
+    const char *kind = 0;
+    const char *message = 0;
+    const char *filename = 0;
+    unsigned line = 0;
+    unsigned column = 0;
+    char *address = 0;
+
+    if(!__ubsan_get_current_report_data || !np::runner_t::running())
+    {
+        return;
+    }
+    __ubsan_get_current_report_data(&kind, &message, &filename,
+                                    &line, &column, &address);
+
+    np::event_t ev(np::EV_SANITIZER, message ? message : kind);
+    if(filename && filename[0])
+    {
+        ev.at_line(filename, line);
+    }
+    np::runner_t::running()->raise_event(0, &ev.with_stack());
+}
+
+/*
+ * Leaks are checked after each test in the child process, so we don't
+ * want the sanitizers to check again when any process exits.  These
+ * are weak so that the test executable can provide its own.
+ */
+extern "C" const char *__asan_default_options(void) __attribute__((weak));
+extern "C" const char *__asan_default_options(void)
+{
+    return "leak_check_at_exit=0";
+}
+
+extern "C" const char *__lsan_default_options(void) __attribute__((weak));
+extern "C" const char *__lsan_default_options(void)
+{
+    return "leak_check_at_exit=0";
+}
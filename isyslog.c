@@ -251,6 +251,18 @@ namespace np
         }
     }
 
+    /* Forget the matches set up by a previous test run
+     * in the same process */
+    void reset_syslog_matches()
+    {
+        vector<slmatch_t *>::iterator i;
+        for(i = slmatches.begin() ; i != slmatches.end() ; ++i)
+        {
+            delete *i;
+        }
+        slmatches.clear();
+    }
+
     void init_syslog_intercepts(testnode_t *tn)
     {
         tn->add_mock((np::spiegel::addr_t)&syslog,
@@ -35,12 +35,24 @@ int main(int argc, char **argv)
     const char *output_formats = 0;
     enum { UNKNOWN, RUN, LIST } mode = UNKNOWN;
     int concurrency = -1;
+    bool prefork = false;
+    int batch_size = -1;
+    const char *history_file = 0;
+    int shard = 0, nshards = 0;
+    int fail_fast = 0;
+    long output_limit = -1;
     int c;
     static const struct option opts[] =
     {
         { "format", required_argument, NULL, 'f' },
         { "jobs", required_argument, NULL, 'j' },
         { "list", no_argument, NULL, 'l' },
+        { "prefork", no_argument, NULL, 'P' },
+        { "batch", required_argument, NULL, 'B' },
+        { "history", required_argument, NULL, 'H' },
+        { "shard", required_argument, NULL, 'S' },
+        { "fail-fast", optional_argument, NULL, 'F' },
+        { "output-limit", required_argument, NULL, 'O' },
         { NULL, 0, NULL, 0 },
     };
 
@@ -65,6 +77,41 @@ int main(int argc, char **argv)
             case 'l':
                 mode = LIST;
                 break;
+            case 'P':
+                prefork = true;
+                break;
+            case 'B':
+                if((batch_size = atoi(optarg)) <= 0)
+                {
+                    usage(argv[0]);
+                }
+                break;
+            case 'H':
+                history_file = optarg;
+                break;
+            case 'F':
+                if(!optarg)
+                {
+                    fail_fast = 1;
+                }
+                else if((fail_fast = atoi(optarg)) <= 0)
+                {
+                    usage(argv[0]);
+                }
+                break;
+            case 'O':
+                if((output_limit = atol(optarg)) < 0)
+                {
+                    usage(argv[0]);
+                }
+                break;
+            case 'S':
+                if(sscanf(optarg, "%d/%d", &shard, &nshards) != 2 ||
+                   shard < 1 || shard > nshards)
+                {
+                    usage(argv[0]);
+                }
+                break;
             default:
                 usage(argv[0]);
         }
@@ -75,10 +122,26 @@ int main(int argc, char **argv)
         plan = np_plan_new();
         np_plan_add_specs(plan, argc - optind, (const char **)argv + optind);
     }
+    if(nshards)
+    {
+        /* Run only one shard of the specified (or all the) tests */
+        if(!plan)
+        {
+            plan = np_plan_new();
+        }
+        np_plan_set_shard(plan, shard, nshards);
+    }
 
     /* Initialise the NovaProva library */
     runner = np_init();
 
+    /* Set where to remember test durations, which also
+     * decide the shards, so before listing them */
+    if(history_file)
+    {
+        np_set_history_file(runner, history_file);
+    }
+
     switch(mode)
     {
         case LIST:      /* List the specified (or all the discovered) tests */
@@ -108,6 +171,27 @@ int main(int argc, char **argv)
                 np_set_concurrency(runner, concurrency);
             }
 
+            /* Set whether tests run in pre-forked workers */
+            np_set_prefork(runner, prefork);
+
+            /* Set how much of each test's output to keep */
+            if(output_limit >= 0)
+            {
+                np_set_output_limit(runner, output_limit);
+            }
+
+            /* Set how many failures to stop after */
+            if(fail_fast)
+            {
+                np_set_fail_fast(runner, fail_fast);
+            }
+
+            /* Set how many tests each child process runs */
+            if(batch_size > 0)
+            {
+                np_set_batch_size(runner, batch_size);
+            }
+
             /* Run the specified tests */
             ec = np_run_tests(runner, plan);
             break;
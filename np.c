@@ -15,6 +15,7 @@
  */
 #include "np_priv.h"
 #include "except.h"
+#include "np/forkserver.hxx"
 #include <sys/time.h>
 #if HAVE_VALGRIND
     #include <valgrind/valgrind.h>
@@ -24,15 +25,64 @@ using namespace std;
 
 /*-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-*/
 
-static void be_valground(void)
+namespace np {
+
+extern bool is_running_under_sanitizer();
+
+/* Re-run the current executable under the given Valgrind tool */
+void exec_valgrind(const char *tool)
 {
     #if HAVE_VALGRIND
-    const char *env;
     int argc;
     char **argv;
     const char **newargv;
     const char **p;
 
+    if(!np::spiegel::platform::get_argv(&argc, &argv))
+    {
+        fprintf(stderr, "np: cannot find arguments to run valgrind\n");
+        exit(1);
+    }
+
+    fprintf(stderr, "[%s] np: starting valgrind\n",
+            np::util::rel_timestamp());
+
+    p = newargv = (const char **)np::util::xmalloc(sizeof(char *) * (argc + 6));
+    *p++ = VALGRIND_BINARY;
+    *p++ = "-q";
+    *p++ = np::util::xstrdup((string("--tool=") + tool).c_str());
+    #ifdef _NP_VALGRIND_SUPPRESSION_FILE
+    if(!strcmp(tool, "memcheck"))
+    {
+        *p++ = "--gen-suppressions=all";
+        *p++ = "--suppressions=" _NP_VALGRIND_SUPPRESSION_FILE;
+    }
+    #endif
+    while(*argv)
+    {
+        *p++ = *argv++;
+    }
+    *p = 0;
+
+    execv(newargv[0], (char *const *)newargv);
+    perror(newargv[0]);
+    #else
+    fprintf(stderr, "np: cannot run valgrind tool %s, "
+                    "NovaProva was built without valgrind\n", tool);
+    #endif
+    exit(1);
+}
+
+// close the namespace
+};
+
+static void be_valground(void)
+{
+    #if HAVE_VALGRIND
+    const char *env;
+    int argc;
+    char **argv;
+
     if(RUNNING_ON_VALGRIND)
     {
         return;
@@ -43,6 +93,11 @@ static void be_valground(void)
     {
         return;
     }
+    if(env && !strcmp(env, "children"))
+    {
+        /* the runner starts fork servers under valgrind */
+        return;
+    }
 
     if(np::spiegel::platform::is_running_under_debugger())
     {
@@ -50,30 +105,18 @@ static void be_valground(void)
         return;
     }
 
-    if(!np::spiegel::platform::get_argv(&argc, &argv))
+    if(np::is_running_under_sanitizer())
     {
+        /* the sanitizers check memory, much faster */
         return;
     }
 
-    fprintf(stderr, "[%s] np: starting valgrind\n",
-            np::util::rel_timestamp());
-
-    p = newargv = (const char **)np::util::xmalloc(sizeof(char *) * (argc + 6));
-    *p++ = VALGRIND_BINARY;
-    *p++ = "-q";
-    *p++ = "--tool=memcheck";
-    #ifdef _NP_VALGRIND_SUPPRESSION_FILE
-    *p++ = "--gen-suppressions=all";
-    *p++ = "--suppressions=" _NP_VALGRIND_SUPPRESSION_FILE;
-    #endif
-    while(*argv)
+    if(!np::spiegel::platform::get_argv(&argc, &argv))
     {
-        *p++ = *argv++;
+        return;
     }
 
-    execv(newargv[0], (char *const *)newargv);
-    perror(newargv[0]);
-    exit(1);
+    np::exec_valgrind("memcheck");
     #endif
 }
 
@@ -91,7 +134,10 @@ static void be_valground(void)
  * executable is running under Valgrind, which involves re-running
  * the process.  So be aware that any code between the start of @c main
  * and the call to @c np_init will be run twice in two different
- * processes, the second time under Valgrind.
+ * processes, the second time under Valgrind.  If the environment
+ * variable @c NOVAPROVA_VALGRIND is set to @c children, the calling
+ * executable instead runs natively, and the same code is run again
+ * under Valgrind in fork server processes which start the tests.
  *
  * The function also sets a C++ terminate handler using
  * @c std::set_terminate() which handles any uncaught C++ exceptions,
@@ -107,7 +153,10 @@ extern "C" np_runner_t *np_init(void)
     std::set_terminate(__np_terminate_handler);
     np::util::rel_timestamp();
     np::testmanager_t::instance();
-    return new np::runner_t;
+    np::runner_t *runner = new np::runner_t;
+    /* a fork server exec'd under Valgrind never returns from here */
+    np::forkserver_t::serve_exec(runner);
+    return runner;
 }
 
 /**
@@ -41,6 +41,11 @@ typedef struct np_plan np_plan_t;
 extern np_runner_t *np_init(void);
 extern void np_list_tests(np_runner_t *, np_plan_t *);
 extern void np_set_concurrency(np_runner_t *, int);
+extern void np_set_prefork(np_runner_t *, bool);
+extern void np_set_batch_size(np_runner_t *, int);
+extern void np_set_history_file(np_runner_t *, const char *);
+extern void np_set_fail_fast(np_runner_t *, int);
+extern void np_set_output_limit(np_runner_t *, unsigned long);
 extern bool np_set_output_format(np_runner_t *, const char *);
 extern int np_run_tests(np_runner_t *, np_plan_t *);
 extern int np_get_timeout(void);   /* in seconds, or zero */
@@ -48,8 +53,16 @@ extern void np_done(np_runner_t *);
 
 extern np_plan_t *np_plan_new(void);
 extern bool np_plan_add_specs(np_plan_t *, int nspec, const char **spec);
+extern bool np_plan_set_shard(np_plan_t *, int shard, int nshards);
 extern void np_plan_delete(np_plan_t *);
 
+/* Kinds of function for np_add_classifier() */
+#define NP_CLASSIFY_TEST	1
+#define NP_CLASSIFY_SETUP	2
+#define NP_CLASSIFY_TEARDOWN	3
+#define NP_CLASSIFY_MOCK	4
+extern bool np_add_classifier(const char *re, bool case_sensitive, int kind);
+
 extern const char *np_rel_timestamp(void);
 
 /* Test-callable macros for ending a test with a result */
@@ -232,6 +245,131 @@ extern void np_syslog_match(const char *re, int tag);
  */
 extern unsigned int np_syslog_count(int tag);
 
+/**
+ * @}
+ * \defgroup registration Registration
+ * @{
+ */
+
+/* Kinds of function in a __np_registration */
+#define __NP_REG_TEST	    1
+#define __NP_REG_SETUP	    2
+#define __NP_REG_TEARDOWN   3
+#define __NP_REG_MOCK	    4
+#define __NP_REG_PARAMETER  5
+#define __NP_REG_VALGRIND   6
+#define __NP_REG_DISCOVER   7
+
+struct __np_registration
+{
+    int kind;
+    const char *name;		/* test, mocked function or parameter */
+    const char *function_name;
+    void (*function)(void);
+    void (*target)(void);	/* the mocked function */
+    const char *file;
+    int line;
+};
+
+/* Emits a descriptor into the np_registry section, where the
+ * linker's __start_np_registry and __stop_np_registry symbols
+ * let NovaProva find it at startup */
+#define __NP_REGISTER(id, kind, nm, fn, tgt) \
+    static const struct __np_registration id \
+    __attribute__((used, section("np_registry"), aligned(sizeof(void *)))) = \
+    { kind, nm, #fn, (void (*)(void))(fn), (void (*)(void))(tgt), __FILE__, __LINE__ }
+
+/**
+ * Define a test function and register it.
+ *
+ * @param nm	    C identifier naming the test
+ *
+ * Starts the definition of a test function @c test_nm, which
+ * takes no arguments and returns void, and registers it with
+ * NovaProva so that it can be found without reading the debugging
+ * information.  For example:
+ * @code
+ * NP_TEST(simple)
+ * {
+ *     NP_ASSERT_EQUAL(1, 1);
+ * }
+ * @endcode
+ * Once any test in the executable is defined this way, NovaProva
+ * finds tests only this way and doesn't read the debugging
+ * information at startup, unless @c NP_DISCOVER_TESTS is also used.
+ * A source file which registers any test should use @c NP_TEST,
+ * @c NP_SETUP, @c NP_TEARDOWN and @c NP_MOCK throughout.
+ */
+#define NP_TEST(nm) \
+    static void test_##nm(void); \
+    __NP_REGISTER(__np_registered_test_##nm, __NP_REG_TEST, #nm, test_##nm, 0); \
+    static void test_##nm(void)
+
+/**
+ * Define a fixture setup function and register it.
+ *
+ * Starts the definition of a function @c setup, which takes no
+ * arguments and returns an int, zero for success.  It is called
+ * before each test in the same source file, like the setup functions
+ * found from the debugging information.
+ */
+#define NP_SETUP() \
+    static int setup(void); \
+    __NP_REGISTER(__np_registered_setup, __NP_REG_SETUP, "", setup, 0); \
+    static int setup(void)
+
+/**
+ * Define a fixture teardown function and register it.
+ *
+ * Starts the definition of a function @c teardown, which takes no
+ * arguments and returns an int, zero for success.  It is called
+ * after each test in the same source file.
+ */
+#define NP_TEARDOWN() \
+    static int teardown(void); \
+    __NP_REGISTER(__np_registered_teardown, __NP_REG_TEARDOWN, "", teardown, 0); \
+    static int teardown(void)
+
+/**
+ * Define a static mock and register it.
+ *
+ * @param rtype	    the return type of the mocked function
+ * @param fn	    the function to mock, which must be declared
+ * @param params    the parameter list of the mocked function, in parentheses
+ *
+ * Starts the definition of a function @c mock_fn, which is called
+ * instead of @a fn during each test in the same source file.  The
+ * mocked function is found by address, so no debugging information
+ * is needed.  For example:
+ * @code
+ * NP_MOCK(int, bird_tequila, (int x))
+ * {
+ *     return x + 1;
+ * }
+ * @endcode
+ */
+#define NP_MOCK(rtype, fn, params) \
+    static rtype mock_##fn params; \
+    __NP_REGISTER(__np_registered_mock_##fn, __NP_REG_MOCK, #fn, mock_##fn, fn); \
+    static rtype mock_##fn params
+
+/**
+ * Also discover tests in source files which don't register them.
+ *
+ * Normally an executable with any test defined by @c NP_TEST has
+ * only the registered tests, fixtures and mocks, and the debugging
+ * information is read only when it's needed, e.g. for a stack trace.
+ * Using this once, in any source file, asks NovaProva to read the
+ * debugging information at startup as well and discover the tests in
+ * all the other source files, for executables which mix the two
+ * styles.  For example:
+ * @code
+ * NP_DISCOVER_TESTS();
+ * @endcode
+ */
+#define NP_DISCOVER_TESTS() \
+    __NP_REGISTER(__np_registered_discover, __NP_REG_DISCOVER, "", 0, 0)
+
 /**
  * @}
  * \defgroup parameters Parameters
@@ -268,7 +406,49 @@ struct __np_param_dec
     { \
         static const struct __np_param_dec d = { & nm , vals }; \
         return &d; \
-    }
+    } \
+    __NP_REGISTER(__np_registered_parameter_##nm, __NP_REG_PARAMETER, #nm, __np_parameter_##nm, 0)
+
+/**
+ * @}
+ * \defgroup valgrind Valgrind
+ * @{
+ */
+
+struct __np_valgrind_dec
+{
+    const char *tool;
+    int leak_check;
+};
+/**
+ * Choose how Valgrind runs the tests in the current file.
+ *
+ * @param tool	    string literal naming the Valgrind tool, e.g.
+ *		    @c "memcheck", @c "helgrind", @c "none", or @c "no"
+ *		    to run the tests without Valgrind at all
+ * @param leak_check  zero to skip the memory leak check after each test
+ *
+ * Declares the Valgrind settings for the testnode corresponding to the
+ * source file in which it appears, which apply to every test in that
+ * file.  Tests without such a declaration run under the @c memcheck tool
+ * and are checked for leaks.  For example:
+ * @code
+ * NP_VALGRIND("helgrind", 0);
+ * @endcode
+ * The leak check setting is always honoured, but the tool is only used
+ * when Valgrind runs just the test child processes, which you can ask
+ * for by setting the environment variable @c NOVAPROVA_VALGRIND to
+ * @c children.  Otherwise the whole test executable runs under
+ * @c memcheck.
+ */
+#define NP_VALGRIND(tool, leak_check) \
+    static const struct __np_valgrind_dec *__np_valgrind(void) __attribute__((unused)); \
+    static const struct __np_valgrind_dec *__np_valgrind(void) \
+    { \
+        static const struct __np_valgrind_dec d = { tool , leak_check }; \
+        return &d; \
+    } \
+    __NP_REGISTER(__np_registered_valgrind, __NP_REG_VALGRIND, "", __np_valgrind, 0)
 
 /**
  * @}
@@ -0,0 +1,301 @@
+/*
+ * Copyright 2011-2012 Gregory Banks
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "np/cache.hxx"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+
+namespace np
+{
+    using namespace std;
+    using np::spiegel::dwarf::reference_t;
+
+    /*
+     * The file is a header, the key, an array of entries and a
+     * string table holding the submatches.
+     * Everything is in host byte order and 8-byte aligned, so the
+     * file is only ever read back on the machine which wrote it.
+     */
+    static const char cache_magic[8] = { 'N', 'P', 'C', 'A', 'C', 'H', 'E', '1' };
+    static const uint32_t cache_version = 2;
+
+    struct cache_header_t
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t keylen;
+        uint32_t nentries;
+        uint32_t strsize;
+    };
+
+    struct cache_entry_t
+    {
+        uint32_t type;
+        uint32_t cu;
+        uint32_t offset;
+        uint32_t target_cu;
+        uint32_t target_offset;
+        uint32_t submatch;	/* offset into the string table */
+    };
+
+    static size_t align8(size_t x)
+    {
+        return (x + 7) & ~(size_t)7;
+    }
+
+    cache_t::cache_t(const string &key)
+     :  key_(key)
+    {
+        directory_ = directory();
+        if(directory_.length() && key_.length())
+        {
+            char buf[32];
+            snprintf(buf, sizeof(buf), "/%016llx",
+                     (unsigned long long)np::util::hash_string(key_));
+            filename_ = directory_ + buf;
+        }
+    }
+
+    cache_t::~cache_t()
+    {
+    }
+
+    /*
+     * $NOVAPROVA_CACHE names the directory, or disables the cache
+     * when set to "no".  Otherwise we follow the XDG convention.
+     */
+    string cache_t::directory()
+    {
+        const char *e = getenv("NOVAPROVA_CACHE");
+        if(e && *e)
+        {
+            if(!strcmp(e, "no") || !strcmp(e, "0"))
+            {
+                return string();
+            }
+            return string(e);
+        }
+        e = getenv("XDG_CACHE_HOME");
+        if(e && *e == '/')
+        {
+            return string(e) + "/novaprova";
+        }
+        e = getenv("HOME");
+        if(e && *e == '/')
+        {
+            return string(e) + "/.cache/novaprova";
+        }
+        return string();
+    }
+
+    void cache_t::add(functype_t type,
+                      reference_t function,
+                      const char *submatch,
+                      reference_t target)
+    {
+        entry_t e;
+        e.type_ = type;
+        e.function_ = function;
+        e.target_ = target;
+        e.submatch_ = xstr(submatch);
+        entries_.push_back(e);
+    }
+
+    bool cache_t::load()
+    {
+        if(!is_enabled())
+        {
+            return false;
+        }
+
+        int fd = open(filename_.c_str(), O_RDONLY|O_CLOEXEC);
+        if(fd < 0)
+        {
+            if(errno != ENOENT)
+            {
+                perror(filename_.c_str());
+            }
+            return false;
+        }
+
+        struct stat sb;
+        if(fstat(fd, &sb) < 0 || (size_t)sb.st_size < sizeof(cache_header_t))
+        {
+            close(fd);
+            return false;
+        }
+        size_t size = sb.st_size;
+        void *map = mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if(map == MAP_FAILED)
+        {
+            perror(filename_.c_str());
+            return false;
+        }
+
+        const char *base = (const char *)map;
+        const cache_header_t *hdr = (const cache_header_t *)base;
+        size_t off = sizeof(*hdr);
+        const cache_entry_t *ents;
+        const char *strs;
+
+        /* anything unexpected means a stale or foreign file,
+         * which we silently ignore and will overwrite later */
+        if(memcmp(hdr->magic, cache_magic, sizeof(cache_magic)) ||
+           hdr->version != cache_version ||
+           hdr->keylen != key_.length())
+        {
+            goto out;
+        }
+        if(off + align8(hdr->keylen) > size ||
+           memcmp(base + off, key_.c_str(), hdr->keylen))
+        {
+            goto out;
+        }
+        off += align8(hdr->keylen);
+        ents = (const cache_entry_t *)(base + off);
+        off += hdr->nentries * sizeof(cache_entry_t);
+        strs = base + off;
+        off += hdr->strsize;
+        if(off != size || !hdr->strsize || strs[hdr->strsize-1])
+        {
+            goto out;
+        }
+
+        for(uint32_t i = 0 ; i < hdr->nentries ; i++)
+        {
+            if(ents[i].submatch >= hdr->strsize)
+            {
+                entries_.clear();
+                goto out;
+            }
+            entry_t e;
+            e.type_ = (functype_t)ents[i].type;
+            e.function_.cu = ents[i].cu;
+            e.function_.offset = ents[i].offset;
+            e.target_.cu = ents[i].target_cu;
+            e.target_.offset = ents[i].target_offset;
+            e.submatch_ = strs + ents[i].submatch;
+            entries_.push_back(e);
+        }
+        #if _NP_DEBUG
+        fprintf(stderr, "np: [%s] loaded %u entries from %s\n",
+                np::util::rel_timestamp(), (unsigned)entries_.size(),
+                filename_.c_str());
+        #endif
+        munmap(map, size);
+        return true;
+
+    out:
+        #if _NP_DEBUG
+        fprintf(stderr, "np: ignoring stale cache file %s\n", filename_.c_str());
+        #endif
+        munmap(map, size);
+        return false;
+    }
+
+    /* Failing to save is not worth failing the run over */
+    bool cache_t::save() const
+    {
+        if(!is_enabled())
+        {
+            return false;
+        }
+
+        /* make the directory and any missing parents */
+        for(size_t p = 0 ; p != string::npos ; )
+        {
+            p = directory_.find('/', p+1);
+            string dir = directory_.substr(0, p);
+            if(mkdir(dir.c_str(), 0755) < 0 && errno != EEXIST)
+            {
+                #if _NP_DEBUG
+                perror(dir.c_str());
+                #endif
+                return false;
+            }
+        }
+
+        string strtab(1, '\0');    /* offset 0 is "" */
+        vector<cache_entry_t> ents;
+        vector<entry_t>::const_iterator i;
+        for(i = entries_.begin() ; i != entries_.end() ; ++i)
+        {
+            cache_entry_t ce;
+            memset(&ce, 0, sizeof(ce));
+            ce.type = i->type_;
+            ce.cu = i->function_.cu;
+            ce.offset = i->function_.offset;
+            ce.target_cu = i->target_.cu;
+            ce.target_offset = i->target_.offset;
+            if(i->submatch_.length())
+            {
+                ce.submatch = strtab.length();
+                strtab += i->submatch_;
+                strtab += '\0';
+            }
+            ents.push_back(ce);
+        }
+
+        cache_header_t hdr;
+        memset(&hdr, 0, sizeof(hdr));
+        memcpy(hdr.magic, cache_magic, sizeof(cache_magic));
+        hdr.version = cache_version;
+        hdr.keylen = key_.length();
+        hdr.nentries = ents.size();
+        hdr.strsize = strtab.length();
+
+        /* write a new file and rename it into place, so that
+         * concurrent runs never see a partial file */
+        char pidbuf[32];
+        snprintf(pidbuf, sizeof(pidbuf), ".%d.tmp", (int)getpid());
+        string tmpfile = filename_ + pidbuf;
+        FILE *fp = fopen(tmpfile.c_str(), "w");
+        if(!fp)
+        {
+            #if _NP_DEBUG
+            perror(tmpfile.c_str());
+            #endif
+            return false;
+        }
+
+        static const char zeroes[8] = { 0 };
+        fwrite(&hdr, sizeof(hdr), 1, fp);
+        fwrite(key_.c_str(), 1, key_.length(), fp);
+        fwrite(zeroes, 1, align8(key_.length()) - key_.length(), fp);
+        if(ents.size())
+        {
+            fwrite(&ents[0], sizeof(cache_entry_t), ents.size(), fp);
+        }
+        fwrite(strtab.data(), 1, strtab.length(), fp);
+
+        if(ferror(fp) | (fclose(fp) < 0) ||
+           rename(tmpfile.c_str(), filename_.c_str()) < 0)
+        {
+            perror(filename_.c_str());
+            unlink(tmpfile.c_str());
+            return false;
+        }
+        #if _NP_DEBUG
+        fprintf(stderr, "np: [%s] saved %u entries to %s\n",
+                np::util::rel_timestamp(), (unsigned)entries_.size(),
+                filename_.c_str());
+        #endif
+        return true;
+    }
+
+    // close the namespace
+};
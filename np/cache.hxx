@@ -0,0 +1,79 @@
+/*
+ * Copyright 2011-2012 Gregory Banks
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef __NP_CACHE_H__
+#define __NP_CACHE_H__ 1
+
+#include "np/util/common.hxx"
+#include "np/types.hxx"
+#include "np/spiegel/dwarf/reference.hxx"
+#include <string>
+#include <vector>
+
+namespace np
+{
+
+    /*
+     * Remembers the results of test discovery, i.e. which functions
+     * were classified as what, in a binary file which is keyed by
+     * the build-ids of the executable and its shared objects.
+     * Loading it saves walking all the DWARF info on every start
+     * when nothing has been rebuilt.
+     */
+    class cache_t : public np::util::zalloc
+    {
+      public:
+        struct entry_t
+        {
+            functype_t type_;
+            np::spiegel::dwarf::reference_t function_;
+            np::spiegel::dwarf::reference_t target_;	/* for FT_MOCK */
+            std::string submatch_;
+        };
+
+        /* the key must change whenever the results would */
+        cache_t(const std::string &key);
+        ~cache_t();
+
+        bool is_enabled() const
+        {
+            return filename_.length() != 0;
+        }
+        bool load();
+        bool save() const;
+
+        void add(functype_t type,
+                 np::spiegel::dwarf::reference_t function,
+                 const char *submatch,
+                 np::spiegel::dwarf::reference_t target =
+                    np::spiegel::dwarf::reference_t::null);
+        const std::vector<entry_t> &get_entries() const
+        {
+            return entries_;
+        }
+
+      private:
+        static std::string directory();
+
+        std::string key_;
+        std::string directory_;
+        std::string filename_;
+        std::vector<entry_t> entries_;
+    };
+
+    // close the namespace
+};
+
+#endif /* __NP_CACHE_H__ */
@@ -0,0 +1,252 @@
+/*
+ * Copyright 2011-2012 Gregory Banks
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "np/capture.hxx"
+#include <fcntl.h>
+
+namespace np
+{
+    using namespace std;
+
+    /* keep up to this many bytes in memory before spilling to disk */
+    static const size_t SPILL_THRESHOLD = 64 * 1024;
+
+    capture_t::capture_t()
+        :  fd_(-1),
+           copy_fd_(-1),
+           spill_fd_(-1)
+    {
+    }
+
+    capture_t::~capture_t()
+    {
+        detach();
+        if(spill_fd_ >= 0)
+        {
+            close(spill_fd_);
+        }
+    }
+
+    void capture_t::attach(int fd, size_t limit, int copy_fd)
+    {
+        /* a job run again, e.g. after its batch crashed,
+         * starts with fresh output */
+        total_ = 0;
+        string().swap(mem_);
+        if(spill_fd_ >= 0)
+        {
+            close(spill_fd_);
+            spill_fd_ = -1;
+        }
+
+        fd_ = fd;
+        copy_fd_ = copy_fd;
+        string().swap(pending_);
+        fcntl(fd_, F_SETFL, O_NONBLOCK);
+        /* the head gets any odd byte */
+        tailmax_ = limit / 2;
+        headmax_ = limit - tailmax_;
+    }
+
+    void capture_t::copy_out()
+    {
+        size_t off = 0;
+        while(off < pending_.length())
+        {
+            ssize_t w = write(copy_fd_, pending_.data() + off, pending_.length() - off);
+            if(w < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if(w <= 0)
+            {
+                break;
+            }
+            off += w;
+        }
+        string().swap(pending_);
+    }
+
+    void capture_t::detach()
+    {
+        if(fd_ >= 0)
+        {
+            close(fd_);
+            fd_ = -1;
+        }
+    }
+
+    /*
+     * Read whatever the child has written so far, without blocking.
+     * Returns false once the pipe has been closed by the child, or
+     * on error.
+     */
+    bool capture_t::drain()
+    {
+        char buf[16384];
+        ssize_t r;
+
+        for(;;)
+        {
+            r = read(fd_, buf, sizeof(buf));
+            if(r > 0 && copy_fd_ >= 0)
+            {
+                pending_.append(buf, r);
+                continue;
+            }
+            if(r > 0)
+            {
+                append(buf, r);
+                continue;
+            }
+            if(r < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if(r < 0 && errno == EAGAIN)
+            {
+                return true;
+            }
+            if(r < 0)
+            {
+                perror("np: reading test output");
+            }
+            return false;
+        }
+    }
+
+    /*
+     * The first headmax_ bytes are stored at the start, and everything
+     * after that goes round a ring of tailmax_ bytes stored after the
+     * head, so the ring always holds the last tailmax_ bytes.
+     */
+    void capture_t::append(const char *buf, size_t len)
+    {
+        while(len)
+        {
+            size_t off;
+            size_t n;
+
+            if(!headmax_ || total_ < headmax_)
+            {
+                off = total_;
+                n = (headmax_ ? min<uint64_t>(len, headmax_ - total_) : len);
+            }
+            else if(tailmax_)
+            {
+                size_t pos = (total_ - headmax_) % tailmax_;
+                off = headmax_ + pos;
+                n = min(len, tailmax_ - pos);
+            }
+            else
+            {
+                /* limit of one byte: just count the rest */
+                total_ += len;
+                return;
+            }
+            store(off, buf, n);
+            total_ += n;
+            buf += n;
+            len -= n;
+        }
+    }
+
+    string capture_t::get() const
+    {
+        string s;
+
+        if(!headmax_ || total_ <= headmax_ + tailmax_)
+        {
+            /* the ring never wrapped */
+            load(0, total_, s);
+            return s;
+        }
+
+        uint64_t dropped = total_ - headmax_ - tailmax_;
+        size_t pos = (tailmax_ ? (total_ - headmax_) % tailmax_ : 0);
+        char note[80];
+        snprintf(note, sizeof(note), "\n[... %llu bytes omitted ...]\n",
+                 (unsigned long long)dropped);
+
+        load(0, headmax_, s);
+        s += note;
+        load(headmax_ + pos, tailmax_ - pos, s);
+        load(headmax_, pos, s);
+        return s;
+    }
+
+    void capture_t::store(size_t off, const char *buf, size_t len)
+    {
+        if(spill_fd_ < 0 && off + len > SPILL_THRESHOLD)
+        {
+            spill();
+        }
+        if(spill_fd_ < 0)
+        {
+            if(mem_.size() < off + len)
+            {
+                mem_.resize(off + len);
+            }
+            mem_.replace(off, len, buf, len);
+            return;
+        }
+        if(pwrite(spill_fd_, buf, len, off) != (ssize_t)len)
+        {
+            perror("np: writing test output to temporary file");
+        }
+    }
+
+    void capture_t::load(size_t off, size_t len, string &s) const
+    {
+        if(spill_fd_ < 0)
+        {
+            s.append(mem_, off, len);
+            return;
+        }
+        size_t start = s.size();
+        s.resize(start + len);
+        ssize_t r = pread(spill_fd_, (char *)s.data() + start, len, off);
+        if(r < 0)
+        {
+            perror("np: reading test output from temporary file");
+            r = 0;
+        }
+        s.resize(start + r);
+    }
+
+    void capture_t::spill()
+    {
+        const char *tmpdir = getenv("TMPDIR");
+        char path[PATH_MAX];
+
+        snprintf(path, sizeof(path), "%s/novaprova.out.XXXXXX",
+                 (tmpdir ? tmpdir : "/tmp"));
+        spill_fd_ = mkstemp(path);
+        if(spill_fd_ < 0)
+        {
+            perror(path);
+            exit(1);
+        }
+        unlink(path);
+        if(mem_.size() &&
+           pwrite(spill_fd_, mem_.data(), mem_.size(), 0) != (ssize_t)mem_.size())
+        {
+            perror("np: writing test output to temporary file");
+        }
+        string().swap(mem_);
+    }
+
+    // close the namespace
+};
@@ -0,0 +1,71 @@
+/*
+ * Copyright 2011-2012 Gregory Banks
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef __NP_CAPTURE_H__
+#define __NP_CAPTURE_H__ 1
+
+#include "np/util/common.hxx"
+
+namespace np
+{
+
+    /*
+     * Collects a test's stdout or stderr from the read end of a pipe,
+     * which the runner drains from its event loop as the child writes
+     * to it.  At most @c limit bytes are kept, the first and last
+     * halves of the output, with the middle replaced by a note saying
+     * how much was dropped.  Kept output lives in memory until there's
+     * more than a small threshold of it, and then moves to an unlinked
+     * temporary file.
+     */
+    class capture_t : public np::util::zalloc
+    {
+      public:
+        capture_t();
+        ~capture_t();
+
+        /* limit is in bytes, 0 for unlimited.  With a copy_fd the
+         * output is only held until copy_out() writes it there */
+        void attach(int fd, size_t limit, int copy_fd = -1);
+        void copy_out();
+        void detach();
+        int get_fd() const
+        {
+            return fd_;
+        }
+        bool drain();
+
+        void append(const char *buf, size_t len);
+        std::string get() const;
+
+      private:
+        void store(size_t off, const char *buf, size_t len);
+        void load(size_t off, size_t len, std::string &s) const;
+        void spill();
+
+        int fd_;		/* read end of the pipe */
+        int copy_fd_;
+        std::string pending_;	/* not yet copied to copy_fd_ */
+        size_t headmax_;	/* 0 for unlimited */
+        size_t tailmax_;
+        uint64_t total_;	/* bytes seen */
+        std::string mem_;	/* kept bytes, until spilled */
+        int spill_fd_;
+    };
+
+    // close the namespace
+};
+
+#endif /* __NP_CAPTURE_H__ */
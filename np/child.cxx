@@ -26,7 +26,20 @@ namespace np
     child_t::child_t(pid_t pid, int fd, job_t *j)
         :  pid_(pid),
            event_pipe_(fd),
-           job_(j),
+           started_(true),
+           result_(R_UNKNOWN),
+           state_(RUNNING)
+    {
+        jobs_.push_back(j);
+    }
+
+    /* A child which runs a batch of jobs in sequence, telling
+     * us over the event pipe as each one begins and ends. */
+    child_t::child_t(pid_t pid, int fd, const std::vector<job_t *> &batch)
+        :  pid_(pid),
+           event_pipe_(fd),
+           jobs_(batch.begin(), batch.end()),
+           started_(false),
            result_(R_UNKNOWN),
            state_(RUNNING)
     {
@@ -35,26 +48,68 @@ namespace np
     child_t::~child_t()
     {
         close(event_pipe_);
-        delete job_;
+        while(jobs_.size())
+        {
+            delete jobs_.front();
+            jobs_.pop_front();
+        }
     }
 
-    void child_t::handle_input()
+    enum proxy_call child_t::handle_input()
     {
         #if _NP_DEBUG
         fprintf(stderr, "np: [%s] pid %d job %s handle_input() state=%d\n",
-                np::util::rel_timestamp(), (int)pid_, job_->as_string().c_str(), (int)state_);
+                np::util::rel_timestamp(), (int)pid_, get_job()->as_string().c_str(), (int)state_);
         #endif
         if(state_ == FINISHED)
         {
-            return;
+            return PROXY_INVALID;
         }
-        if(!proxy_listener_t::handle_call(event_pipe_, job_, &result_))
+        enum proxy_call call = proxy_listener_t::handle_call(event_pipe_, get_job(), &result_);
+        switch(call)
         {
-            #if _NP_DEBUG
-            fprintf(stderr, "np: child now finished\n");
-            #endif
-            state_ = FINISHED;
+            case PROXY_EVENT:
+                break;
+            case PROXY_BEGIN:
+                started_ = true;
+                break;
+            case PROXY_FINISHED:
+                if(jobs_.size() > 1)
+                {
+                    /* more of the batch to come */
+                    break;
+                }
+                /* fall through */
+            default:
+                #if _NP_DEBUG
+                fprintf(stderr, "np: child now finished\n");
+                #endif
+                state_ = FINISHED;
+                break;
         }
+        return call;
+    }
+
+    /* Move on to the next job in the batch */
+    void child_t::next_job()
+    {
+        if(jobs_.front()->get_usage())
+        {
+            used_ += *jobs_.front()->get_usage();
+        }
+        delete jobs_.front();
+        jobs_.pop_front();
+        started_ = false;
+        result_ = R_UNKNOWN;
+    }
+
+    /* Detach the jobs which haven't been finished, so they can be
+     * given to another child */
+    std::vector<job_t *> child_t::take_jobs()
+    {
+        std::vector<job_t *> jobs(jobs_.begin(), jobs_.end());
+        jobs_.clear();
+        return jobs;
     }
 
     void child_t::handle_timeout(int64_t end)
@@ -67,9 +122,10 @@ namespace np
                     static char buf[80];
                     snprintf(buf, sizeof(buf), "Child process %d timed out, killing", (int)pid_);
                     event_t ev(EV_TIMEOUT, buf);
-                    merge_result(np::runner_t::running()->raise_event(job_, &ev));
+                    merge_result(np::runner_t::running()->raise_event(get_job(), &ev));
 
                     kill(pid_, SIGTERM);
+                    timed_out_ = true;
                     state_ = TIMEOUT1;
                     deadline_ = end + 3 * NANOSEC_PER_SEC;
                 }
@@ -84,10 +140,40 @@ namespace np
         }
     }
 
+    /*
+     * Kill the child early because the run is being cut short, using
+     * the same SIGTERM then SIGKILL sequence as for a timeout.
+     */
+    void child_t::abort(int64_t now)
+    {
+        if(state_ != RUNNING)
+        {
+            return;
+        }
+        aborted_ = true;
+        if(started_)
+        {
+            merge_result(R_ABORTED);
+        }
+        kill(pid_, SIGTERM);
+        state_ = TIMEOUT1;
+        deadline_ = now + 3 * NANOSEC_PER_SEC;
+    }
+
     void child_t::merge_result(result_t r)
     {
         result_ = merge(result_, r);
     }
 
+    /*
+     * The child has been reaped, having used @a total resources over
+     * its whole life.  Charge whatever its earlier jobs didn't use to
+     * the current job, which includes starting and exiting the process.
+     */
+    void child_t::charge_usage(const usage_t &total)
+    {
+        get_job()->set_usage(total - used_);
+    }
+
     // close the namespace
 };
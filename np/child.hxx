@@ -18,7 +18,11 @@
 
 #include "np/util/common.hxx"
 #include "np/types.hxx"
+#include "np/proxy_listener.hxx"
+#include "np/job.hxx"
 #include <sys/poll.h>
+#include <deque>
+#include <vector>
 
 namespace np
 {
@@ -29,26 +33,47 @@ namespace np
     {
       public:
         child_t(pid_t pid, int fd, job_t *);
+        child_t(pid_t pid, int fd, const std::vector<job_t *> &batch);
         ~child_t();
 
         pid_t get_pid() const
         {
             return pid_;
         }
+        /* for a worker we learn the pid of after dispatching it */
+        void set_pid(pid_t pid)
+        {
+            pid_ = pid;
+        }
+        /* the job currently running, or next to run */
         job_t *get_job() const
         {
-            return job_;
+            return jobs_.front();
+        }
+        unsigned int get_njobs() const
+        {
+            return jobs_.size();
+        }
+        bool is_job_started() const
+        {
+            return started_;
         }
+        void next_job();
+        std::vector<job_t *> take_jobs();
         result_t get_result() const
         {
             return result_;
         }
 
+        int get_event_fd() const
+        {
+            return event_pipe_;
+        }
         int get_input_fd() const
         {
             return (state_ == FINISHED ? -1 : event_pipe_);
         }
-        void handle_input();
+        enum proxy_call handle_input();
         int64_t get_deadline() const
         {
             return deadline_;
@@ -58,13 +83,27 @@ namespace np
             deadline_ = d;
         }
         void handle_timeout(int64_t);
+        void abort(int64_t);
+        bool is_aborted() const
+        {
+            return aborted_;
+        }
+        bool is_timed_out() const
+        {
+            return timed_out_;
+        }
         void merge_result(result_t r);
+        void charge_usage(const usage_t &total);
 
       private:
         pid_t pid_;
         int event_pipe_;	    /* read end of the pipe */
-        job_t *job_;
+        std::deque<job_t *> jobs_;  /* more than one if batched */
+        bool started_;
+        usage_t used_;		    /* by jobs already finished */
         result_t result_;
+        bool aborted_;
+        bool timed_out_;	    /* killed for running too long */
         enum
         {
             RUNNING,
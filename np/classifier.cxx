@@ -18,6 +18,7 @@
 
 namespace np
 {
+    using namespace std;
 
     const char *classifier_t::error_string() const
     {
@@ -37,6 +38,7 @@ namespace np
     bool classifier_t::set_regexp(const char *re, bool case_sensitive)
     {
         re_ = np::util::xstrdup(re);
+        case_sensitive_ = case_sensitive;
         error_ = regcomp(&compiled_re_, re,
                          REG_EXTENDED | (case_sensitive ? 0 : REG_ICASE));
         if(error_)
@@ -44,15 +46,256 @@ namespace np
             fprintf(stderr, "np: bad classifier %s\n", error_string());
             return false;
         }
+        is_simple_ = compile_simple();
+        #if _NP_DEBUG
+        fprintf(stderr, "np: classifier /%s/ is %s\n",
+                re_, (is_simple_ ? "simple" : "a full regexp"));
+        #endif
         return true;
     }
 
+    /* characters which mean something outside a bracket expression */
+    static const char re_specials[] = ".[]()*+?{}|^$\\";
+
+    /*
+     * Parses one literal, escaped literal, . or bracket expression
+     * into the set of bytes it matches.  Returns false for anything
+     * else, or anything which the regex engine might treat other
+     * than as plain ASCII bytes.
+     */
+    bool classifier_t::parse_atom(const char *&p, charset_t &set) const
+    {
+        memset(&set, 0, sizeof(set));
+        if(*p == '.')
+        {
+            for(unsigned int c = 1 ; c < 256 ; c++)
+            {
+                set.add(c);
+            }
+            p++;
+            return true;
+        }
+        if(*p == '[')
+        {
+            p++;
+            if(*p == '^' || *p == ']')
+            {
+                return false;
+            }
+            while(*p != ']')
+            {
+                unsigned char lo = *p;
+                if(!lo || lo == '[' || lo == '\\' || lo >= 0x80)
+                {
+                    return false;
+                }
+                unsigned char hi = lo;
+                if(p[1] == '-' && p[2] != ']')
+                {
+                    hi = p[2];
+                    if(!hi || hi == '[' || hi == '\\' || hi >= 0x80 || hi < lo)
+                    {
+                        return false;
+                    }
+                    p += 2;
+                }
+                p++;
+                for(unsigned int c = lo ; c <= hi ; c++)
+                {
+                    set.add(c);
+                    if(!case_sensitive_ && isalpha(c))
+                    {
+                        set.add(tolower(c));
+                        set.add(toupper(c));
+                    }
+                }
+            }
+            p++;
+            return true;
+        }
+
+        unsigned char c = *p;
+        if(c == '\\')
+        {
+            c = *++p;
+            if(!c || !strchr(re_specials, c))
+            {
+                return false;   /* e.g. \w, which is a GNU extension */
+            }
+        }
+        else if(strchr(re_specials, c))
+        {
+            return false;
+        }
+        if(c >= 0x80)
+        {
+            return false;
+        }
+        p++;
+        set.add(c);
+        if(!case_sensitive_ && isalpha(c))
+        {
+            set.add(tolower(c));
+            set.add(toupper(c));
+        }
+        return true;
+    }
+
+    /*
+     * Compiles the regexp for match_simple() if it has the form
+     * ^atoms... with at most one group, an optional .* at the end of
+     * the atoms or of the group, and an optional $.  Returns false
+     * if the regexp needs the regex engine.
+     */
+    bool classifier_t::compile_simple()
+    {
+        const char *p = re_;
+        bool in_group = false;
+
+        atoms_.clear();
+        tail_any_ = false;
+        anchored_end_ = false;
+        group_so_ = -1;
+        group_eo_ = -1;
+
+        if(*p++ != '^')
+        {
+            return false;
+        }
+        while(*p)
+        {
+            if(p[0] == '$' && !p[1])
+            {
+                anchored_end_ = true;
+                break;
+            }
+            if(*p == '(')
+            {
+                if(in_group || group_so_ >= 0 || tail_any_)
+                {
+                    return false;
+                }
+                in_group = true;
+                group_so_ = atoms_.size();
+                p++;
+                continue;
+            }
+            if(*p == ')')
+            {
+                if(!in_group)
+                {
+                    return false;
+                }
+                in_group = false;
+                group_eo_ = (tail_any_ ? -1 : (int)atoms_.size());
+                p++;
+                continue;
+            }
+            if(tail_any_)
+            {
+                return false;   /* only ) or $ may follow .* */
+            }
+            if(p[0] == '.' && p[1] == '*')
+            {
+                tail_any_ = true;
+                p += 2;
+                continue;
+            }
+            charset_t set;
+            if(!parse_atom(p, set) || (*p && strchr("*+?{", *p)))
+            {
+                return false;
+            }
+            atoms_.push_back(set);
+        }
+        return !in_group;
+    }
+
+    /*
+     * Returns 0 on a match, with the same submatches which regexec()
+     * would find, REG_NOMATCH, or -1 if the name has bytes which
+     * only the regex engine knows how to treat.
+     */
+    int classifier_t::match_simple(const char *func, regmatch_t *match) const
+    {
+        const unsigned char *s = (const unsigned char *)func;
+        unsigned int n = atoms_.size();
+        for(unsigned int i = 0 ; i < n ; i++)
+        {
+            if(s[i] >= 0x80)
+            {
+                return -1;
+            }
+            if(!atoms_[i].has(s[i]))
+            {
+                return REG_NOMATCH;
+            }
+        }
+
+        size_t len = n;
+        if(tail_any_)
+        {
+            for( ; s[len] ; len++)
+            {
+                if(s[len] >= 0x80)
+                {
+                    return -1;
+                }
+            }
+        }
+        if(anchored_end_ && !tail_any_ && s[n])
+        {
+            return REG_NOMATCH;
+        }
+
+        match[0].rm_so = 0;
+        match[0].rm_eo = (tail_any_ ? len : n);
+        if(group_so_ >= 0)
+        {
+            match[1].rm_so = group_so_;
+            match[1].rm_eo = (group_eo_ < 0 ? len : group_eo_);
+        }
+        else
+        {
+            match[1].rm_so = match[1].rm_eo = -1;
+        }
+        return 0;
+    }
+
+    bool classifier_t::may_start_with(unsigned char c) const
+    {
+        if(!is_simple_ || !atoms_.size())
+        {
+            return true;
+        }
+        return atoms_[0].has(c);
+    }
+
+    std::string classifier_t::as_string() const
+    {
+        char buf[64];
+        snprintf(buf, sizeof(buf), "%s -> %d,%d",
+                 (case_sensitive_ ? "" : "i"), results_[0], results_[1]);
+        return std::string("/") + re_ + "/" + buf;
+    }
+
     int classifier_t::classify(const char *func,
                                char *match_return,
                                size_t maxmatch) const
+    {
+        return (match(func, match_return, maxmatch) ? results_[1] : results_[0]);
+    }
+
+    bool classifier_t::match(const char *func,
+                             char *match_return,
+                             size_t maxmatch) const
     {
         regmatch_t match[2];
-        int r = regexec(&compiled_re_, func, 2, match, 0);
+        int r = (is_simple_ ? match_simple(func, match) : -1);
+        if(r < 0)
+        {
+            r = regexec(&compiled_re_, func, 2, match, 0);
+        }
 
         if(r == 0)
         {
@@ -69,13 +312,13 @@ namespace np
                 {
                     fprintf(stderr, "np: match for classifier %s too long\n",
                             re_);
-                    return results_[0];
+                    return false;
                 }
                 memcpy(match_return, func + match[1].rm_so, len);
                 match_return[len] = '\0';
                 // fprintf(stderr, "    match_return \"%s\"\n", match_return);
             }
-            return results_[1];
+            return true;
         }
 
         if(r != REG_NOMATCH)
@@ -85,7 +328,65 @@ namespace np
                     func, error_string());
         }
 
-        return results_[0];
+        return false;
+    }
+
+    /*-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-*/
+
+    classifier_set_t::~classifier_set_t()
+    {
+        while(classifiers_.size())
+        {
+            delete classifiers_.back();
+            classifiers_.pop_back();
+        }
+    }
+
+    void classifier_set_t::add(classifier_t *cl)
+    {
+        unsigned int idx = classifiers_.size();
+        classifiers_.push_back(cl);
+        for(unsigned int c = 0 ; c < 256 ; c++)
+        {
+            if(cl->may_start_with(c))
+            {
+                by_first_[c].push_back(idx);
+            }
+        }
+    }
+
+    /*
+     * Returns the result of the first classifier, in the order
+     * added, which matches; or @a unmatched.
+     */
+    int classifier_set_t::classify(const char *func,
+                                   char *match_return,
+                                   size_t maxmatch,
+                                   int unmatched) const
+    {
+        const vector<unsigned int> &cands = by_first_[(unsigned char)func[0]];
+        vector<unsigned int>::const_iterator i;
+        for(i = cands.begin() ; i != cands.end() ; ++i)
+        {
+            const classifier_t *cl = classifiers_[*i];
+            if(cl->match(func, match_return, maxmatch))
+            {
+                return cl->get_result();
+            }
+        }
+        return unmatched;
+    }
+
+    std::string classifier_set_t::as_string() const
+    {
+        std::string s;
+        vector<classifier_t *>::const_iterator i;
+        for(i = classifiers_.begin() ; i != classifiers_.end() ; ++i)
+        {
+            s += (*i)->as_string();
+            s += "\n";
+        }
+        return s;
     }
 
     // close the namespace
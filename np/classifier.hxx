@@ -18,6 +18,7 @@
 
 #include "np/util/common.hxx"
 #include <regex.h>
+#include <vector>
 
 namespace np
 {
@@ -42,18 +43,83 @@ namespace np
             results_[0] = failed;
             results_[1] = matched;
         }
+        int get_result() const
+        {
+            return results_[1];
+        }
         int classify(const char *, char *, size_t) const;
+        bool match(const char *, char *, size_t) const;
+        /* false if no string starting with the byte can match */
+        bool may_start_with(unsigned char c) const;
+        /* true if names are matched without the regex engine */
+        bool is_simple() const
+        {
+            return is_simple_;
+        }
         const char *error_string() const;
+        std::string as_string() const;
 
       private:
+        struct charset_t
+        {
+            uint32_t bits_[8];
+
+            void add(unsigned char c)
+            {
+                bits_[c >> 5] |= (1U << (c & 31));
+            }
+            bool has(unsigned char c) const
+            {
+                return !!(bits_[c >> 5] & (1U << (c & 31)));
+            }
+        };
+
+        bool compile_simple();
+        bool parse_atom(const char *&p, charset_t &set) const;
+        int match_simple(const char *, regmatch_t *) const;
+
         char *re_;
+        bool case_sensitive_;
         regex_t compiled_re_;
         int results_[2];
         int error_;
+
+        /*
+         * Most classifiers are an anchored string of literals and
+         * bracket expressions, with perhaps one group and a trailing
+         * .* which are easy to match without the regex engine.
+         * Those compile to one set of bytes per position.
+         */
+        bool is_simple_;
+        std::vector<charset_t> atoms_;
+        bool tail_any_;		/* .* after the atoms */
+        bool anchored_end_;	/* $ after the atoms */
+        int group_so_;		/* first atom in the group, or -1 */
+        int group_eo_;		/* atom after the group, or -1 for the end */
+    };
+
+    /*
+     * An ordered list of classifiers, which finds the first one to
+     * match a name.  Each name is tried only against the classifiers
+     * which can match its first byte, so most names, which don't
+     * look like tests at all, are rejected after a table lookup.
+     */
+    class classifier_set_t : public np::util::zalloc
+    {
+      public:
+        ~classifier_set_t();
+
+        /* takes ownership */
+        void add(classifier_t *);
+        int classify(const char *, char *, size_t, int unmatched) const;
+        std::string as_string() const;
+
+      private:
+        std::vector<classifier_t *> classifiers_;
+        std::vector<unsigned int> by_first_[256];
     };
 
     // close the namespace
 };
 
 #endif /* __NP_CLASSIFIER_H__ */
-
@@ -146,6 +146,7 @@ namespace np
             case EV_TIMEOUT:
             case EV_FDLEAK:
             case EV_EXCEPTION:
+            case EV_SANITIZER:
                 return R_FAIL;
             case EV_EXPASS:
                 return R_PASS;
@@ -168,7 +169,7 @@ namespace np
             "NONE", "ASSERT", "EXIT", "SIGNAL",
             "SYSLOG", "FIXTURE", "EXPASS", "EXFAIL",
             "EXNA", "VALGRIND", "SLMATCH", "TIMEOUT",
-            "FDLEAK", "EXCEPTION"
+            "FDLEAK", "EXCEPTION", "SANITIZER"
         };
         const char *wstr = ((unsigned)which < arraysize(whichstrs))
                            ? whichstrs[(unsigned)which] : "unknown";
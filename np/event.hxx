@@ -39,6 +39,7 @@ namespace np
         EV_TIMEOUT,		/* child took too long */
         EV_FDLEAK,		/* file descriptor leak */
         EV_EXCEPTION,	/* C++ exception thrown */
+        EV_SANITIZER,	/* ASan, LSan or UBSan spotted an error */
     };
 
     class event_t
@@ -0,0 +1,650 @@
+/*
+ * Copyright 2011-2012 Gregory Banks
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/fcntl.h>
+#include "np/forkserver.hxx"
+#include "np/runner.hxx"
+#include "np/job.hxx"
+#include "np/testnode.hxx"
+#include "np/testmanager.hxx"
+
+namespace np
+{
+    using namespace std;
+
+    /* Sent from the runner to the fork server and then on to a
+     * worker, with the job's descriptors attached.  The testnode
+     * pointer is valid in both when the fork server was forked
+     * from the runner after test discovery; an exec'd fork server
+     * did its own discovery and has to look the node up by name. */
+    struct forkserver_request_t
+    {
+        testnode_t *node;
+        unsigned int assign_index;
+        char name[PATH_MAX];
+    };
+
+    /* Tells an exec'd fork server its descriptors and pool size */
+#define FORKSERVER_ENV	"_NOVAPROVA_FORKSERVER"
+
+    extern void exec_valgrind(const char *tool) __attribute__((noreturn));
+
+    /* Sent from the fork server to the runner when a worker exits */
+    struct forkserver_status_t
+    {
+        pid_t pid;
+        int status;
+        struct rusage rusage;
+    };
+
+#define MAX_FDS	3	/* event pipe, stdout, stderr */
+
+    static bool send_message(int sock, const void *buf, size_t len,
+                             const int *fds, int nfds)
+    {
+        struct msghdr msg;
+        struct iovec iov;
+        union
+        {
+            struct cmsghdr align;
+            char buf[CMSG_SPACE(sizeof(int) * MAX_FDS)];
+        } control;
+        ssize_t r;
+
+        memset(&msg, 0, sizeof(msg));
+        memset(&control, 0, sizeof(control));
+        iov.iov_base = (void *)buf;
+        iov.iov_len = len;
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        if(nfds)
+        {
+            msg.msg_control = control.buf;
+            msg.msg_controllen = CMSG_SPACE(sizeof(int) * nfds);
+            struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+            cmsg->cmsg_level = SOL_SOCKET;
+            cmsg->cmsg_type = SCM_RIGHTS;
+            cmsg->cmsg_len = CMSG_LEN(sizeof(int) * nfds);
+            memcpy(CMSG_DATA(cmsg), fds, sizeof(int) * nfds);
+        }
+
+        do
+        {
+            r = sendmsg(sock, &msg, MSG_NOSIGNAL);
+        } while(r < 0 && errno == EINTR);
+        return (r == (ssize_t)len);
+    }
+
+    /* Returns the number of bytes received, 0 on EOF or -1 on error */
+    static ssize_t recv_message(int sock, void *buf, size_t len,
+                                int *fds, int *nfdsp)
+    {
+        struct msghdr msg;
+        struct iovec iov;
+        union
+        {
+            struct cmsghdr align;
+            char buf[CMSG_SPACE(sizeof(int) * MAX_FDS)];
+        } control;
+        ssize_t r;
+
+        memset(&msg, 0, sizeof(msg));
+        iov.iov_base = buf;
+        iov.iov_len = len;
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control.buf;
+        msg.msg_controllen = sizeof(control.buf);
+
+        do
+        {
+            r = recvmsg(sock, &msg, 0);
+        } while(r < 0 && errno == EINTR);
+
+        *nfdsp = 0;
+        if(r <= 0)
+        {
+            return r;
+        }
+        struct cmsghdr *cmsg;
+        for(cmsg = CMSG_FIRSTHDR(&msg) ; cmsg ; cmsg = CMSG_NXTHDR(&msg, cmsg))
+        {
+            if(cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+            {
+                continue;
+            }
+            int n = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            if(n > MAX_FDS)
+            {
+                n = MAX_FDS;
+            }
+            memcpy(fds, CMSG_DATA(cmsg), sizeof(int) * n);
+            *nfdsp = n;
+        }
+        return r;
+    }
+
+    /*-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-*/
+
+    /* Self-pipe used to wake up the fork server's poll() loop */
+    static int sigchld_fds[2] = { -1, -1 };
+
+    static void handle_sigchld(int sig __attribute__((unused)))
+    {
+        int e = errno;
+        if(write(sigchld_fds[1], "c", 1) < 0)
+        {
+            /* pipe is full, the poll loop will wake anyway */
+        }
+        errno = e;
+    }
+
+    forkserver_t::forkserver_t(runner_t *r, const char *tool)
+        :  runner_(r),
+           tool_(tool ? tool : ""),
+           pid_(0),
+           control_fd_(-1),
+           status_fd_(-1),
+           nworkers_(1)
+    {
+    }
+
+    forkserver_t::~forkserver_t()
+    {
+        stop();
+    }
+
+    bool forkserver_t::start(unsigned int nworkers)
+    {
+        int sv[2];
+        int sp[2];
+        pid_t pid;
+
+        nworkers_ = (nworkers ? nworkers : 1);
+
+        /* close-on-exec, so that a fork server exec'd under Valgrind
+         * doesn't hold open another fork server's control socket */
+        if(socketpair(AF_UNIX, SOCK_SEQPACKET|SOCK_CLOEXEC, 0, sv) < 0)
+        {
+            perror("np: socketpair");
+            return false;
+        }
+        if(pipe2(sp, O_CLOEXEC) < 0)
+        {
+            perror("np: pipe");
+            close(sv[0]);
+            close(sv[1]);
+            return false;
+        }
+
+        /* don't let the fork server inherit buffered output */
+        fflush(stdout);
+        fflush(stderr);
+
+        pid = fork();
+        if(pid < 0)
+        {
+            perror("np: fork");
+            close(sv[0]);
+            close(sv[1]);
+            close(sp[0]);
+            close(sp[1]);
+            return false;
+        }
+
+        if(!pid)
+        {
+            /* fork server process */
+            runner_->reset_in_child();
+            close(sv[0]);
+            close(sp[0]);
+            control_fd_ = sv[1];
+            status_fd_ = sp[1];
+            if(tool_.length())
+            {
+                exec_valgrind();
+            }
+            serve();
+        }
+
+        /* runner process */
+        #if _NP_DEBUG
+        fprintf(stderr, "np: [%s] started fork server %d with %u workers%s%s\n",
+                np::util::rel_timestamp(), (int)pid, nworkers_,
+                (tool_.length() ? " under valgrind tool " : ""),
+                tool_.c_str());
+        #endif
+        close(sv[1]);
+        close(sp[1]);
+        control_fd_ = sv[0];
+        status_fd_ = sp[0];
+        fcntl(status_fd_, F_SETFL, O_NONBLOCK);
+        pid_ = pid;
+        return true;
+    }
+
+    void forkserver_t::stop()
+    {
+        int status;
+
+        if(pid_ <= 0)
+        {
+            return;
+        }
+
+        /* EOF on the control socket tells the fork server to
+         * clean up its idle workers and exit */
+        close(control_fd_);
+        control_fd_ = -1;
+        while(waitpid(pid_, &status, 0) < 0 && errno == EINTR)
+            ;
+        close(status_fd_);
+        status_fd_ = -1;
+        pid_ = 0;
+    }
+
+    /*
+     * Hand a job to an idle worker.  The fork server replies with the
+     * worker's pid, which is collected with get_dispatched() once the
+     * control socket is readable, so the runner isn't held up waiting
+     * for it.  Returns false if the request couldn't be sent.
+     */
+    bool forkserver_t::dispatch(const job_t *j, int event_fd,
+                                int out_fd, int err_fd)
+    {
+        forkserver_request_t req;
+        int fds[MAX_FDS];
+        int nfds = 0;
+
+        memset(&req, 0, sizeof(req));
+        req.node = j->get_node();
+        req.assign_index = j->get_assignment_index();
+        snprintf(req.name, sizeof(req.name), "%s",
+                 j->get_node()->get_fullname().c_str());
+
+        fds[nfds++] = event_fd;
+        if(out_fd >= 0)
+        {
+            fds[nfds++] = out_fd;
+            fds[nfds++] = err_fd;
+        }
+
+        if(!send_message(control_fd_, &req, sizeof(req), fds, nfds))
+        {
+            perror("np: sending to fork server");
+            return false;
+        }
+        return true;
+    }
+
+    /*
+     * Collect the fork server's reply to the oldest dispatch() not yet
+     * answered, without blocking.  Returns false if it hasn't arrived
+     * yet, otherwise true with the worker's pid, or -1 if the job
+     * couldn't be started, in *pidp.
+     */
+    bool forkserver_t::get_dispatched(pid_t *pidp)
+    {
+        ssize_t r;
+
+        do
+        {
+            r = recv(control_fd_, pidp, sizeof(*pidp), MSG_DONTWAIT);
+        } while(r < 0 && errno == EINTR);
+        if(r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            return false;
+        }
+        if(r != sizeof(*pidp))
+        {
+            fprintf(stderr, "np: no reply from fork server\n");
+            *pidp = -1;
+        }
+
+        #if _NP_DEBUG
+        fprintf(stderr, "np: [%s] fork server dispatched to worker %d\n",
+                np::util::rel_timestamp(), (int)*pidp);
+        #endif
+        return true;
+    }
+
+    /*
+     * Collect the exit status of a worker process reaped by the fork
+     * server.  Follows the wait4(WNOHANG) convention: returns the pid,
+     * 0 if no worker has exited, or -1 with errno set to ECHILD if the
+     * fork server has gone away.
+     */
+    pid_t forkserver_t::reap(int *statusp, struct rusage *rusagep)
+    {
+        forkserver_status_t st;
+        ssize_t r;
+
+        do
+        {
+            r = read(status_fd_, &st, sizeof(st));
+        } while(r < 0 && errno == EINTR);
+
+        if(r == sizeof(st))
+        {
+            *statusp = st.status;
+            *rusagep = st.rusage;
+            return st.pid;
+        }
+        if(r < 0 && errno == EAGAIN)
+        {
+            return 0;
+        }
+        /* EOF or a short read: fork server is dead */
+        errno = ECHILD;
+        return -1;
+    }
+
+    /*-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-*/
+
+    /*
+     * Called in the forked fork server process: run the test executable
+     * again under Valgrind, passing our end of the control socket and
+     * the status pipe through the exec.  The new process finds them in
+     * the environment and calls serve_exec() once it has discovered
+     * the tests.
+     */
+    void forkserver_t::exec_valgrind()
+    {
+        char buf[64];
+
+        fcntl(control_fd_, F_SETFD, 0);
+        fcntl(status_fd_, F_SETFD, 0);
+        snprintf(buf, sizeof(buf), "%d,%d,%u",
+                 control_fd_, status_fd_, nworkers_);
+        setenv(FORKSERVER_ENV, buf, 1);
+        np::exec_valgrind(tool_.c_str());
+    }
+
+    void forkserver_t::serve_exec(runner_t *r)
+    {
+        const char *env = getenv(FORKSERVER_ENV);
+        forkserver_t *fs;
+
+        if(!env)
+        {
+            return;
+        }
+
+        fs = new forkserver_t(r);
+        if(sscanf(env, "%d,%d,%u", &fs->control_fd_,
+                  &fs->status_fd_, &fs->nworkers_) != 3)
+        {
+            fprintf(stderr, "np: malformed %s=\"%s\"\n", FORKSERVER_ENV, env);
+            exit(1);
+        }
+        /* not for the tests to see */
+        unsetenv(FORKSERVER_ENV);
+        fs->exec_ = true;
+        /* begin() never ran in this process, but the tests'
+         * np_raise() and np_get_timeout() need the runner */
+        runner_t::running_ = r;
+        fs->serve();
+    }
+
+    void forkserver_t::serve()
+    {
+        struct sigaction sa;
+
+        if(pipe(sigchld_fds) < 0)
+        {
+            perror("np: pipe");
+            _exit(1);
+        }
+        fcntl(sigchld_fds[0], F_SETFL, O_NONBLOCK);
+        fcntl(sigchld_fds[1], F_SETFL, O_NONBLOCK);
+
+        memset(&sa, 0, sizeof(sa));
+        sa.sa_handler = handle_sigchld;
+        sigemptyset(&sa.sa_mask);
+        sa.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+        sigaction(SIGCHLD, &sa, NULL);
+
+        while(idle_pids_.size() < nworkers_ && spawn_worker())
+            ;
+
+        for(;;)
+        {
+            struct pollfd pfd[2];
+            memset(pfd, 0, sizeof(pfd));
+            pfd[0].fd = control_fd_;
+            pfd[0].events = POLLIN;
+            pfd[1].fd = sigchld_fds[0];
+            pfd[1].events = POLLIN;
+
+            int r = poll(pfd, 2, -1);
+            if(r < 0)
+            {
+                if(errno == EINTR)
+                {
+                    continue;
+                }
+                perror("np: poll");
+                shutdown();
+            }
+
+            if(pfd[1].revents & POLLIN)
+            {
+                char buf[64];
+                while(read(sigchld_fds[0], buf, sizeof(buf)) > 0)
+                    ;
+                reap_workers();
+            }
+            if(pfd[0].revents)
+            {
+                handle_request();
+            }
+        }
+    }
+
+    bool forkserver_t::spawn_worker()
+    {
+        int sv[2];
+        pid_t pid;
+
+        if(socketpair(AF_UNIX, SOCK_SEQPACKET, 0, sv) < 0)
+        {
+            perror("np: socketpair");
+            return false;
+        }
+
+        pid = fork();
+        if(pid < 0)
+        {
+            perror("np: fork");
+            close(sv[0]);
+            close(sv[1]);
+            return false;
+        }
+
+        if(!pid)
+        {
+            /* worker process */
+            close(sv[0]);
+            work(sv[1]);
+        }
+
+        close(sv[1]);
+        idle_pids_.push_back(pid);
+        idle_fds_.push_back(sv[0]);
+        return true;
+    }
+
+    void forkserver_t::handle_request()
+    {
+        forkserver_request_t req;
+        int fds[MAX_FDS];
+        int nfds;
+        pid_t pid = -1;
+
+        ssize_t r = recv_message(control_fd_, &req, sizeof(req), fds, &nfds);
+        if(r <= 0)
+        {
+            /* the runner closed its end: no more jobs */
+            shutdown();
+        }
+
+        if(r == sizeof(req) && nfds > 0)
+        {
+            if(idle_pids_.empty())
+            {
+                spawn_worker();
+            }
+            if(!idle_pids_.empty())
+            {
+                pid = idle_pids_.back();
+                int sock = idle_fds_.back();
+                idle_pids_.pop_back();
+                idle_fds_.pop_back();
+                if(!send_message(sock, &req, sizeof(req), fds, nfds))
+                {
+                    perror("np: sending to worker");
+                    kill(pid, SIGKILL);
+                    pid = -1;
+                }
+                close(sock);
+            }
+        }
+        for(int i = 0 ; i < nfds ; i++)
+        {
+            close(fds[i]);
+        }
+
+        send_message(control_fd_, &pid, sizeof(pid), 0, 0);
+
+        /* top the pool back up, now that the runner isn't waiting */
+        while(idle_pids_.size() < nworkers_ && spawn_worker())
+            ;
+    }
+
+    void forkserver_t::reap_workers()
+    {
+        for(;;)
+        {
+            int status;
+            struct rusage rusage;
+            pid_t pid = wait4(-1, &status, WNOHANG, &rusage);
+            if(pid <= 0)
+            {
+                break;
+            }
+
+            /* an idle worker died before being given a job */
+            vector<pid_t>::iterator itr;
+            for(itr = idle_pids_.begin() ; itr != idle_pids_.end() ; ++itr)
+            {
+                if(*itr == pid)
+                {
+                    break;
+                }
+            }
+            if(itr != idle_pids_.end())
+            {
+                unsigned int i = itr - idle_pids_.begin();
+                close(idle_fds_[i]);
+                idle_fds_.erase(idle_fds_.begin() + i);
+                idle_pids_.erase(itr);
+                continue;
+            }
+
+            forkserver_status_t st;
+            st.pid = pid;
+            st.status = status;
+            st.rusage = rusage;
+            if(write(status_fd_, &st, sizeof(st)) < 0)
+            {
+                perror("np: writing to runner");
+            }
+        }
+    }
+
+    void forkserver_t::shutdown()
+    {
+        int status;
+
+        /* EOF on their control sockets makes idle workers exit */
+        vector<int>::iterator itr;
+        for(itr = idle_fds_.begin() ; itr != idle_fds_.end() ; ++itr)
+        {
+            close(*itr);
+        }
+        idle_fds_.clear();
+        idle_pids_.clear();
+
+        signal(SIGCHLD, SIG_DFL);
+        while(waitpid(-1, &status, 0) > 0 || errno == EINTR)
+            ;
+        _exit(0);
+    }
+
+    void forkserver_t::work(int sock)
+    {
+        forkserver_request_t req;
+        int fds[MAX_FDS];
+        int nfds;
+
+        /* the worker doesn't need any of the fork server's descriptors */
+        signal(SIGCHLD, SIG_DFL);
+        close(sigchld_fds[0]);
+        close(sigchld_fds[1]);
+        close(control_fd_);
+        close(status_fd_);
+        vector<int>::iterator itr;
+        for(itr = idle_fds_.begin() ; itr != idle_fds_.end() ; ++itr)
+        {
+            close(*itr);
+        }
+        idle_fds_.clear();
+        idle_pids_.clear();
+
+        /* block until we're given a job */
+        ssize_t r = recv_message(sock, &req, sizeof(req), fds, &nfds);
+        if(r != sizeof(req) || nfds < 1)
+        {
+            /* the fork server is shutting down */
+            _exit(0);
+        }
+        close(sock);
+
+        if(nfds == MAX_FDS)
+        {
+            dup2(fds[1], STDOUT_FILENO);
+            close(fds[1]);
+            dup2(fds[2], STDERR_FILENO);
+            close(fds[2]);
+        }
+        testnode_t *node = req.node;
+        if(exec_)
+        {
+            req.name[sizeof(req.name)-1] = '\0';
+            node = testmanager_t::instance()->find_node(req.name);
+            if(!node)
+            {
+                fprintf(stderr, "np: fork server cannot find test %s\n", req.name);
+                _exit(1);
+            }
+        }
+        runner_->event_pipe_ = fds[0];
+        runner_->run_job(new job_t(node, req.assign_index));
+    }
+
+    // close the namespace
+};
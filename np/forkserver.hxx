@@ -0,0 +1,93 @@
+/*
+ * Copyright 2011-2012 Gregory Banks
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef __NP_FORKSERVER_H__
+#define __NP_FORKSERVER_H__ 1
+
+#include "np/util/common.hxx"
+#include <vector>
+#include <sys/resource.h>
+
+namespace np
+{
+
+    class runner_t;
+    class job_t;
+
+    /*
+     * The fork server is a process forked from the runner early,
+     * before the runner has accumulated any results, which keeps a
+     * pool of idle pre-forked worker processes.  Each worker blocks
+     * on a control socket until it's handed a job to run, so the
+     * cost of forking is paid off the runner's critical path and
+     * doesn't grow with the runner's memory footprint.  Worker exit
+     * statuses are reaped by the fork server and passed back to the
+     * runner over a pipe.
+     *
+     * When given a Valgrind tool, the fork server execs the test
+     * executable again under Valgrind, so that only the workers pay
+     * for the instrumentation and the runner's own test discovery
+     * and bookkeeping run natively.
+     */
+    class forkserver_t : public np::util::zalloc
+    {
+      public:
+        forkserver_t(runner_t *, const char *tool = 0);
+        ~forkserver_t();
+
+        bool start(unsigned int nworkers);
+        void stop();
+        /* called early in a fork server exec'd under Valgrind */
+        static void serve_exec(runner_t *);
+
+        /* called in the runner */
+        bool dispatch(const job_t *, int event_fd, int out_fd, int err_fd);
+        bool get_dispatched(pid_t *pidp);
+        pid_t reap(int *statusp, struct rusage *rusagep);
+        int get_control_fd() const
+        {
+            return control_fd_;
+        }
+        int get_status_fd() const
+        {
+            return status_fd_;
+        }
+
+      private:
+        /* called in the fork server */
+        void exec_valgrind() __attribute__((noreturn));
+        void serve() __attribute__((noreturn));
+        bool spawn_worker();
+        void reap_workers();
+        void handle_request();
+        void shutdown() __attribute__((noreturn));
+        /* called in the worker */
+        void work(int sock) __attribute__((noreturn));
+
+        runner_t *runner_;
+        std::string tool_;	/* Valgrind tool, empty to run natively */
+        bool exec_;		/* we are an exec'd fork server */
+        pid_t pid_;		/* of the fork server process */
+        int control_fd_;	/* socket between runner and fork server */
+        int status_fd_;		/* pipe from fork server to runner */
+        unsigned int nworkers_;
+        std::vector<pid_t> idle_pids_;	/* only in the fork server */
+        std::vector<int> idle_fds_;	/* only in the fork server */
+    };
+
+    // close the namespace
+};
+
+#endif /* __NP_FORKSERVER_H__ */
@@ -0,0 +1,112 @@
+/*
+ * Copyright 2011-2012 Gregory Banks
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "np/history.hxx"
+
+namespace np
+{
+    using namespace std;
+
+    history_t::history_t(const char *filename)
+        :  filename_(filename)
+    {
+    }
+
+    history_t::~history_t()
+    {
+    }
+
+    /*
+     * The file has one line per job, the duration in nanoseconds
+     * followed by a tab and the job name.  A missing file is fine,
+     * we just haven't run any tests yet.
+     */
+    bool history_t::load()
+    {
+        FILE *fp = fopen(filename_.c_str(), "r");
+        if(!fp)
+        {
+            if(errno == ENOENT)
+            {
+                return true;
+            }
+            perror(filename_.c_str());
+            return false;
+        }
+
+        char buf[4096];
+        while(fgets(buf, sizeof(buf), fp))
+        {
+            char *p = strchr(buf, '\n');
+            if(p)
+            {
+                *p = '\0';
+            }
+            char *name;
+            long long ns = strtoll(buf, &name, 10);
+            if(name == buf || *name != '\t' || ns < 0)
+            {
+                continue;   /* ignore garbage */
+            }
+            durations_[string(name + 1)] = ns;
+        }
+
+        fclose(fp);
+        return true;
+    }
+
+    bool history_t::save() const
+    {
+        /* write a new file and rename it into place, so that
+         * concurrent runs never see a partial file, nor write
+         * into each other's */
+        char pidbuf[32];
+        snprintf(pidbuf, sizeof(pidbuf), ".%d.tmp", (int)getpid());
+        string tmpfile = filename_ + pidbuf;
+        FILE *fp = fopen(tmpfile.c_str(), "w");
+        if(!fp)
+        {
+            perror(tmpfile.c_str());
+            return false;
+        }
+
+        map<string, int64_t>::const_iterator i;
+        for(i = durations_.begin() ; i != durations_.end() ; ++i)
+        {
+            fprintf(fp, "%lld\t%s\n", (long long)i->second, i->first.c_str());
+        }
+
+        if(fclose(fp) < 0 || rename(tmpfile.c_str(), filename_.c_str()) < 0)
+        {
+            perror(filename_.c_str());
+            unlink(tmpfile.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    int64_t history_t::get_duration(const string &name) const
+    {
+        map<string, int64_t>::const_iterator i = durations_.find(name);
+        return (i == durations_.end() ? -1 : i->second);
+    }
+
+    void history_t::set_duration(const string &name, int64_t ns)
+    {
+        durations_[name] = ns;
+    }
+
+    // close the namespace
+};
@@ -0,0 +1,52 @@
+/*
+ * Copyright 2011-2012 Gregory Banks
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef __NP_HISTORY_H__
+#define __NP_HISTORY_H__ 1
+
+#include "np/util/common.hxx"
+#include <string>
+#include <map>
+
+namespace np
+{
+
+    /*
+     * Remembers how long each test job took the last time it was
+     * run, keyed by the job's name, in a small text file.  The runner
+     * uses this to start the longest jobs first.
+     */
+    class history_t : public np::util::zalloc
+    {
+      public:
+        history_t(const char *filename);
+        ~history_t();
+
+        bool load();
+        bool save() const;
+
+        /* in nanoseconds, or -1 if the job is unknown */
+        int64_t get_duration(const std::string &name) const;
+        void set_duration(const std::string &name, int64_t ns);
+
+      private:
+        std::string filename_;
+        std::map<std::string, int64_t> durations_;
+    };
+
+    // close the namespace
+};
+
+#endif /* __NP_HISTORY_H__ */
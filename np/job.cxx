@@ -13,8 +13,6 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  */
-#include <sys/stat.h>
-#include <sys/fcntl.h>
 #include "np/job.hxx"
 
 namespace np
@@ -22,6 +20,55 @@ namespace np
     using namespace std;
     using namespace np::util;
 
+    usage_t::usage_t()
+    {
+        memset(this, 0, sizeof(*this));
+    }
+
+    usage_t::usage_t(const struct rusage &ru)
+        :  utime(ru.ru_utime.tv_sec * NANOSEC_PER_SEC + ru.ru_utime.tv_usec * 1000LL),
+           stime(ru.ru_stime.tv_sec * NANOSEC_PER_SEC + ru.ru_stime.tv_usec * 1000LL),
+           maxrss(ru.ru_maxrss),
+           minflt(ru.ru_minflt),
+           majflt(ru.ru_majflt),
+           nvcsw(ru.ru_nvcsw),
+           nivcsw(ru.ru_nivcsw),
+           inblock(ru.ru_inblock),
+           oublock(ru.ru_oublock)
+    {
+    }
+
+    usage_t usage_t::operator-(const usage_t &o) const
+    {
+        usage_t u;
+        u.utime = utime - o.utime;
+        u.stime = stime - o.stime;
+        u.maxrss = maxrss;
+        u.minflt = minflt - o.minflt;
+        u.majflt = majflt - o.majflt;
+        u.nvcsw = nvcsw - o.nvcsw;
+        u.nivcsw = nivcsw - o.nivcsw;
+        u.inblock = inblock - o.inblock;
+        u.oublock = oublock - o.oublock;
+        return u;
+    }
+
+    usage_t &usage_t::operator+=(const usage_t &o)
+    {
+        utime += o.utime;
+        stime += o.stime;
+        maxrss = (maxrss > o.maxrss ? maxrss : o.maxrss);
+        minflt += o.minflt;
+        majflt += o.majflt;
+        nvcsw += o.nvcsw;
+        nivcsw += o.nivcsw;
+        inblock += o.inblock;
+        oublock += o.oublock;
+        return *this;
+    }
+
+    /*-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-*/
+
     unsigned int job_t::next_id_ = 1;
 
     job_t::job_t(const plan_t::iterator &i)
@@ -31,16 +78,18 @@ namespace np
     {
     }
 
+    /* Reconstruct a job from the testnode and assignment
+     * index sent to a pre-forked worker process. */
+    job_t::job_t(testnode_t *tn, unsigned int assign_index)
+        :  id_(next_id_++),
+           node_(tn),
+           assigns_(tn->create_assignments())
+    {
+        set_index(assigns_, assign_index);
+    }
+
     job_t::~job_t()
     {
-        if(stdout_path_ != "")
-        {
-            unlink(stdout_path_.c_str());
-        }
-        if(stderr_path_ != "")
-        {
-            unlink(stderr_path_.c_str());
-        }
     }
 
     string job_t::as_string() const
@@ -62,6 +111,11 @@ namespace np
             return;
         }
 
+        /* usage so far, subtracted in post_run() */
+        struct rusage ru;
+        getrusage(RUSAGE_SELF, &ru);
+        usage_ = usage_t(ru);
+
         vector<testnode_t::assignment_t>::const_iterator i;
         for(i = assigns_.begin() ; i != assigns_.end() ; ++i)
         {
@@ -86,6 +140,10 @@ namespace np
         {
             i->unapply();
         }
+
+        struct rusage ru;
+        getrusage(RUSAGE_SELF, &ru);
+        set_usage(usage_t(ru) - usage_);
     }
 
     int64_t job_t::get_elapsed() const
@@ -98,51 +156,5 @@ namespace np
         return end - start_;
     }
 
-    static string get_file_contents(const string &path)
-    {
-        struct stat sb;
-        int r;
-        int fd;
-        int remain;
-        char *b;
-        string buf;
-
-        fd = open(path.c_str(), O_RDONLY, 0);
-        if(fd < 0)
-        {
-            perror(path.c_str());
-            return string("");
-        }
-
-        r = fstat(fd, &sb);
-        if(r < 0)
-        {
-            perror(path.c_str());
-            return string("");
-        }
-        buf.resize(sb.st_size);
-
-        remain = sb.st_size;
-        b = (char *)buf.c_str();
-        while(remain > 0 && (r = read(fd, b, remain)) > 0)
-        {
-            remain -= r;
-            b += r;
-        }
-
-        close(fd);
-        return buf;
-    }
-
-    string job_t::get_stdout() const
-    {
-        return get_file_contents(stdout_path_);
-    }
-
-    string job_t::get_stderr() const
-    {
-        return get_file_contents(stderr_path_);
-    }
-
     // close the namespace
 };
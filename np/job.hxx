@@ -19,14 +19,38 @@
 #include "np/util/common.hxx"
 #include "np/testnode.hxx"
 #include "np/plan.hxx"
+#include "np/capture.hxx"
+#include <sys/resource.h>
 
 namespace np
 {
 
+    /* Resources used by a job, from getrusage() or wait4() */
+    struct usage_t
+    {
+        int64_t utime;		/* user CPU time, in nanoseconds */
+        int64_t stime;		/* system CPU time, in nanoseconds */
+        long maxrss;		/* peak resident set, in KiB */
+        long minflt;		/* page faults without I/O */
+        long majflt;		/* page faults with I/O */
+        long nvcsw;		/* voluntary context switches */
+        long nivcsw;		/* involuntary context switches */
+        long inblock;		/* block input operations */
+        long oublock;		/* block output operations */
+
+        usage_t();
+        usage_t(const struct rusage &);
+
+        /* maxrss is a peak, so these keep the larger one */
+        usage_t operator-(const usage_t &) const;
+        usage_t &operator+=(const usage_t &);
+    };
+
     class job_t : public np::util::zalloc
     {
       public:
         job_t(const plan_t::iterator&);
+        job_t(testnode_t *, unsigned int assign_index);
         ~job_t();
 
         std::string as_string() const;
@@ -34,6 +58,10 @@ namespace np
         {
             return node_;
         }
+        unsigned int get_assignment_index() const
+        {
+            return get_index(assigns_);
+        }
         void pre_run(bool in_parent);
         void post_run(bool in_parent);
 
@@ -43,16 +71,33 @@ namespace np
         }
         int64_t get_elapsed() const;
 
-        void set_stdout_path(const char *path)
+        capture_t *get_stdout_capture()
+        {
+            return &stdout_;
+        }
+        capture_t *get_stderr_capture()
+        {
+            return &stderr_;
+        }
+        std::string get_stdout() const
+        {
+            return stdout_.get();
+        }
+        std::string get_stderr() const
+        {
+            return stderr_.get();
+        }
+
+        /* NULL if the resource usage isn't known */
+        const usage_t *get_usage() const
         {
-            stdout_path_ = std::string(path);
+            return (has_usage_ ? &usage_ : 0);
         }
-        void set_stderr_path(const char *path)
+        void set_usage(const usage_t &u)
         {
-            stderr_path_ = std::string(path);
+            usage_ = u;
+            has_usage_ = true;
         }
-        std::string get_stdout() const;
-        std::string get_stderr() const;
 
       private:
         static unsigned int next_id_;
@@ -62,8 +107,10 @@ namespace np
         std::vector<testnode_t::assignment_t> assigns_;
         int64_t start_;
         int64_t end_;
-        std::string stdout_path_;
-        std::string stderr_path_;
+        capture_t stdout_;
+        capture_t stderr_;
+        usage_t usage_;
+        bool has_usage_;
     };
 
     // close the namespace
@@ -54,6 +54,13 @@ namespace np
 #define s(x) ((const xmlChar *)(const char *)(x))
 #define ss(x) ((const xmlChar *)(x).c_str())
 
+    static void add_property(xmlNode *xprops, const char *name, const string &value)
+    {
+        xmlNode *xprop = xmlAddChild(xprops, xmlNewNode(NULL, s("property")));
+        xmlNewProp(xprop, s("name"), s(name));
+        xmlNewProp(xprop, s("value"), ss(value));
+    }
+
     void junit_listener_t::end()
     {
         string hostname = get_hostname();
@@ -108,6 +115,20 @@ namespace np
                 sns += c->elapsed_;
                 xmlNewProp(xcase, s("time"), ss(rel_format(c->elapsed_)));
 
+                if(c->has_usage_)
+                {
+                    xmlNode *xprops = xmlAddChild(xcase, xmlNewNode(NULL, s("properties")));
+                    add_property(xprops, "utime", rel_format(c->usage_.utime));
+                    add_property(xprops, "stime", rel_format(c->usage_.stime));
+                    add_property(xprops, "maxrss", dec(c->usage_.maxrss));
+                    add_property(xprops, "minflt", dec(c->usage_.minflt));
+                    add_property(xprops, "majflt", dec(c->usage_.majflt));
+                    add_property(xprops, "nvcsw", dec(c->usage_.nvcsw));
+                    add_property(xprops, "nivcsw", dec(c->usage_.nivcsw));
+                    add_property(xprops, "inblock", dec(c->usage_.inblock));
+                    add_property(xprops, "oublock", dec(c->usage_.oublock));
+                }
+
                 if(c->event_)
                 {
                     event_t *e = c->event_;
@@ -118,6 +139,12 @@ namespace np
                                                       "\n" +
                                                       e->get_long_location())));
                 }
+                if(c->result_ == R_ABORTED)
+                {
+                    /* killed by --fail-fast before it could finish */
+                    xmlNode *xskipped = xmlAddChild(xcase, xmlNewNode(NULL, s("skipped")));
+                    xmlNewProp(xskipped, s("message"), s("aborted"));
+                }
                 if(c->result_ == R_FAIL)
                 {
                     nerrs++;
@@ -174,6 +201,11 @@ namespace np
         c->elapsed_ = j->get_elapsed();
         c->stdout_ = j->get_stdout();
         c->stderr_ = j->get_stderr();
+        if(j->get_usage())
+        {
+            c->usage_ = *j->get_usage();
+            c->has_usage_ = true;
+        }
     }
 
     void junit_listener_t::add_event(const job_t *j, const event_t *ev)
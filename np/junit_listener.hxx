@@ -17,6 +17,7 @@
 #define __NP_JUNIT_LISTENER_H__ 1
 
 #include "np/listener.hxx"
+#include "np/job.hxx"
 
 namespace np
 {
@@ -42,7 +43,8 @@ namespace np
             case_t()
                 :  result_(R_UNKNOWN),
                    event_(0),
-                   elapsed_(0)
+                   elapsed_(0),
+                   has_usage_(false)
             { }
             ~case_t();
 
@@ -52,6 +54,8 @@ namespace np
             int64_t elapsed_;
             std::string stdout_;
             std::string stderr_;
+            usage_t usage_;
+            bool has_usage_;
         };
 
         struct suite_t
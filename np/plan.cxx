@@ -36,14 +36,41 @@ namespace np
         nodes_.push_back(tn);
     }
 
+    /*
+     * A spec with any glob characters, or between slashes, is a
+     * pattern which may select several nodes; any other is the
+     * full name of exactly one node.
+     */
+    static bool is_pattern(const char *spec)
+    {
+        size_t len = strlen(spec);
+        return (strpbrk(spec, "*?[") != 0 ||
+                (len > 2 && spec[0] == '/' && spec[len-1] == '/'));
+    }
+
     bool plan_t::add_specs(int nspec, const char **specs)
     {
-        testnode_t *tn;
+        testmanager_t *tm = testmanager_t::instance();
         int i;
 
         for(i = 0 ; i < nspec ; i++)
         {
-            tn = testmanager_t::instance()->find_node(specs[i]);
+            if(is_pattern(specs[i]))
+            {
+                vector<testnode_t *> found;
+                if(!tm->find_nodes(specs[i], found))
+                {
+                    return false;
+                }
+                vector<testnode_t *>::iterator j;
+                for(j = found.begin() ; j != found.end() ; ++j)
+                {
+                    add_node(*j);
+                }
+                continue;
+            }
+
+            testnode_t *tn = tm->find_node(specs[i]);
             if(!tn)
             {
                 return false;
@@ -53,6 +80,17 @@ namespace np
         return true;
     }
 
+    bool plan_t::set_shard(unsigned int shard, unsigned int nshards)
+    {
+        if(nshards < 1 || shard >= nshards)
+        {
+            return false;
+        }
+        shard_ = shard;
+        nshards_ = nshards;
+        return true;
+    }
+
     /*-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-*/
 
     plan_t::iterator::iterator(vector<testnode_t *>::iterator first,
@@ -98,6 +136,7 @@ namespace np
                 {
                     return;    // end of iteration
                 }
+                nitr_ = *vitr_;
             }
             if((*nitr_)->get_function(FT_TEST))
             {
@@ -142,7 +181,13 @@ namespace np
      * Add a sequence of test specifications to the plan object.  Each test
      * specification is a string which matches a testnode in the discovered
      * testnode hierarchy, and will cause that node (plus all of its
-     * descendant nodes) to be added to the plan.  The interface is designed to
+     * descendant nodes) to be added to the plan.  A specification
+     * containing any of the shell glob characters @c * @c ? or @c [
+     * is matched with @c fnmatch against the full names of all the
+     * testnodes, and one written between slashes, e.g. @c /^net\..*parse/
+     * is matched as a POSIX extended regular expression.  Either adds
+     * every matching testnode which is not below another matching one,
+     * in testnode traversal order.  The interface is designed to
      * take command-line arguments from your test runner program after
      * options have been parsed with @c getopt.  Alternately you can call
      * @c np_plan_add_specs multiple times.
@@ -159,6 +204,36 @@ namespace np
         return plan->add_specs(nspec, spec);
     }
 
+    /**
+     * Restrict the plan to one shard of the tests.  All the jobs the
+     * plan would otherwise run, counting each combination of parameter
+     * values as a separate job, are partitioned into @a nshards shards
+     * and only the jobs in shard @a shard are run.  The partition is
+     * deterministic, so running every shard once (e.g. on separate
+     * machines) runs every job exactly once.  When the runner has a
+     * history file with test durations, the shards are balanced by
+     * expected duration, otherwise by number of jobs.  Every shard
+     * must be run with the same history file, or none.
+     *
+     * A plan with a shard but no test specifications selects from all
+     * the discovered tests.
+     *
+     * @param plan      the plan object
+     * @param shard     which shard to run, counting from 1
+     * @param nshards   how many shards to partition the tests into
+     * @return      false if @a shard is not between 1 and @a nshards, true on success.
+     *
+     * \ingroup main
+     */
+    extern "C" bool np_plan_set_shard(np_plan_t *plan, int shard, int nshards)
+    {
+        if(shard < 1 || shard > nshards)
+        {
+            return false;
+        }
+        return plan->set_shard(shard-1, nshards);
+    }
+
 
     // close the namespace
 };
@@ -34,6 +34,20 @@ namespace np
 
         void add_node(testnode_t *tn);
         bool add_specs(int nspec, const char **specs);
+        bool is_empty() const
+        {
+            return !nodes_.size();
+        }
+
+        bool set_shard(unsigned int shard, unsigned int nshards);
+        unsigned int get_shard() const
+        {
+            return shard_;
+        }
+        unsigned int get_nshards() const
+        {
+            return nshards_;
+        }
 
         class iterator
         {
@@ -97,6 +111,8 @@ namespace np
 
       private:
         std::vector<testnode_t *> nodes_;
+        unsigned int shard_;	/* 0-based */
+        unsigned int nshards_;	/* 0 means not sharded */
     };
 
     // close the namespace
@@ -20,20 +20,21 @@
 namespace np
 {
 
-    enum proxy_call
-    {
-        PROXY_INVALID = 0,
-        PROXY_EVENT = 1,
-        PROXY_FINISHED = 2,
-    };
-
-    /*-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-*/
-
     static void serialise_uint(int fd, unsigned int i)
     {
         write(fd, &i, sizeof(i));
     }
 
+    static void serialise_usage(int fd, const usage_t *u)
+    {
+        usage_t zero;
+        if(!u)
+        {
+            u = &zero;
+        }
+        write(fd, u, sizeof(*u));
+    }
+
     static void serialise_string(int fd, const char *s)
     {
         unsigned int len = (s ? strlen(s) : 0);
@@ -149,6 +150,11 @@ namespace np
         return true;
     }
 
+    static bool deserialise_usage(int fd, usage_t *u)
+    {
+        return deserialise_bytes(fd, (char *)u, sizeof(*u));
+    }
+
     static void deserialise_event_cleanup(event_t *ev)
     {
         if(ev->description)
@@ -186,13 +192,15 @@ namespace np
 
     void proxy_listener_t::begin_job(const job_t *)
     {
+        /* only called when running a batch of jobs in one child */
+        serialise_uint(fd_, PROXY_BEGIN);
     }
 
-    void proxy_listener_t::end_job(const job_t *j __attribute__((unused)),
-                                   result_t res)
+    void proxy_listener_t::end_job(const job_t *j, result_t res)
     {
         serialise_uint(fd_, PROXY_FINISHED);
         serialise_uint(fd_, res);
+        serialise_usage(fd_, j->get_usage());
     }
 
     void proxy_listener_t::add_event(const job_t *j __attribute__((unused)),
@@ -205,16 +213,17 @@ namespace np
     /*-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-*/
 
     /*
-     * Handles input on the read end of the event pipe.  Returns false
-     * when we should stop calling it, which might be due to a normal
-     * end of test condition (FINISHED proxy call) or to some error.
-     * Updates *@resp if necessary.
+     * Handles input on the read end of the event pipe.  Returns the
+     * call handled: PROXY_EVENT means call me again, PROXY_BEGIN and
+     * PROXY_FINISHED mark the start and normal end of a test, and
+     * PROXY_INVALID indicates some error.  Updates *@resp if necessary.
      */
-    bool proxy_listener_t::handle_call(int fd, job_t *j, result_t *resp)
+    enum proxy_call proxy_listener_t::handle_call(int fd, job_t *j, result_t *resp)
     {
         unsigned int which = PROXY_INVALID;
         event_t ev;
         unsigned int res;
+        usage_t usage;
 
         #if _NP_DEBUG
         fprintf(stderr, "np: proxy_listener_t::handle_call()\n");
@@ -231,7 +240,7 @@ namespace np
                     {
                         *resp = merge(*resp, np::runner_t::running()->raise_event(j, &ev));
                         deserialise_event_cleanup(&ev);
-                        return true;  /* call me again */
+                        return PROXY_EVENT;  /* call me again */
                     }
                     deserialise_event_cleanup(&ev);
                     break;
@@ -239,12 +248,19 @@ namespace np
                     #if _NP_DEBUG
                     fprintf(stderr, "np: deserializing FINISHED\n");
                     #endif
-                    if(deserialise_uint(fd, &res))
+                    if(deserialise_uint(fd, &res) &&
+                       deserialise_usage(fd, &usage))
                     {
                         *resp = merge(*resp, (result_t)res);
-                        return false;         /* end of test, expect no more calls */
+                        j->set_usage(usage);
+                        return PROXY_FINISHED;    /* end of test */
                     }
                     break;
+                case PROXY_BEGIN:
+                    #if _NP_DEBUG
+                    fprintf(stderr, "np: deserializing BEGIN\n");
+                    #endif
+                    return PROXY_BEGIN;
                 default:
                     break;
             }
@@ -253,7 +269,7 @@ namespace np
         /* Decoding failed somehow so fail the test and tell the user */
         *resp = merge(*resp, R_FAIL);
         fprintf(stderr, "np: can't decode proxy call (which=%u)\n", which);
-        return false;
+        return PROXY_INVALID;
     }
 
     // close the namespace
@@ -22,6 +22,14 @@
 namespace np
 {
 
+    enum proxy_call
+    {
+        PROXY_INVALID = 0,
+        PROXY_EVENT = 1,
+        PROXY_FINISHED = 2,
+        PROXY_BEGIN = 3,
+    };
+
     class proxy_listener_t : public listener_t
     {
       public:
@@ -35,7 +43,7 @@ namespace np
         void add_event(const job_t *, const event_t *ev);
 
         /* proxyl.c */
-        static bool handle_call(int fd, job_t *, result_t *resp);
+        static enum proxy_call handle_call(int fd, job_t *, result_t *resp);
 
       private:
         int fd_;
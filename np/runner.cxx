@@ -21,9 +21,17 @@
 #include "np/proxy_listener.hxx"
 #include "np/junit_listener.hxx"
 #include "np/child.hxx"
+#include "np/forkserver.hxx"
+#include "np/snapshot.hxx"
+#include "np/history.hxx"
+#include <algorithm>
 #include "np/spiegel/spiegel.hxx"
 #include "np_priv.h"
 #include "except.h"
+#include <sys/epoll.h>
+#include <poll.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
 #if HAVE_VALGRIND
     #include <valgrind/memcheck.h>
 #endif
@@ -53,7 +61,7 @@ namespace np
 
     runner_t *runner_t::running_;
 
-    static int choose_timeout()
+    static int choose_timeout(bool valgrind_children __attribute__((unused)))
     {
         if(np::spiegel::platform::is_running_under_debugger())
         {
@@ -62,7 +70,7 @@ namespace np
         }
         int64_t timeout = 30;
         #if HAVE_VALGRIND
-        if(RUNNING_ON_VALGRIND)
+        if(RUNNING_ON_VALGRIND || valgrind_children)
         {
             timeout *= 3;
         }
@@ -70,15 +78,67 @@ namespace np
         return timeout;
     }
 
+    /*
+     * With NOVAPROVA_VALGRIND=children, np_init() leaves us running
+     * natively and we run only the test children under Valgrind.
+     */
+    extern bool is_running_under_sanitizer();
+
+    static bool choose_valgrind_children()
+    {
+        #if HAVE_VALGRIND
+        const char *env = getenv("NOVAPROVA_VALGRIND");
+        if(!env || strcmp(env, "children") || RUNNING_ON_VALGRIND ||
+           is_running_under_sanitizer())
+        {
+            return false;
+        }
+        if(np::spiegel::platform::is_running_under_debugger())
+        {
+            fprintf(stderr, "np: disabling Valgrind under debugger\n");
+            return false;
+        }
+        return true;
+        #else
+        return false;
+        #endif
+    }
+
+    static void watch_fd(int epfd, int fd)
+    {
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        if(epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) < 0)
+        {
+            perror("np: epoll_ctl");
+            exit(1);
+        }
+    }
+
     runner_t::runner_t()
     {
         maxchildren_ = 1;
-        timeout_ = choose_timeout();
+        batch_size_ = 1;
+        output_limit_ = 1024 * 1024;
+        valgrind_children_ = choose_valgrind_children();
+        timeout_ = choose_timeout(valgrind_children_);
+        epoll_fd_ = -1;
+        signal_fd_ = -1;
+        timer_fd_ = -1;
     }
 
     runner_t::~runner_t()
     {
         destroy_listeners();
+        delete history_;
+        if(epoll_fd_ >= 0)
+        {
+            close(epoll_fd_);
+            close(signal_fd_);
+            close(timer_fd_);
+        }
     }
 
     void runner_t::set_concurrency(int n)
@@ -95,6 +155,176 @@ namespace np
         maxchildren_ = n;
     }
 
+    void runner_t::set_history_file(const char *filename)
+    {
+        delete history_;
+        history_ = 0;
+        if(filename)
+        {
+            history_ = new history_t(filename);
+            history_->load();
+        }
+    }
+
+    struct planned_job_t
+    {
+        job_t *job_;
+        std::string name_;
+        unsigned int index_;	/* in plan order */
+        int64_t duration_;	/* expected, in nanoseconds */
+        unsigned int shard_;
+    };
+
+    static bool longer_first(const planned_job_t &a,
+                             const planned_job_t &b)
+    {
+        return a.duration_ > b.duration_;
+    }
+
+    static bool name_first(const planned_job_t &a,
+                           const planned_job_t &b)
+    {
+        return a.name_ < b.name_;
+    }
+
+    static bool plan_first(const planned_job_t &a,
+                           const planned_job_t &b)
+    {
+        return a.index_ < b.index_;
+    }
+
+    /*
+     * Expand the whole plan into @a res, in plan order, keeping only
+     * the jobs in our shard.  Jobs we have no history for are assumed
+     * to take the median time.
+     *
+     * The shards are dealt from the jobs sorted by name.  When the
+     * history file has durations, each job in turn from the longest
+     * goes to the shard with the least total expected time, or of
+     * those the fewest jobs.  Otherwise they are dealt round-robin, so
+     * the shards' sizes differ by at most one.  The partition depends
+     * only on the jobs and the history file, so every shard must be
+     * run with the same history file, or none.
+     */
+    void runner_t::plan_jobs(plan_t *plan, vector<planned_job_t> &res) const
+    {
+        vector<planned_job_t> jobs;
+        vector<int64_t> known;
+
+        plan_t::iterator pend = plan->end();
+        for(plan_t::iterator pitr = plan->begin() ; pitr != pend ; ++pitr)
+        {
+            planned_job_t pj;
+            pj.job_ = new job_t(pitr);
+            pj.name_ = pj.job_->as_string();
+            pj.index_ = jobs.size();
+            pj.duration_ = (history_ ? history_->get_duration(pj.name_) : -1);
+            pj.shard_ = 0;
+            if(pj.duration_ >= 0)
+            {
+                known.push_back(pj.duration_);
+            }
+            jobs.push_back(pj);
+        }
+
+        int64_t median = 0;
+        if(known.size())
+        {
+            nth_element(known.begin(), known.begin() + known.size()/2, known.end());
+            median = known[known.size()/2];
+        }
+
+        vector<planned_job_t>::iterator i;
+        for(i = jobs.begin() ; i != jobs.end() ; ++i)
+        {
+            if(i->duration_ < 0)
+            {
+                i->duration_ = median;
+            }
+        }
+
+        unsigned int nshards = plan->get_nshards();
+        if(nshards > 1)
+        {
+            sort(jobs.begin(), jobs.end(), name_first);
+            if(known.size())
+            {
+                /* stable, so that ties keep name order */
+                stable_sort(jobs.begin(), jobs.end(), longer_first);
+                vector<int64_t> load(nshards, 0);
+                vector<unsigned int> count(nshards, 0);
+                for(i = jobs.begin() ; i != jobs.end() ; ++i)
+                {
+                    unsigned int s = 0;
+                    for(unsigned int t = 1 ; t < nshards ; t++)
+                    {
+                        if(load[t] < load[s] ||
+                           (load[t] == load[s] && count[t] < count[s]))
+                        {
+                            s = t;
+                        }
+                    }
+                    i->shard_ = s;
+                    load[s] += i->duration_;
+                    count[s]++;
+                }
+            }
+            else
+            {
+                for(i = jobs.begin() ; i != jobs.end() ; ++i)
+                {
+                    i->shard_ = (i - jobs.begin()) % nshards;
+                }
+            }
+            sort(jobs.begin(), jobs.end(), plan_first);
+        }
+
+        for(i = jobs.begin() ; i != jobs.end() ; ++i)
+        {
+            if(i->shard_ == plan->get_shard())
+            {
+                res.push_back(*i);
+            }
+            else
+            {
+                delete i->job_;
+            }
+        }
+    }
+
+    /*
+     * Expand the whole plan into the pending queue up front.  We need
+     * to see every job to pick out our shard of them, and to start the
+     * jobs which took longest last time first, so that a long job
+     * doesn't start late and hold up the end of the run.
+     */
+    void runner_t::expand_plan(plan_t *plan)
+    {
+        vector<planned_job_t> jobs;
+        plan_jobs(plan, jobs);
+
+        /* stable, so that ties keep plan order */
+        if(history_)
+        {
+            stable_sort(jobs.begin(), jobs.end(), longer_first);
+        }
+
+        vector<planned_job_t>::iterator i;
+        for(i = jobs.begin() ; i != jobs.end() ; ++i)
+        {
+            pending_.push_back(i->job_);
+        }
+    }
+
+    void runner_t::set_batch_size(int n)
+    {
+        if(n < 1)
+        {
+            n = 1;
+        }
+        batch_size_ = n;
+    }
+
     void runner_t::list_tests(plan_t *plan) const
     {
         bool ourplan = false;
@@ -105,19 +335,24 @@ namespace np
             plan->add_node(testmanager_t::instance()->get_root());
             ourplan = true;
         }
+        else if(plan->is_empty())
+        {
+            plan->add_node(testmanager_t::instance()->get_root());
+        }
 
-        /* iterate over all tests */
+        /* iterate over all tests, or those with a job in our shard */
+        vector<planned_job_t> jobs;
+        plan_jobs(plan, jobs);
         testnode_t *tn = 0;
-        plan_t::iterator pitr = plan->begin();
-        plan_t::iterator pend = plan->end();
-        while(pitr != pend)
+        vector<planned_job_t>::iterator i;
+        for(i = jobs.begin() ; i != jobs.end() ; ++i)
         {
-            if(pitr.get_node() != tn)
+            if(i->job_->get_node() != tn)
             {
-                tn = pitr.get_node();
+                tn = i->job_->get_node();
                 printf("%s\n", tn->get_fullname().c_str());
             }
-            ++pitr;
+            delete i->job_;
         }
 
         if(ourplan)
@@ -136,28 +371,95 @@ namespace np
             plan->add_node(testmanager_t::instance()->get_root());
             ourplan = true;
         }
+        else if(plan->is_empty())
+        {
+            /* e.g. a plan which only selects a shard */
+            plan->add_node(testmanager_t::instance()->get_root());
+        }
 
         if(!listeners_.size())
         {
             add_listener(new text_listener_t);
         }
 
+        testmanager_t::instance()->prepare_for_fork();
         begin();
+        if(valgrind_children_)
+        {
+            /* each job is dispatched to the fork server for its
+             * Valgrind tool, which doesn't do batches */
+            batch_size_ = 1;
+        }
+        if(batch_size_ > 1)
+        {
+            /* record the pristine global state, before any test runs */
+            snapshot_ = new snapshot_t();
+            snapshot_->take();
+        }
+        else if(prefork_)
+        {
+            start_forkserver("");
+        }
         plan_t::iterator pitr = plan->begin();
         plan_t::iterator pend = plan->end();
+        if(history_ || plan->get_nshards() > 1)
+        {
+            expand_plan(plan);
+            pitr = pend;
+        }
         for(;;)
         {
-            while(children_.size() < maxchildren_ && pitr != pend)
+            while(!aborting_ &&
+                  children_.size() + ndispatching_ < maxchildren_ &&
+                  (pitr != pend || pending_.size()))
             {
-                begin_job(new job_t(pitr));
-                ++pitr;
+                /* jobs already queued, e.g. left over from
+                 * failed batches, go first */
+                vector<job_t *> batch;
+                while(batch.size() < batch_size_)
+                {
+                    if(pending_.size())
+                    {
+                        batch.push_back(pending_.front());
+                        pending_.pop_front();
+                    }
+                    else if(pitr != pend)
+                    {
+                        batch.push_back(new job_t(pitr));
+                        ++pitr;
+                    }
+                    else
+                    {
+                        break;
+                    }
+                }
+                begin_batch(batch);
             }
-            if(!children_.size())
+            if(!children_.size() && !ndispatching_)
             {
                 break;
             }
             wait();
         }
+        /* jobs never started because of --fail-fast */
+        while(pending_.size())
+        {
+            delete pending_.front();
+            pending_.pop_front();
+        }
+        aborting_ = false;
+        map<string, forkserver_t *>::iterator fitr;
+        for(fitr = forkservers_.begin() ; fitr != forkservers_.end() ; ++fitr)
+        {
+            delete fitr->second;
+        }
+        forkservers_.clear();
+        delete snapshot_;
+        snapshot_ = 0;
+        if(history_)
+        {
+            history_->save();
+        }
         end();
 
         if(ourplan)
@@ -193,20 +495,30 @@ namespace np
         listeners_.push_back(l);
     }
 
-    static volatile int caught_sigchld = 0;
-    static void handle_sigchld(int sig __attribute__((unused)))
-    {
-        caught_sigchld = 1;
-    }
-
     void runner_t::begin()
     {
-        static bool init = false;
-
-        if(!init)
+        if(epoll_fd_ < 0)
         {
-            signal(SIGCHLD, handle_sigchld);
-            init = true;
+            /*
+             * SIGCHLD stays blocked in the parent and is delivered
+             * through signalfd instead, so a child exiting just
+             * before we wait can never be missed.
+             */
+            sigset_t mask;
+            sigemptyset(&mask);
+            sigaddset(&mask, SIGCHLD);
+            sigprocmask(SIG_BLOCK, &mask, NULL);
+
+            epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+            signal_fd_ = signalfd(-1, &mask, SFD_NONBLOCK|SFD_CLOEXEC);
+            timer_fd_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK|TFD_CLOEXEC);
+            if(epoll_fd_ < 0 || signal_fd_ < 0 || timer_fd_ < 0)
+            {
+                perror("np: setting up event loop");
+                exit(1);
+            }
+            watch_fd(epoll_fd_, signal_fd_);
+            watch_fd(epoll_fd_, timer_fd_);
         }
 
         running_ = this;
@@ -219,6 +531,34 @@ namespace np
         running_ = 0;
     }
 
+    /* Called in a newly forked process which will run tests */
+    void runner_t::reset_in_child()
+    {
+        close(epoll_fd_);
+        close(signal_fd_);
+        close(timer_fd_);
+        epoll_fd_ = signal_fd_ = timer_fd_ = -1;
+
+        /* the read ends of other children's pipes */
+        unordered_map<int, child_t *>::iterator citr;
+        for(citr = event_fds_.begin() ; citr != event_fds_.end() ; ++citr)
+        {
+            close(citr->first);
+        }
+        event_fds_.clear();
+        unordered_map<int, capture_t *>::iterator oitr;
+        for(oitr = captures_.begin() ; oitr != captures_.end() ; ++oitr)
+        {
+            close(oitr->first);
+        }
+        captures_.clear();
+
+        sigset_t mask;
+        sigemptyset(&mask);
+        sigaddset(&mask, SIGCHLD);
+        sigprocmask(SIG_UNBLOCK, &mask, NULL);
+    }
+
 
     result_t runner_t::raise_event(job_t *j, const event_t *ev)
     {
@@ -228,19 +568,155 @@ namespace np
         return n_ev.get_result();
     }
 
-    static const char tmpfile_template[] = "/tmp/novaprova.out.XXXXXX";
-#define TMPFILE_MAX (sizeof(tmpfile_template))
+    /*
+     * Start a fork server for the given Valgrind tool, or a native
+     * one for "".  A failure is remembered so we don't keep retrying.
+     */
+    forkserver_t *runner_t::start_forkserver(const string &tool)
+    {
+        forkserver_t *fs = new forkserver_t(this, tool.c_str());
+        if(!fs->start(maxchildren_))
+        {
+            delete fs;
+            fs = 0;
+        }
+        else
+        {
+            /* the fork server tells us when workers exit */
+            watch_fd(epoll_fd_, fs->get_status_fd());
+        }
+        forkservers_[tool] = fs;
+        return fs;
+    }
+
+    /* The fork server which should run the job, or 0 to fork it here */
+    forkserver_t *runner_t::find_forkserver(const job_t *j)
+    {
+        string tool;
+
+        if(valgrind_children_)
+        {
+            tool = j->get_node()->get_valgrind_tool();
+            if(tool == "no")
+            {
+                tool = "";
+            }
+        }
+        map<string, forkserver_t *>::iterator itr = forkservers_.find(tool);
+        if(itr != forkservers_.end())
+        {
+            return itr->second;
+        }
+        if(tool == "")
+        {
+            /* without --prefork, native jobs are forked directly */
+            return 0;
+        }
+        forkserver_t *fs = start_forkserver(tool);
+        if(!fs)
+        {
+            fprintf(stderr, "np: cannot start valgrind tool %s for %s\n",
+                    tool.c_str(), j->as_string().c_str());
+            exit(1);
+        }
+        return fs;
+    }
+
+    bool runner_t::is_forkserver_fd(int fd) const
+    {
+        map<string, forkserver_t *>::const_iterator itr;
+        for(itr = forkservers_.begin() ; itr != forkservers_.end() ; ++itr)
+        {
+            if(itr->second && itr->second->get_status_fd() == fd)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /*
+     * Match the pids in the fork server's replies to the children
+     * we dispatched to it, which can then be timed out and reaped.
+     */
+    void runner_t::handle_dispatched(int control_fd)
+    {
+        map<int, deque<child_t *> >::iterator ditr = dispatching_.find(control_fd);
+        if(ditr == dispatching_.end())
+        {
+            return;
+        }
+        forkserver_t *fs = 0;
+        map<string, forkserver_t *>::iterator fitr;
+        for(fitr = forkservers_.begin() ; fitr != forkservers_.end() ; ++fitr)
+        {
+            if(fitr->second && fitr->second->get_control_fd() == control_fd)
+            {
+                fs = fitr->second;
+            }
+        }
+
+        deque<child_t *> &q = ditr->second;
+        pid_t pid;
+        while(q.size() && fs->get_dispatched(&pid))
+        {
+            child_t *child = q.front();
+            q.pop_front();
+            ndispatching_--;
+            if(pid < 0)
+            {
+                fprintf(stderr, "np: fork server failed to start %s\n",
+                        child->get_job()->as_string().c_str());
+                exit(1);
+            }
+            child->set_pid(pid);
+            children_[pid] = child;
+            if(aborting_)
+            {
+                /* too late, the run is being cut short */
+                child->abort(rel_now());
+            }
+            watch_deadline(child);
+        }
+        if(!q.size())
+        {
+            epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, control_fd, NULL);
+            dispatching_.erase(ditr);
+        }
+    }
+
+    /* Like wait4(WNOHANG), for workers reaped by any fork server */
+    pid_t runner_t::reap_forkservers(int *statusp, struct rusage *rusagep)
+    {
+        map<string, forkserver_t *>::iterator itr;
+        for(itr = forkservers_.begin() ; itr != forkservers_.end() ; ++itr)
+        {
+            if(itr->second)
+            {
+                /* a worker's pid reaches us before its exit status */
+                handle_dispatched(itr->second->get_control_fd());
+                pid_t pid = itr->second->reap(statusp, rusagep);
+                if(pid > 0)
+                {
+                    return pid;
+                }
+            }
+        }
+        return 0;
+    }
 
-    child_t *runner_t::fork_child(job_t *j)
+    child_t *runner_t::fork_child(const vector<job_t *> &batch)
     {
         pid_t pid;
 #define PIPE_READ 0
 #define PIPE_WRITE 1
         int pipefd[2];
-        int outfd = -1;
-        int errfd = -1;
-        char outpath[TMPFILE_MAX];
-        char errpath[TMPFILE_MAX];
+        vector<int> outfds;	/* write ends, for the child */
+        vector<int> errfds;
+        vector<int> outreadfds;	/* read ends, for us */
+        vector<int> errreadfds;
+        job_t *j = batch.front();
+        forkserver_t *forkserver = find_forkserver(j);
         child_t *child;
         int delay_ms = 10;
         int max_sleeps = 20;
@@ -253,26 +729,44 @@ namespace np
             exit(1);
         }
 
-        if(needs_stdout_)
+        /* Batched jobs' output goes through pipes even when no listener
+         * needs it, so that it can be passed on in step with the
+         * results instead of racing with them */
+        if(needs_stdout_ || batch.size() > 1)
         {
-            strcpy(outpath, tmpfile_template);
-            outfd = mkstemp(outpath);
-            if(outfd < 0)
+            /* every job in a batch gets its own output pipes */
+            for(unsigned int i = 0 ; i < batch.size() ; i++)
             {
-                perror(outpath);
-                exit(1);
+                int outpipe[2];
+                int errpipe[2];
+
+                if(pipe(outpipe) < 0 || pipe(errpipe) < 0)
+                {
+                    perror("np: pipe");
+                    exit(1);
+                }
+                outreadfds.push_back(outpipe[PIPE_READ]);
+                outfds.push_back(outpipe[PIPE_WRITE]);
+                errreadfds.push_back(errpipe[PIPE_READ]);
+                errfds.push_back(errpipe[PIPE_WRITE]);
             }
+        }
 
-            strcpy(errpath, tmpfile_template);
-            errfd = mkstemp(errpath);
-            if(errfd < 0)
+        if(forkserver)
+        {
+            /* hand the job to an already forked worker, whose
+             * pid we learn when the fork server replies */
+            if(!forkserver->dispatch(j, pipefd[PIPE_WRITE],
+                                     (needs_stdout_ ? outfds[0] : -1),
+                                     (needs_stdout_ ? errfds[0] : -1)))
             {
-                perror(errpath);
+                fprintf(stderr, "np: fork server failed to start %s\n",
+                        j->as_string().c_str());
                 exit(1);
             }
+            pid = 0;
         }
-
-        for(;;)
+        else for(;;)
         {
             pid = fork();
             if(pid < 0)
@@ -292,17 +786,30 @@ namespace np
             break;
         }
 
-        if(!pid)
+        if(!forkserver && !pid)
         {
             /* child process: return, will run the test */
+            reset_in_child();
             close(pipefd[PIPE_READ]);
             event_pipe_ = pipefd[PIPE_WRITE];
+            for(unsigned int i = 0 ; i < outreadfds.size() ; i++)
+            {
+                close(outreadfds[i]);
+                close(errreadfds[i]);
+            }
+            if(batch.size() > 1)
+            {
+                /* run_batch() will redirect before each job */
+                batch_outfds_ = outfds;
+                batch_errfds_ = errfds;
+                return NULL;
+            }
             if(needs_stdout_)
             {
-                dup2(outfd, STDOUT_FILENO);
-                close(outfd);
-                dup2(errfd, STDERR_FILENO);
-                close(errfd);
+                dup2(outfds[0], STDOUT_FILENO);
+                close(outfds[0]);
+                dup2(errfds[0], STDERR_FILENO);
+                close(errfds[0]);
             }
             return NULL;
         }
@@ -314,98 +821,205 @@ namespace np
                 (int)pid, j->as_string().c_str());
         #endif
         close(pipefd[PIPE_WRITE]);
-        child = new child_t(pid, pipefd[PIPE_READ], j);
-        if(timeout_)
+        if(batch.size() > 1)
         {
-            child->set_deadline(j->get_start() + timeout_ * NANOSEC_PER_SEC);
+            /* jobs will be started when the child says so */
+            child = new child_t(pid, pipefd[PIPE_READ], batch);
+            if(timeout_)
+            {
+                child->set_deadline(rel_now() + timeout_ * NANOSEC_PER_SEC);
+            }
         }
-        if(needs_stdout_)
+        else
         {
-            close(outfd);
-            close(errfd);
-            j->set_stdout_path(outpath);
-            j->set_stderr_path(errpath);
+            child = new child_t(pid, pipefd[PIPE_READ], j);
+            if(timeout_)
+            {
+                child->set_deadline(j->get_start() + timeout_ * NANOSEC_PER_SEC);
+            }
+        }
+        watch_fd(epoll_fd_, pipefd[PIPE_READ]);
+        event_fds_[pipefd[PIPE_READ]] = child;
+        for(unsigned int i = 0 ; i < outfds.size() ; i++)
+        {
+            close(outfds[i]);
+            close(errfds[i]);
+            watch_output(batch[i], outreadfds[i], errreadfds[i]);
+        }
+        if(forkserver)
+        {
+            /* the fork server answers requests in order */
+            deque<child_t *> &q = dispatching_[forkserver->get_control_fd()];
+            if(!q.size())
+            {
+                watch_fd(epoll_fd_, forkserver->get_control_fd());
+            }
+            q.push_back(child);
+            ndispatching_++;
+        }
+        else
+        {
+            children_[pid] = child;
+            watch_deadline(child);
         }
-        children_.push_back(child);
 
         return child;
 #undef PIPE_READ
 #undef PIPE_WRITE
     }
 
-    void runner_t::handle_events()
+    void runner_t::watch_output(job_t *j, int outfd, int errfd)
     {
-        int r;
-        unsigned int nzeroes = 0;
+        /* when no listener wants the output, copy it to ours */
+        j->get_stdout_capture()->attach(outfd, output_limit_,
+                                        (needs_stdout_ ? -1 : STDOUT_FILENO));
+        j->get_stderr_capture()->attach(errfd, output_limit_,
+                                        (needs_stdout_ ? -1 : STDERR_FILENO));
+        watch_fd(epoll_fd_, outfd);
+        watch_fd(epoll_fd_, errfd);
+        captures_[outfd] = j->get_stdout_capture();
+        captures_[errfd] = j->get_stderr_capture();
+    }
 
-        if(!children_.size())
+    void runner_t::drain_output(job_t *j)
+    {
+        capture_t *caps[2] = { j->get_stdout_capture(), j->get_stderr_capture() };
+        for(int i = 0 ; i < 2 ; i++)
         {
-            return;
+            if(caps[i]->get_fd() >= 0)
+            {
+                caps[i]->drain();
+            }
+            caps[i]->copy_out();
         }
+    }
 
-        while(!caught_sigchld)
+    /*
+     * Collect whatever output of the job is still in its pipes and
+     * stop watching them.  The child has either exited or flushed
+     * and moved on to its next job, so there's no more to come.
+     */
+    void runner_t::unwatch_output(job_t *j)
+    {
+        capture_t *caps[2] = { j->get_stdout_capture(), j->get_stderr_capture() };
+        for(int i = 0 ; i < 2 ; i++)
         {
-            int64_t start = rel_now();
-            int64_t timeout = -1;
-            pfd_.clear();
-            vector<child_t *>::iterator citr;
-            for(citr = children_.begin() ; citr != children_.end() ; ++citr)
+            int fd = caps[i]->get_fd();
+            if(fd < 0)
             {
-                struct pollfd p;
-                memset(&p, 0, sizeof(struct pollfd));
-                int fd = (*citr)->get_input_fd();
-                if(fd >= 0)
-                {
-                    p.fd = fd;
-                    p.events |= POLLIN;
-                }
-                pfd_.push_back(p);
-
-                int64_t deadline = (*citr)->get_deadline();
-                if(deadline)
-                {
-                    int64_t to = deadline - start;
-                    if(to <= 0)
-                    {
-                        timeout = 0;    /* already overdue */
-                    }
-                    else if(timeout < 0 || timeout > to)
-                    {
-                        timeout = to;
-                    }
-                }
+                continue;
             }
+            caps[i]->drain();
+            caps[i]->copy_out();
+            /* later children may share the pipe, so closing
+             * it doesn't necessarily remove it from epoll */
+            epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, NULL);
+            captures_.erase(fd);
+            caps[i]->detach();
+        }
+    }
+
+    /* Stop watching the child's event pipe, before it's deleted */
+    void runner_t::unwatch_child(child_t *child)
+    {
+        int fd = child->get_event_fd();
+        if(event_fds_.erase(fd))
+        {
+            epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, NULL);
+        }
+    }
+
+    void runner_t::watch_deadline(child_t *child)
+    {
+        int64_t deadline = child->get_deadline();
+        if(deadline)
+        {
+            deadlines_.push(deadline_t(deadline, child->get_pid()));
+        }
+    }
 
-            if(timeout == 0)
+    /*
+     * Set the timer to the earliest deadline of any child.  Entries
+     * in the heap are never updated in place: when a child's deadline
+     * changes a new entry is pushed, and stale ones are discarded here.
+     */
+    void runner_t::arm_timer()
+    {
+        struct itimerspec its;
+        memset(&its, 0, sizeof(its));
+
+        while(deadlines_.size())
+        {
+            const deadline_t &top = deadlines_.top();
+            unordered_map<pid_t, child_t *>::iterator itr = children_.find(top.second);
+            if(itr != children_.end() && itr->second->get_deadline() == top.first)
             {
-                if(++nzeroes > 5)
-                {
-                    timeout = NANOSEC_PER_SEC;
-                }
+                its.it_value.tv_sec = top.first / NANOSEC_PER_SEC;
+                its.it_value.tv_nsec = top.first % NANOSEC_PER_SEC;
+                break;
             }
-            else
+            deadlines_.pop();
+        }
+
+        /* a zero it_value disarms the timer */
+        if(timerfd_settime(timer_fd_, TFD_TIMER_ABSTIME, &its, NULL) < 0)
+        {
+            perror("np: timerfd_settime");
+        }
+    }
+
+    void runner_t::handle_timer()
+    {
+        uint64_t nexpiries;
+        if(read(timer_fd_, &nexpiries, sizeof(nexpiries)) < 0 && errno != EAGAIN)
+        {
+            perror("np: reading timerfd");
+        }
+
+        int64_t now = rel_now();
+        while(deadlines_.size() && deadlines_.top().first <= now)
+        {
+            deadline_t top = deadlines_.top();
+            deadlines_.pop();
+            unordered_map<pid_t, child_t *>::iterator itr = children_.find(top.second);
+            if(itr == children_.end() || itr->second->get_deadline() != top.first)
             {
-                nzeroes = 0;
+                continue;   /* stale */
             }
+            itr->second->handle_timeout(now);
+            watch_deadline(itr->second);
+        }
+    }
 
-            /* convert timeout for poll(): from nanosec to millisec
-             * and smash all negative values to -1 */
-            timeout = (timeout < 0 ? -1 : (timeout + 500000) / 1000000);
+    /*
+     * Wait for and handle events from children until there's
+     * at least one child to be reaped.
+     */
+    void runner_t::handle_events()
+    {
+        struct epoll_event events[64];
+        bool reapable = false;
+        int r;
+
+        if(!children_.size() && !ndispatching_)
+        {
+            return;
+        }
+
+        while(!reapable)
+        {
+            arm_timer();
 
             #if _NP_DEBUG
-            fprintf(stderr, "np: [%s] about to poll([%d fds] timeout=%lld msec)\n",
-                    rel_timestamp(), (int)pfd_.size(), (long long)timeout);
+            fprintf(stderr, "np: [%s] about to epoll_wait([%d children])\n",
+                    rel_timestamp(), (int)children_.size());
             #endif
-            r = poll(pfd_.data(), pfd_.size(), timeout);
+            r = epoll_wait(epoll_fd_, events, sizeof(events)/sizeof(events[0]), -1);
             #if _NP_DEBUG
             {
                 int e = errno;
-                fprintf(stderr, "np: [%s] poll returned %d errno %d(%s)\n",
+                fprintf(stderr, "np: [%s] epoll_wait returned %d errno %d(%s)\n",
                         rel_timestamp(), r, e, strerror(e));
-                vector<struct pollfd>::iterator pitr;
-                for(pitr = pfd_.begin() ; pitr != pfd_.end() ; ++pitr)
-                    fprintf(stderr, "np:     fd %d revents %d\n",
-                            pitr->fd, pitr->revents);
                 errno = e;
             }
             #endif
@@ -415,36 +1029,182 @@ namespace np
                 {
                     continue;
                 }
-                perror("np: poll");
-                return;
+                perror("np: epoll_wait");
+                break;
             }
-            if(r == 0)
+
+            for(int i = 0 ; i < r ; i++)
             {
-                /* poll() timed out */
-                int64_t end = rel_now();
-                for(citr = children_.begin() ; citr != children_.end() ; ++citr)
+                int fd = events[i].data.fd;
+                unordered_map<int, child_t *>::iterator citr;
+                unordered_map<int, capture_t *>::iterator oitr;
+                if(fd == signal_fd_)
                 {
-                    (*citr)->handle_timeout(end);
+                    struct signalfd_siginfo si;
+                    while(read(signal_fd_, &si, sizeof(si)) == sizeof(si))
+                        ;
+                    reapable = true;
                 }
-            }
-            else
-            {
-                /* poll indicated some fds are available */
-                vector<struct pollfd>::iterator pitr;
-                for(pitr = pfd_.begin(), citr = children_.begin() ;
-                        citr != children_.end() ; ++pitr, ++citr)
-                    if((pitr->revents & POLLIN))
+                else if(is_forkserver_fd(fd))
+                {
+                    reapable = true;
+                }
+                else if(dispatching_.find(fd) != dispatching_.end())
+                {
+                    handle_dispatched(fd);
+                }
+                else if(fd == timer_fd_)
+                {
+                    handle_timer();
+                }
+                else if((citr = event_fds_.find(fd)) != event_fds_.end())
+                {
+                    child_t *child = citr->second;
+                    if(events[i].events & EPOLLIN)
+                    {
+                        handle_input(child);
+                    }
+                    if(!(events[i].events & EPOLLIN) || child->get_input_fd() < 0)
+                    {
+                        /* Either the child has finished, or it closed
+                         * its end of the pipe without finishing and
+                         * we'll find out why when we reap it */
+                        unwatch_child(child);
+                    }
+                }
+                else if((oitr = captures_.find(fd)) != captures_.end())
+                {
+                    if(!oitr->second->drain())
                     {
-                        (*citr)->handle_input();
+                        /* EOF: keep what we have until the job ends */
+                        epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, NULL);
+                        captures_.erase(oitr);
                     }
+                }
+            }
+        }
+    }
+
+    void runner_t::handle_input(child_t *child)
+    {
+        /* the running job wrote any output it has before
+         * this event, so pass that on first */
+        if(child->is_job_started())
+        {
+            drain_output(child->get_job());
+        }
+        switch(child->handle_input())
+        {
+            case PROXY_BEGIN:
+            {
+                /* a batched child is starting its next job */
+                job_t *j = child->get_job();
+                dispatch_listeners(begin_job, j);
+                j->pre_run(true);
+                if(child->is_aborted())
+                {
+                    /* too late, it's already being killed */
+                    child->merge_result(R_ABORTED);
+                }
+                else if(timeout_)
+                {
+                    child->set_deadline(j->get_start() + timeout_ * NANOSEC_PER_SEC);
+                    watch_deadline(child);
+                }
+                break;
             }
+            case PROXY_FINISHED:
+                /* the last job is completed when the child is reaped */
+                if(child->get_njobs() > 1)
+                {
+                    complete_job(child);
+                    child->next_job();
+                }
+                break;
+            default:
+                break;
         }
     }
 
+    void runner_t::complete_job(child_t *child)
+    {
+        job_t *j = child->get_job();
+
+        unwatch_output(j);
+
+        /* test is finished; if nothing went wrong then PASS */
+        child->merge_result(np::R_PASS);
+
+        /* notify listeners */
+        nfailed_ += (child->get_result() == R_FAIL);
+        nrun_++;
+        j->post_run(true);
+        /* a job cut short by a timeout or --fail-fast didn't
+         * run for as long as it needs, so don't remember that */
+        if(history_ && child->get_result() != R_ABORTED &&
+                !child->is_aborted() && !child->is_timed_out())
+        {
+            history_->set_duration(j->as_string(), j->get_elapsed());
+        }
+        dispatch_listeners(end_job, j, child->get_result());
+
+        if(fail_fast_ && nfailed_ >= fail_fast_ && !aborting_)
+        {
+            abort_children();
+        }
+    }
+
+    /*
+     * Enough tests have failed that the rest of the run isn't worth
+     * the time: stop starting jobs and kill the children running them.
+     */
+    void runner_t::abort_children()
+    {
+        #if _NP_DEBUG
+        fprintf(stderr, "np: [%s] %u failures, aborting\n",
+                rel_timestamp(), nfailed_);
+        #endif
+        aborting_ = true;
+        int64_t now = rel_now();
+        unordered_map<pid_t, child_t *>::iterator itr;
+        for(itr = children_.begin() ; itr != children_.end() ; ++itr)
+        {
+            itr->second->abort(now);
+            watch_deadline(itr->second);
+        }
+    }
+
+    /*
+     * Forget a reaped child.  Any jobs it didn't get to, e.g. the rest
+     * of a batch after a crash or timeout, are run in fresh children
+     * unless we're aborting.
+     */
+    void runner_t::remove_child(child_t *child)
+    {
+        unwatch_child(child);
+        vector<job_t *> jobs = child->take_jobs();
+        vector<job_t *>::iterator i;
+        for(i = jobs.begin() ; i != jobs.end() ; ++i)
+        {
+            unwatch_output(*i);
+            if(aborting_)
+            {
+                delete *i;
+            }
+        }
+        if(!aborting_)
+        {
+            pending_.insert(pending_.begin(), jobs.begin(), jobs.end());
+        }
+        children_.erase(child->get_pid());
+        delete child;
+    }
+
     void runner_t::reap_children()
     {
         pid_t pid;
         int status;
+        struct rusage rusage;
         char msg[1024];
 
         #if _NP_DEBUG
@@ -454,14 +1214,19 @@ namespace np
         for(;;)
         {
             #if _NP_DEBUG > 1
-            fprintf(stderr, "np: [%s] about to call waitpid\n",
+            fprintf(stderr, "np: [%s] about to call wait4\n",
                     rel_timestamp());
             #endif
-            pid = waitpid(-1, &status, WNOHANG);
+            pid = reap_forkservers(&status, &rusage);
+            if(!pid)
+            {
+                /* our own children, including any fork servers */
+                pid = wait4(-1, &status, WNOHANG, &rusage);
+            }
             #if _NP_DEBUG > 1
             {
                 int e = errno;
-                fprintf(stderr, "np: [%s] waitpid returns %d, errno %d(%s)\n",
+                fprintf(stderr, "np: [%s] wait4 returns %d, errno %d(%s)\n",
                         rel_timestamp(), (int)pid, e, strerror(errno));
                 errno = e;
             }
@@ -476,7 +1241,7 @@ namespace np
                 {
                     break;
                 }
-                perror("np: waitpid");
+                perror("np: wait4");
                 return;
             }
             if(WIFSTOPPED(status))
@@ -489,11 +1254,7 @@ namespace np
             fprintf(stderr, "np: [%s] reaped process %d\n",
                     rel_timestamp(), (int)pid);
             #endif
-            vector<child_t *>::iterator itr;
-            for(itr = children_.begin() ;
-                    itr != children_.end() && (*itr)->get_pid() != pid ;
-                    ++itr)
-                ;
+            unordered_map<pid_t, child_t *>::iterator itr = children_.find(pid);
             if(itr == children_.end())
             {
                 /* some other process */
@@ -501,9 +1262,35 @@ namespace np
                 /* TODO: this is probably eventworthy */
                 continue;       /* whatever */
             }
-            child_t *child = *itr;
+            child_t *child = itr->second;
+
+            /* The child can exit before we've read everything it
+             * wrote, e.g. the start and end of the last job in a
+             * batch, so catch up before deciding what happened */
+            struct pollfd pfd;
+            pfd.fd = child->get_event_fd();
+            pfd.events = POLLIN;
+            while(child->get_input_fd() >= 0 &&
+                  poll(&pfd, 1, 0) > 0 &&
+                  (pfd.revents & POLLIN))
+            {
+                handle_input(child);
+            }
+
+            if(!child->is_job_started())
+            {
+                /* A batched child stopped between jobs, after a test
+                 * failed or because something went wrong: re-run the
+                 * rest of its batch in fresh children */
+                remove_child(child);
+                continue;
+            }
 
-            if(WIFEXITED(status))
+            if(child->is_aborted())
+            {
+                /* we killed it, don't blame the test */
+            }
+            else if(WIFEXITED(status))
             {
                 if(WEXITSTATUS(status))
                 {
@@ -523,51 +1310,35 @@ namespace np
                 child->merge_result(raise_event(child->get_job(), &ev));
             }
 
-            /* test is finished; if nothing went wrong then PASS */
-            child->merge_result(np::R_PASS);
-
-            /* notify listeners */
-            nfailed_ += (child->get_result() == R_FAIL);
-            nrun_++;
-            child->get_job()->post_run(true);
-            dispatch_listeners(end_job, child->get_job(), child->get_result());
+            child->charge_usage(usage_t(rusage));
+            complete_job(child);
+            child->next_job();
 
             /* detach and clean up */
-            children_.erase(itr);
-            delete child;
+            remove_child(child);
         }
 
-        caught_sigchld = 0;
         /* nothing to reap here, move along */
     }
 
-    void runner_t::run_function(functype_t ft, np::spiegel::function_t *f)
+    void runner_t::run_function(functype_t ft, testfunc_t *f)
     {
-        vector<np::spiegel::value_t> args;
-        np::spiegel::value_t ret = f->invoke(args);
+        int r = f->invoke();
 
-        if(ft == FT_TEST)
+        if(ft != FT_TEST && r)
         {
-            assert(ret.which == np::spiegel::type_t::TC_VOID);
-        }
-        else
-        {
-            assert(ret.which == np::spiegel::type_t::TC_SIGNED_LONG_LONG);
-            int r = ret.val.vsint;
-
-            if(r)
-            {
-                static char cond[64];
-                snprintf(cond, sizeof(cond), "fixture returned %d", r);
-                np_throw(event_t(EV_FIXTURE, cond).in_function(f));
-            }
+            static char cond[64];
+            snprintf(cond, sizeof(cond), "fixture returned %d", r);
+            np_throw(event_t(EV_FIXTURE, cond)
+                        .in_file(f->get_filename())
+                        .in_function(f->get_name()));
         }
     }
 
     void runner_t::run_fixtures(testnode_t *tn, functype_t type)
     {
-        list<np::spiegel::function_t *> fixtures = tn->get_fixtures(type);
-        list<np::spiegel::function_t *>::iterator itr;
+        list<testfunc_t *> fixtures = tn->get_fixtures(type);
+        list<testfunc_t *>::iterator itr;
         for(itr = fixtures.begin() ; itr != fixtures.end() ; ++itr)
         {
             run_function(type, *itr);
@@ -584,8 +1355,11 @@ namespace np
         unsigned long nerrors;
         char msg[1024];
 
-        VALGRIND_DO_LEAK_CHECK;
-        VALGRIND_COUNT_LEAKS(leaked, dubious, reachable, suppressed);
+        if(j->get_node()->get_leak_check())
+        {
+            VALGRIND_DO_LEAK_CHECK;
+            VALGRIND_COUNT_LEAKS(leaked, dubious, reachable, suppressed);
+        }
         if(leaked)
         {
             snprintf(msg, sizeof(msg),
@@ -607,6 +1381,20 @@ namespace np
         return res;
     }
 
+    extern void init_sanitizer_hooks();
+    extern bool sanitizer_leak_check();
+
+    result_t runner_t::sanitizer_errors(job_t *j, result_t res)
+    {
+        if(j->get_node()->get_leak_check() && sanitizer_leak_check())
+        {
+            /* LeakSanitizer has printed the details to stderr */
+            event_t ev(EV_SANITIZER, "memory leaked, found by LeakSanitizer");
+            res = merge(res, raise_event(j, &ev));
+        }
+        return res;
+    }
+
     result_t runner_t::descriptor_leaks(job_t *j, const vector<string> &prefds, result_t res)
     {
         vector<string> postfds = np::spiegel::platform::get_file_descriptors();
@@ -651,6 +1439,7 @@ namespace np
         event_t *ev;
 
         j->pre_run(false);
+        init_sanitizer_hooks();
 
         vector<string> prefds = np::spiegel::platform::get_file_descriptors();
 
@@ -697,6 +1486,7 @@ namespace np
         prefds.clear();
 
         res = valgrind_errors(j, res);
+        res = sanitizer_errors(j, res);
 
         return res;
     }
@@ -705,7 +1495,6 @@ namespace np
     void runner_t::begin_job(job_t *j)
     {
         child_t *child;
-        result_t res;
 
         //     {
         //  static int n = 0;
@@ -721,13 +1510,20 @@ namespace np
         dispatch_listeners(begin_job, j);
         j->pre_run(true);
 
-        child = fork_child(j);
+        child = fork_child(vector<job_t *>(1, j));
         if(child)
         {
             return;    /* parent process */
         }
 
         /* child process */
+        run_job(j);
+    }
+
+    void runner_t::run_job(job_t *j)
+    {
+        result_t res;
+
         set_listener(new proxy_listener_t(event_pipe_));
         res = run_test_code(j);
         dispatch_listeners(end_job, j, res);
@@ -739,6 +1535,81 @@ namespace np
         exit(0);
     }
 
+    void runner_t::begin_batch(const vector<job_t *> &batch)
+    {
+        child_t *child;
+
+        if(batch.size() == 1)
+        {
+            begin_job(batch.front());
+            return;
+        }
+
+        #if _NP_DEBUG
+        fprintf(stderr, "np: [%s] begin batch of %u jobs starting with %s\n",
+                rel_timestamp(), (unsigned)batch.size(),
+                batch.front()->as_string().c_str());
+        #endif
+
+        child = fork_child(batch);
+        if(child)
+        {
+            return;    /* parent process */
+        }
+
+        /* child process */
+        run_batch(batch);
+    }
+
+    extern void reset_syslog_matches();
+
+    void runner_t::run_batch(const vector<job_t *> &batch)
+    {
+        result_t res;
+
+        set_listener(new proxy_listener_t(event_pipe_));
+        for(unsigned int i = 0 ; i < batch.size() ; i++)
+        {
+            job_t *j = batch[i];
+
+            if(i)
+            {
+                /* undo whatever the previous test did */
+                snapshot_->restore();
+                reset_syslog_matches();
+            }
+            if(batch_outfds_.size())
+            {
+                fflush(stdout);
+                fflush(stderr);
+                dup2(batch_outfds_[i], STDOUT_FILENO);
+                close(batch_outfds_[i]);
+                dup2(batch_errfds_[i], STDERR_FILENO);
+                close(batch_errfds_[i]);
+            }
+
+            dispatch_listeners(begin_job, j);
+            res = run_test_code(j);
+            /* the runner collects the job's output when it ends */
+            fflush(stdout);
+            fflush(stderr);
+            dispatch_listeners(end_job, j, res);
+            #if _NP_DEBUG
+            fprintf(stderr, "np: [%s] child process %d (%s) finished\n",
+                    rel_timestamp(), (int)getpid(), j->as_string().c_str());
+            #endif
+
+            if(res == R_FAIL)
+            {
+                /* The test may have left the process in a state we
+                 * can't repair, so stop here and let the runner give
+                 * the rest of the batch to a fresh child */
+                break;
+            }
+        }
+        exit(0);
+    }
+
     void runner_t::wait()
     {
         handle_events();
@@ -770,6 +1641,106 @@ extern "C" void np_set_concurrency(np_runner_t *runner, int n)
     runner->set_concurrency(n);
 }
 
+/**
+ * Set a file for recording how long each test job takes
+ *
+ * @param runner    the runner object
+ * @param filename  name of the history file, or NULL
+ *
+ * The file is read before the tests are run, and rewritten with the
+ * new durations afterwards.  When a history file is set, test jobs
+ * are started longest first instead of in testnode tree order, which
+ * shortens the total time taken when running tests in parallel.  Jobs
+ * which are not in the history file are assumed to take the median
+ * time.  By default no history file is used.
+ *
+ * \ingroup main
+ */
+extern "C" void np_set_history_file(np_runner_t *runner, const char *filename)
+{
+    runner->set_history_file(filename);
+}
+
+/**
+ * Set how much of each test's output is kept
+ *
+ * @param runner    the runner object
+ * @param nbytes    maximum bytes kept of each of stdout and stderr, or 0
+ *
+ * When an output format needs the output of tests, e.g. the junit
+ * format, at most @a nbytes bytes are kept from each of a test's
+ * stdout and stderr: the first and last @a nbytes/2 bytes, with a
+ * note in between saying how many bytes were left out.  Zero means
+ * keep all the output.  The default is 1 MiB.
+ *
+ * \ingroup main
+ */
+extern "C" void np_set_output_limit(np_runner_t *runner, unsigned long nbytes)
+{
+    runner->set_output_limit(nbytes);
+}
+
+/**
+ * Stop running tests after some number of failures
+ *
+ * @param runner    the runner object
+ * @param n         number of failed test jobs after which to stop, or 0
+ *
+ * Once @a n test jobs have failed, no more jobs are started and any
+ * jobs still running are killed, and reported to listeners with an
+ * ABORTED result which does not count as a failure.  This is useful
+ * when all you need to know is whether any test fails.  The default
+ * value is 0, meaning all the tests are run regardless of failures.
+ *
+ * \ingroup main
+ */
+extern "C" void np_set_fail_fast(np_runner_t *runner, int n)
+{
+    runner->set_fail_fast(n);
+}
+
+/**
+ * Set the number of test jobs run in each child process
+ *
+ * @param runner    the runner object
+ * @param n     maximum number of jobs per child process
+ *
+ * When @a n is greater than 1, each child process runs up to @a n test
+ * jobs in sequence instead of just one, which greatly reduces the
+ * number of processes forked when running many short tests.  Between
+ * jobs the child resets all the writable global and static variables
+ * of the Code Under Test and the test code to their initial values,
+ * using the DWARF debug information.  If a test fails, crashes or
+ * times out, the remaining jobs in the batch are run in a fresh child
+ * process.  The default value is 1, meaning every test job is run in
+ * its own child process.
+ *
+ * \ingroup main
+ */
+extern "C" void np_set_batch_size(np_runner_t *runner, int n)
+{
+    runner->set_batch_size(n);
+}
+
+/**
+ * Set whether test jobs are run in pre-forked worker processes
+ *
+ * @param runner    the runner object
+ * @param b     true to use pre-forked workers
+ *
+ * When enabled, a fork server process is started after test discovery
+ * and keeps a pool of idle worker processes ready to run test jobs, so
+ * that the cost of forking a process per test is paid ahead of time.
+ * The default is false, meaning a new process is forked from the
+ * runner for each test job.
+ *
+ * \ingroup main
+ */
+extern "C" void np_set_prefork(np_runner_t *runner, bool b)
+{
+    runner->set_prefork(b);
+}
+
 /**
  * Print the names of the tests in the plan to stdout.
  *
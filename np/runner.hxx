@@ -18,15 +18,11 @@
 
 #include "np/util/common.hxx"
 #include "np/types.hxx"
+#include "np/plan.hxx"
 #include <vector>
-
-namespace np
-{
-    namespace spiegel
-    {
-        class function_t;
-    };
-};
+#include <deque>
+#include <queue>
+#include <map>
 
 namespace np
 {
@@ -36,7 +32,13 @@ namespace np
     class plan_t;
     class child_t;
     class testnode_t;
+    class testfunc_t;
     class job_t;
+    class forkserver_t;
+    class snapshot_t;
+    class history_t;
+    class capture_t;
+    struct planned_job_t;
 
     class runner_t : public np::util::zalloc
     {
@@ -45,6 +47,20 @@ namespace np
         ~runner_t();
 
         void set_concurrency(int n);
+        void set_prefork(bool b)
+        {
+            prefork_ = b;
+        }
+        void set_batch_size(int n);
+        void set_history_file(const char *filename);
+        void set_output_limit(size_t n)
+        {
+            output_limit_ = n;
+        }
+        void set_fail_fast(int n)
+        {
+            fail_fast_ = (n < 0 ? 0 : n);
+        }
         void add_listener(listener_t *);
         void list_tests(plan_t *) const;
         int run_tests(plan_t *);
@@ -60,20 +76,45 @@ namespace np
 
       private:
         void destroy_listeners();
+        void plan_jobs(plan_t *plan, std::vector<planned_job_t> &res) const;
+        void expand_plan(plan_t *plan);
         void begin();
         void end();
+        void reset_in_child();
         void set_listener(listener_t *);
-        child_t *fork_child(job_t *);
+        forkserver_t *start_forkserver(const std::string &tool);
+        forkserver_t *find_forkserver(const job_t *);
+        bool is_forkserver_fd(int fd) const;
+        void handle_dispatched(int control_fd);
+        pid_t reap_forkservers(int *statusp, struct rusage *rusagep);
+        child_t *fork_child(const std::vector<job_t *> &);
         void handle_events();
+        void watch_deadline(child_t *);
+        void watch_output(job_t *, int outfd, int errfd);
+        void drain_output(job_t *);
+        void unwatch_output(job_t *);
+        void unwatch_child(child_t *);
+        void arm_timer();
+        void handle_timer();
+        void handle_input(child_t *);
+        void complete_job(child_t *);
+        void abort_children();
+        void remove_child(child_t *);
         void reap_children();
-        void run_function(functype_t ft, spiegel::function_t *f);
+        void run_function(functype_t ft, testfunc_t *f);
         void run_fixtures(testnode_t *tn, functype_t type);
         result_t valgrind_errors(job_t *, result_t);
+        result_t sanitizer_errors(job_t *, result_t);
         result_t descriptor_leaks(job_t *j, const std::vector<std::string>& prefds, result_t res);
         result_t run_test_code(job_t *);
         void begin_job(job_t *);
+        void begin_batch(const std::vector<job_t *> &);
+        void run_job(job_t *) __attribute__((noreturn));
+        void run_batch(const std::vector<job_t *> &) __attribute__((noreturn));
         void wait();
 
+        friend class forkserver_t;
+
         static runner_t *running_;
 
         /* runtime state */
@@ -81,11 +122,37 @@ namespace np
         unsigned int nrun_;
         unsigned int nfailed_;
         int event_pipe_;		/* only in child processes */
-        std::vector<child_t *> children_;	// only in the parent process
+        /* only in the parent process */
+        np::util::unordered_map<pid_t, child_t *> children_;
         unsigned int maxchildren_;
-        std::vector<struct pollfd> pfd_;
+        int epoll_fd_;
+        int signal_fd_;		/* reports SIGCHLD */
+        int timer_fd_;		/* fires at the earliest child deadline */
+        typedef std::pair<int64_t, pid_t> deadline_t;
+        std::priority_queue<deadline_t, std::vector<deadline_t>,
+                            std::greater<deadline_t> > deadlines_;
         int timeout_;	/* in seconds, 0 to disable */
         bool needs_stdout_;
+        size_t output_limit_;	/* per stream per job, 0 for unlimited */
+        /* epoll watches these, by fd, only in the parent process */
+        np::util::unordered_map<int, child_t *> event_fds_;
+        np::util::unordered_map<int, capture_t *> captures_;
+        bool prefork_;
+        bool valgrind_children_;	/* only children run under Valgrind */
+        /* by Valgrind tool, "" runs natively; only in the parent process */
+        std::map<std::string, forkserver_t *> forkservers_;
+        /* children dispatched to a fork server whose pid we don't
+         * know yet, by the fork server's control socket */
+        std::map<int, std::deque<child_t *> > dispatching_;
+        unsigned int ndispatching_;
+        unsigned int batch_size_;	/* max jobs per child process */
+        std::deque<job_t *> pending_;
+        snapshot_t *snapshot_;
+        history_t *history_;
+        unsigned int fail_fast_;	/* stop after this many failures, 0 never */
+        bool aborting_;
+        std::vector<int> batch_outfds_;	/* only in child processes */
+        std::vector<int> batch_errfds_;	/* only in child processes */
     };
 
 #define np_raise(ev) \
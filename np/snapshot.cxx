@@ -0,0 +1,162 @@
+/*
+ * Copyright 2011-2012 Gregory Banks
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "np/snapshot.hxx"
+#include "np/spiegel/spiegel.hxx"
+#include "np/spiegel/dwarf/state.hxx"
+#include "np/spiegel/dwarf/compile_unit.hxx"
+#include "np/spiegel/platform/common.hxx"
+#include "np_priv.h"
+#include <algorithm>
+
+namespace np
+{
+    using namespace std;
+    using namespace np::util;
+    using np::spiegel::addr_t;
+
+    /*
+     * Whether the unit is one of the library's own.  Those were all
+     * compiled in the library's top directory, the one this unit was
+     * compiled in, from sources inside it.  Units compiled anywhere
+     * else, or from outside that tree, are the tests or the Code
+     * Under Test, whatever their functions are called.
+     */
+    static bool is_our_unit(const np::spiegel::compile_unit_t *cu,
+                            const np::spiegel::compile_unit_t *ours)
+    {
+        if(!ours || cu->get_compile_dir() != ours->get_compile_dir())
+        {
+            return false;
+        }
+        filename_t name = cu->get_name();
+        return (!name.is_absolute() && name.normalise().find("../") != 0);
+    }
+
+    snapshot_t::snapshot_t()
+    {
+    }
+
+    snapshot_t::~snapshot_t()
+    {
+    }
+
+    void snapshot_t::take()
+    {
+        extents_.clear();
+        data_.clear();
+
+        np::spiegel::dwarf::state_t *state = np::spiegel::dwarf::state_t::instance();
+        vector<np::spiegel::compile_unit_t *> units = np::spiegel::get_compile_units();
+        vector<np::spiegel::compile_unit_t *>::iterator i;
+
+        /*
+         * The DW_OP_addr locations are link time addresses, which
+         * are only where the variables are for the executable itself
+         * and not for any shared library, so leave those out.
+         */
+        char *exe = np::spiegel::platform::self_exe();
+        uint32_t mainlo = ~0U;
+        for(i = units.begin() ; i != units.end() ; ++i)
+        {
+            if(!strcmp((*i)->get_executable(), exe))
+            {
+                mainlo = state->get_compile_unit((*i)->get_reference())->get_link_object_index();
+                break;
+            }
+        }
+        free(exe);
+
+        /*
+         * NovaProva's own state must survive from one test to the
+         * next, so leave out the library's compile units, found from
+         * the unit holding this very function.  Without DWARF info
+         * for the library there are none, and none of its variables.
+         */
+        np::spiegel::location_t loc;
+        const np::spiegel::compile_unit_t *ours = 0;
+        if(np::spiegel::describe_address((addr_t)&is_our_unit, loc))
+        {
+            ours = loc.compile_unit_;
+        }
+        unsigned int nours = 0;
+
+        vector<pair<addr_t, size_t> > ranges;
+        for(i = units.begin() ; i != units.end() ; ++i)
+        {
+            if(state->get_compile_unit((*i)->get_reference())->get_link_object_index() != mainlo)
+            {
+                continue;
+            }
+            if(is_our_unit(*i, ours))
+            {
+                nours++;
+                continue;
+            }
+            vector<pair<addr_t, size_t> > r = (*i)->get_variable_extents();
+            ranges.insert(ranges.end(), r.begin(), r.end());
+        }
+
+        /* coalesce overlapping and adjacent ranges */
+        sort(ranges.begin(), ranges.end());
+        vector<pair<addr_t, size_t> >::iterator r;
+        for(r = ranges.begin() ; r != ranges.end() ; ++r)
+        {
+            if(extents_.size())
+            {
+                extent_t &last = extents_.back();
+                if(r->first <= last.addr_ + last.len_)
+                {
+                    addr_t end = max(last.addr_ + last.len_, r->first + r->second);
+                    last.len_ = end - last.addr_;
+                    continue;
+                }
+            }
+            extent_t ext;
+            ext.addr_ = r->first;
+            ext.len_ = r->second;
+            ext.offset_ = 0;
+            extents_.push_back(ext);
+        }
+
+        vector<extent_t>::iterator e;
+        for(e = extents_.begin() ; e != extents_.end() ; ++e)
+        {
+            e->offset_ = data_.size();
+            data_.insert(data_.end(),
+                         (const unsigned char *)e->addr_,
+                         (const unsigned char *)e->addr_ + e->len_);
+        }
+
+        #if _NP_DEBUG
+        fprintf(stderr, "np: [%s] snapshot leaves out our %u compile units\n",
+                rel_timestamp(), nours);
+        fprintf(stderr, "np: [%s] snapshot of %lu bytes in %lu extents\n",
+                rel_timestamp(), (unsigned long)data_.size(),
+                (unsigned long)extents_.size());
+        #endif
+    }
+
+    void snapshot_t::restore() const
+    {
+        vector<extent_t>::const_iterator e;
+        for(e = extents_.begin() ; e != extents_.end() ; ++e)
+        {
+            memcpy((void *)e->addr_, data_.data() + e->offset_, e->len_);
+        }
+    }
+
+    // close the namespace
+};
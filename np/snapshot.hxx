@@ -0,0 +1,63 @@
+/*
+ * Copyright 2011-2012 Gregory Banks
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef __NP_SNAPSHOT_H__
+#define __NP_SNAPSHOT_H__ 1
+
+#include "np/util/common.hxx"
+#include "np/spiegel/common.hxx"
+#include <vector>
+
+namespace np
+{
+
+    /*
+     * A copy of the initial values of all the writable variables with
+     * static storage in the Code Under Test and the test code linked
+     * into the executable, found using the DWARF information.  When a
+     * child process runs a batch of tests, restoring the snapshot
+     * between tests gives each test the same global state it would
+     * have seen in a fresh process.  NovaProva's own variables are not
+     * included.
+     */
+    class snapshot_t : public np::util::zalloc
+    {
+      public:
+        snapshot_t();
+        ~snapshot_t();
+
+        void take();
+        void restore() const;
+        unsigned long get_size() const
+        {
+            return data_.size();
+        }
+
+      private:
+        struct extent_t
+        {
+            np::spiegel::addr_t addr_;
+            size_t len_;
+            size_t offset_;	    /* into data_ */
+        };
+
+        std::vector<extent_t> extents_;
+        std::vector<unsigned char> data_;
+    };
+
+    // close the namespace
+};
+
+#endif /* __NP_SNAPSHOT_H__ */
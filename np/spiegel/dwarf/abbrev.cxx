@@ -15,6 +15,10 @@
  */
 #include "abbrev.hxx"
 #include "reader.hxx"
+#include "value.hxx"
+#include "section.hxx"
+#include "compile_unit.hxx"
+#include "enumerations.hxx"
 
 namespace np
 {
@@ -34,11 +38,14 @@ namespace np
                 for(;;)
                 {
                     attr_spec_t as;
-                    if(!r.read_uleb128(as.name) ||
-                            !r.read_uleb128(as.form))
+                    as.decode = 0;
+                    uint32_t pair[2];
+                    if(!r.read_uleb128s(pair, 2))
                     {
                         return false;
                     }
+                    as.name = pair[0];
+                    as.form = pair[1];
                     if(!as.name && !as.form)
                     {
                         break;
@@ -49,6 +56,353 @@ namespace np
                 return true;
             }
 
+            /*
+             * The per-form decoders.  Those templated on the size
+             * are instantiated for the address size of the platform
+             * and the offset size of the unit's format, so that
+             * compile() picks them without any per-attribute tests.
+             */
+            template<unsigned N> static bool
+            read_fixed(reader_t &r, uint64_t &v);
+
+            template<> bool
+            read_fixed<1>(reader_t &r, uint64_t &v)
+            {
+                uint8_t v8;
+                if(!r.read_u8(v8))
+                {
+                    return false;
+                }
+                v = v8;
+                return true;
+            }
+
+            template<> bool
+            read_fixed<2>(reader_t &r, uint64_t &v)
+            {
+                uint16_t v16;
+                if(!r.read_u16(v16))
+                {
+                    return false;
+                }
+                v = v16;
+                return true;
+            }
+
+            template<> bool
+            read_fixed<4>(reader_t &r, uint64_t &v)
+            {
+                return r.read_u32(v);
+            }
+
+            template<> bool
+            read_fixed<8>(reader_t &r, uint64_t &v)
+            {
+                return r.read_u64(v);
+            }
+
+            template<unsigned N> static bool
+            decode_data(reader_t &r, const compile_unit_t *, value_t &v)
+            {
+                uint64_t x;
+                if(!read_fixed<N>(r, x))
+                {
+                    return false;
+                }
+                v = (N > 4 ? value_t::make_uint64(x) : value_t::make_uint32(x));
+                return true;
+            }
+
+            template<unsigned N> static bool
+            decode_ref(reader_t &r, const compile_unit_t *cu, value_t &v)
+            {
+                uint64_t off;
+                if(!read_fixed<N>(r, off))
+                {
+                    return false;
+                }
+                // TODO: detect truncation
+                v = value_t::make_ref(cu->make_reference(off));
+                return true;
+            }
+
+            template<unsigned N> static bool
+            decode_strp(reader_t &r, const compile_unit_t *cu, value_t &v)
+            {
+                uint64_t off;
+                if(!read_fixed<N>(r, off))
+                {
+                    return false;
+                }
+                const char *s = cu->get_section(DW_sec_str)->offset_as_string(off);
+                if(!s)
+                {
+                    return false;
+                }
+                v = value_t::make_string(s);
+                return true;
+            }
+
+            template<unsigned N> static bool
+            decode_sec_offset(reader_t &r, const compile_unit_t *, value_t &v)
+            {
+                uint64_t off;
+                if(!read_fixed<N>(r, off))
+                {
+                    return false;
+                }
+                v = value_t::make_offset(off);
+                return true;
+            }
+
+            template<unsigned N> static bool
+            decode_block(reader_t &r, const compile_unit_t *, value_t &v)
+            {
+                uint64_t len;
+                const unsigned char *buf;
+                if(!read_fixed<N>(r, len) ||
+                        !r.read_bytes(buf, len))
+                {
+                    return false;
+                }
+                v = value_t::make_bytes(buf, len);
+                return true;
+            }
+
+            static bool
+            decode_uleb_block(reader_t &r, const compile_unit_t *, value_t &v)
+            {
+                uint32_t len;
+                const unsigned char *buf;
+                if(!r.read_uleb128(len) ||
+                        !r.read_bytes(buf, len))
+                {
+                    return false;
+                }
+                v = value_t::make_bytes(buf, len);
+                return true;
+            }
+
+            static bool
+            decode_udata(reader_t &r, const compile_unit_t *, value_t &v)
+            {
+                uint32_t x;
+                if(!r.read_uleb128(x))
+                {
+                    return false;
+                }
+                v = value_t::make_uint32(x);
+                return true;
+            }
+
+            static bool
+            decode_sdata(reader_t &r, const compile_unit_t *, value_t &v)
+            {
+                int32_t x;
+                if(!r.read_sleb128(x))
+                {
+                    return false;
+                }
+                v = value_t::make_sint32(x);
+                return true;
+            }
+
+            static bool
+            decode_addr(reader_t &r, const compile_unit_t *, value_t &v)
+            {
+                np::spiegel::addr_t x;
+                if(!r.read_addr(x))
+                {
+                    return false;
+                }
+                v = value_t::make_addr(x);
+                return true;
+            }
+
+            static bool
+            decode_string(reader_t &r, const compile_unit_t *, value_t &v)
+            {
+                const char *s;
+                if(!r.read_string(s))
+                {
+                    return false;
+                }
+                v = value_t::make_string(s);
+                return true;
+            }
+
+            static bool
+            decode_flag_present(reader_t &, const compile_unit_t *, value_t &v)
+            {
+                /* This form has no representation in the attribute
+                 * stream, it's always true.  Presumably this is
+                 * useful in combination with a careful choice of
+                 * abbrevs. */
+                v = value_t::make_uint32(true);
+                return true;
+            }
+
+            /* Returns the decoder for the form, and how to skip it */
+            template<unsigned OFFSIZE> static abbrev_t::decoder_t
+            compile_form(uint32_t form, abbrev_t::skip_op_t &op)
+            {
+                op.kind = abbrev_t::skip_op_t::FIXED;
+                switch(form)
+                {
+                    case DW_FORM_data1:
+                    case DW_FORM_flag:
+                        op.size = 1;
+                        return decode_data<1>;
+                    case DW_FORM_data2:
+                        op.size = 2;
+                        return decode_data<2>;
+                    case DW_FORM_data4:
+                        op.size = 4;
+                        return decode_data<4>;
+                    case DW_FORM_data8:
+                    case DW_FORM_ref_sig8:
+                        op.size = 8;
+                        return decode_data<8>;
+                    case DW_FORM_addr:
+                        op.size = _NP_ADDRSIZE;
+                        return decode_addr;
+                    case DW_FORM_ref1:
+                        op.size = 1;
+                        return decode_ref<1>;
+                    case DW_FORM_ref2:
+                        op.size = 2;
+                        return decode_ref<2>;
+                    case DW_FORM_ref4:
+                        op.size = 4;
+                        return decode_ref<4>;
+                    case DW_FORM_ref8:
+                        op.size = 8;
+                        return decode_ref<8>;
+                    case DW_FORM_strp:
+                        op.size = OFFSIZE;
+                        return decode_strp<OFFSIZE>;
+                    case DW_FORM_sec_offset:
+                        op.size = OFFSIZE;
+                        return decode_sec_offset<OFFSIZE>;
+                    case DW_FORM_flag_present:
+                        op.size = 0;
+                        return decode_flag_present;
+                    case DW_FORM_udata:
+                        op.kind = abbrev_t::skip_op_t::LEB128;
+                        op.size = 1;
+                        return decode_udata;
+                    case DW_FORM_sdata:
+                        op.kind = abbrev_t::skip_op_t::LEB128;
+                        op.size = 1;
+                        return decode_sdata;
+                    case DW_FORM_string:
+                        op.kind = abbrev_t::skip_op_t::STRING;
+                        return decode_string;
+                    case DW_FORM_block1:
+                        op.kind = abbrev_t::skip_op_t::BLOCK1;
+                        return decode_block<1>;
+                    case DW_FORM_block2:
+                        op.kind = abbrev_t::skip_op_t::BLOCK2;
+                        return decode_block<2>;
+                    case DW_FORM_block4:
+                        op.kind = abbrev_t::skip_op_t::BLOCK4;
+                        return decode_block<4>;
+                    case DW_FORM_block:
+                    case DW_FORM_exprloc:
+                        op.kind = abbrev_t::skip_op_t::BLOCK;
+                        return decode_uleb_block;
+                    default:
+                        op.kind = abbrev_t::skip_op_t::UNSUPPORTED;
+                        op.size = form;
+                        return 0;
+                }
+            }
+
+            void abbrev_t::compile(bool is64)
+            {
+                int fixed = 0;
+                skip_ops.clear();
+                vector<attr_spec_t>::iterator i;
+                for(i = attr_specs.begin() ; i != attr_specs.end() ; ++i)
+                {
+                    skip_op_t op;
+                    #if _NP_ADDRSIZE == 8
+                    i->decode = (is64 ? compile_form<8>(i->form, op)
+                                      : compile_form<4>(i->form, op));
+                    #else
+                    i->decode = compile_form<4>(i->form, op);
+                    #endif
+
+                    if(op.kind != skip_op_t::FIXED)
+                    {
+                        fixed = -1;
+                    }
+                    else if(fixed >= 0)
+                    {
+                        if(i->name == DW_AT_sibling &&
+                                (i->form == DW_FORM_ref1 ||
+                                 i->form == DW_FORM_ref2 ||
+                                 i->form == DW_FORM_ref4))
+                        {
+                            sibling_at = fixed;
+                            sibling_size = op.size;
+                        }
+                        fixed += op.size;
+                    }
+
+                    // coalesce runs of fixed size or LEB128 forms into one op
+                    if((op.kind == skip_op_t::FIXED || op.kind == skip_op_t::LEB128) &&
+                            skip_ops.size() && skip_ops.back().kind == op.kind)
+                    {
+                        skip_ops.back().size += op.size;
+                    }
+                    else if(!(op.kind == skip_op_t::FIXED && !op.size))
+                    {
+                        skip_ops.push_back(op);
+                    }
+                }
+                fixed_size = fixed;
+            }
+
+            abbrev_table_t::~abbrev_table_t()
+            {
+                vector<abbrev_t *>::iterator i;
+                for(i = abbrevs_.begin() ; i != abbrevs_.end() ; ++i)
+                {
+                    delete *i;
+                }
+            }
+
+            void abbrev_table_t::read(reader_t r)
+            {
+                #if _NP_DEBUG
+                fprintf(stderr, "np: reading abbrevs at offset %u\n", offset_);
+                #endif
+                r.seek(offset_);
+
+                uint32_t code;
+                /* code 0 indicates end of compile unit */
+                while(r.read_uleb128(code) && code)
+                {
+                    abbrev_t *a = new abbrev_t(code);
+                    if(!a->read(r))
+                    {
+                        delete a;
+                        break;
+                    }
+                    a->compile(is64_);
+                    if(a->code >= abbrevs_.size())
+                    {
+                        abbrevs_.resize(a->code + 1, 0);
+                    }
+                    else if(abbrevs_[a->code])
+                    {
+                        delete abbrevs_[a->code];
+                    }
+                    abbrevs_[a->code] = a;
+                }
+            }
+
             // close namespaces
         };
     };
@@ -26,35 +26,116 @@ namespace np
         {
 
             class reader_t;
+            class compile_unit_t;
+            struct value_t;
 
             struct abbrev_t
             {
+                // decodes one attribute value in a given form
+                typedef bool (*decoder_t)(reader_t &, const compile_unit_t *, value_t &);
+
                 struct attr_spec_t
                 {
                     uint32_t name;
                     uint32_t form;
+                    decoder_t decode;	// 0 if the form is not supported
+                };
+
+                // one step of the program which skips all the attributes
+                struct skip_op_t
+                {
+                    enum
+                    {
+                        FIXED,		// size bytes
+                        LEB128,		// size values
+                        STRING,
+                        BLOCK1,
+                        BLOCK2,
+                        BLOCK4,
+                        BLOCK,		// uleb128 length
+                        UNSUPPORTED	// size is the form
+                    };
+                    uint32_t kind;
+                    uint32_t size;
                 };
 
                 // default c'tor
                 abbrev_t()
                     :  code(0),
                        tag(0),
-                       children(0)
+                       children(0),
+                       fixed_size(-1),
+                       sibling_at(-1),
+                       sibling_size(0)
                 {}
 
                 // c'tor with code
                 abbrev_t(uint32_t c)
                     :  code(c),
                        tag(0),
-                       children(0)
+                       children(0),
+                       fixed_size(-1),
+                       sibling_at(-1),
+                       sibling_size(0)
                 {}
 
                 bool read(reader_t& r);
+                // resolve the forms for units of the given format
+                void compile(bool is64);
+
+                // the position of the attribute in attr_specs, which
+                // is also its slot in an entry_t, or -1 if absent
+                int find_slot(uint32_t name) const
+                {
+                    for (unsigned i = 0 ; i < attr_specs.size() ; i++)
+                    {
+                        if (attr_specs[i].name == name)
+                            return i;
+                    }
+                    return -1;
+                }
 
                 uint32_t code;
                 uint32_t tag;
                 uint8_t children;
                 std::vector<attr_spec_t> attr_specs;
+
+                // the compiled form, filled in by compile()
+                std::vector<skip_op_t> skip_ops;
+                int fixed_size;		// bytes of all attributes, or -1 if variable
+                int sibling_at;		// byte position of DW_AT_sibling, or -1
+                int sibling_size;
+            };
+
+            /*
+             * The abbrevs at one offset in .debug_abbrev.  Compilers
+             * often emit a single table for several compile units, so
+             * tables are read and compiled once and shared.
+             */
+            class abbrev_table_t
+            {
+              public:
+                abbrev_table_t(uint32_t offset, bool is64)
+                    :  offset_(offset),
+                       is64_(is64)
+                {}
+                ~abbrev_table_t();
+
+                void read(reader_t r);
+
+                const abbrev_t *get_abbrev(uint32_t code) const
+                {
+                    return (code >= abbrevs_.size() ? 0 : abbrevs_[code]);
+                }
+                const std::vector<abbrev_t *> &get_abbrevs() const
+                {
+                    return abbrevs_;
+                }
+
+              private:
+                uint32_t offset_;
+                bool is64_;
+                std::vector<abbrev_t *> abbrevs_;
             };
 
             // close namespaces
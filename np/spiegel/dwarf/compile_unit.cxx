@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 #include "np/spiegel/common.hxx"
+#include <algorithm>
 #include "state.hxx"
 #include "compile_unit.hxx"
 #include "walker.hxx"
@@ -28,9 +29,52 @@ namespace np
             using namespace std;
             using namespace np::util;
 
+            /*
+             * Units written in a DWARF version we can't read, like the
+             * DWARF5 unit in the startup object newer compilers link in
+             * with -fsanitize=address, are stepped over rather than
+             * failing all discovery.  Returns true if it skipped one.
+             */
+            bool compile_unit_t::skip_unsupported(reader_t &r)
+            {
+                reader_t t = r;
+                uint32_t length32;
+                uint64_t length;
+                uint16_t version;
+
+                if(!t.read_u32(length32))
+                {
+                    return false;
+                }
+                length = length32;
+                if(length32 == 0xffffffff && !t.read_u64(length))
+                {
+                    return false;
+                }
+                if(length > t.get_remains() || length < 2 ||
+                        !t.read_u16(version))
+                {
+                    return false;
+                }
+                if(version >= MIN_DWARF_VERSION && version <= MAX_DWARF_VERSION)
+                {
+                    return false;
+                }
+
+                #if _NP_DEBUG
+                fprintf(stderr, "np: skipping DWARF version %u compile unit "
+                        "at section offset 0x%lx\n",
+                        (unsigned)version, r.get_offset());
+                #endif
+                t.skip(length - 2);
+                r = t;
+                return true;
+            }
+
             bool compile_unit_t::read_header(reader_t &r)
             {
                 reader_ = r;        // sample offset of start of header
+                offset_ = r.get_offset();
 
                 #if _NP_DEBUG
                 fprintf(stderr, "np: DWARF compile unit header at "
@@ -113,38 +157,12 @@ namespace np
                 return true;
             }
 
-            void compile_unit_t::read_abbrevs(reader_t &r)
-            {
-                #if _NP_DEBUG
-                fprintf(stderr, "np: reading abbrevs\n");
-                #endif
-                r.seek(abbrevs_offset_);
-
-                uint32_t code;
-                /* code 0 indicates end of compile unit */
-                while(r.read_uleb128(code) && code)
-                {
-                    abbrev_t *a = new abbrev_t(code);
-                    if(!a->read(r))
-                    {
-                        delete a;
-                        break;
-                    }
-                    if(a->code >= abbrevs_.size())
-                    {
-                        abbrevs_.resize(a->code + 1, 0);
-                    }
-                    abbrevs_[a->code] = a;
-                }
-            }
-
-
             void compile_unit_t::dump_abbrevs() const
             {
                 fprintf(stderr, "np: Abbrevs {\n");
 
                 vector<abbrev_t *>::const_iterator itr;
-                for(itr = abbrevs_.begin() ; itr != abbrevs_.end() ; ++itr)
+                for(itr = abbrevs_->get_abbrevs().begin() ; itr != abbrevs_->get_abbrevs().end() ; ++itr)
                 {
                     abbrev_t *a = *itr;
                     if(!a)
@@ -183,6 +201,46 @@ namespace np
                 return &lo->sections_[i];
             }
 
+            static bool
+            die_offset_less(const compile_unit_t::die_t &d, uint32_t offset)
+            {
+                return d.offset_ < offset;
+            }
+
+            void compile_unit_t::index_dies()
+            {
+                if(has_dies_)
+                {
+                    /* pairs with the barrier before setting has_dies_ */
+                    __sync_synchronize();
+                    return;
+                }
+
+                pthread_mutex_lock(&dies_lock_);
+                if(!has_dies_)
+                {
+                    walker_t w(this);
+                    w.index_dies(dies_);
+                    #if _NP_DEBUG
+                    fprintf(stderr, "np: indexed %u DIEs in compile unit %u\n",
+                            (unsigned)dies_.size(), index_);
+                    #endif
+                    /* dies_ must be visible before has_dies_ is */
+                    __sync_synchronize();
+                    has_dies_ = true;
+                }
+                pthread_mutex_unlock(&dies_lock_);
+            }
+
+            const compile_unit_t::die_t *
+            compile_unit_t::find_die(uint32_t offset)
+            {
+                index_dies();
+                vector<die_t>::const_iterator i =
+                    lower_bound(dies_.begin(), dies_.end(), offset, die_offset_less);
+                return (i == dies_.end() || i->offset_ != offset ? 0 : &*i);
+            }
+
             // close namespaces
         };
     };
@@ -19,6 +19,8 @@
 #include "np/spiegel/common.hxx"
 #include "reference.hxx"
 #include "reader.hxx"
+#include "abbrev.hxx"
+#include <pthread.h>
 
 namespace np
 {
@@ -27,7 +29,6 @@ namespace np
         namespace dwarf
         {
 
-            class abbrev_t;
             class walker_t;
             class section_t;
 
@@ -44,15 +45,36 @@ namespace np
               public:
                 compile_unit_t(uint32_t idx, uint32_t loidx)
                     :  index_(idx),
-                       loindex_(loidx)
-                {}
+                       loindex_(loidx),
+                       offset_(0),
+                       abbrevs_(0),
+                       has_pubnames_(false),
+                       has_dies_(false)
+                {
+                    pthread_mutex_init(&dies_lock_, 0);
+                }
 
                 ~compile_unit_t()
-                {}
+                {
+                    pthread_mutex_destroy(&dies_lock_);
+                }
 
+                static bool skip_unsupported(reader_t& r);
                 bool read_header(reader_t& r);
                 bool read_compile_unit_entry(walker_t& w);
-                void read_abbrevs(reader_t& r);
+                // the table may be shared with other units
+                void set_abbrevs(const abbrev_table_t *t)
+                {
+                    abbrevs_ = t;
+                }
+                uint32_t get_abbrevs_offset() const
+                {
+                    return abbrevs_offset_;
+                }
+                bool is64() const
+                {
+                    return is64_;
+                }
                 void dump_abbrevs() const;
 
                 uint32_t get_index() const
@@ -94,17 +116,93 @@ namespace np
 
                 const abbrev_t *get_abbrev(uint32_t code) const
                 {
-                    return (code >= abbrevs_.size() ? 0 : abbrevs_[code]);
+                    return abbrevs_->get_abbrev(code);
+                }
+
+                // byte offset of the header in the .debug_info section
+                unsigned long get_offset() const
+                {
+                    return offset_;
+                }
+
+                // a name from the .debug_pubnames section
+                struct pubname_t
+                {
+                    const char *name_;
+                    uint32_t offset_;	// from start of compile unit
+
+                    bool operator<(const pubname_t &o) const
+                    {
+                        return offset_ < o.offset_;
+                    }
+                };
+                void set_pubnames(const std::vector<pubname_t> &pns)
+                {
+                    pubnames_ = pns;
+                    has_pubnames_ = true;
+                }
+                // false if the compiler didn't index this unit
+                bool has_pubnames() const
+                {
+                    return has_pubnames_;
+                }
+                // sorted in DIE order
+                const std::vector<pubname_t> &get_pubnames() const
+                {
+                    return pubnames_;
+                }
+
+                /*
+                 * A compact index of every DIE in the unit, built
+                 * lazily by skimming the unit once.  DIEs are stored
+                 * in preorder, i.e. in offset order, so the first
+                 * child of a DIE is the next element and its next
+                 * sibling is whatever lies at end_.  Walkers on other
+                 * threads can follow references into any unit, so
+                 * the lazy build is done under dies_lock_.
+                 */
+                struct die_t
+                {
+                    uint32_t offset_;	// from start of compile unit
+                    uint32_t end_;	// offset just past the subtree
+                    uint32_t parent_;	// index of parent, or no_parent
+                };
+                enum { no_parent = ~0U };
+                // returns 0 if there is no DIE at that offset
+                const die_t *find_die(uint32_t offset);
+                // a dense numbering of the DIEs, in preorder
+                uint32_t get_num_dies()
+                {
+                    index_dies();
+                    return dies_.size();
+                }
+                // returns -1 if there is no DIE at that offset
+                int get_die_ordinal(uint32_t offset)
+                {
+                    const die_t *d = find_die(offset);
+                    return (d ? d - &dies_[0] : -1);
+                }
+                const die_t *get_parent(const die_t *d) const
+                {
+                    return (d->parent_ == (uint32_t)no_parent ? 0 : &dies_[d->parent_]);
                 }
 
               private:
+                void index_dies();
+
                 uint32_t index_;
                 uint32_t loindex_;
+                unsigned long offset_;
                 uint16_t version_;
                 bool is64_;		    // new 64b format introduced in DWARF3
                 reader_t reader_;	    // for whole including header
                 uint32_t abbrevs_offset_;
-                std::vector<abbrev_t *> abbrevs_;
+                const abbrev_table_t *abbrevs_;
+                bool has_pubnames_;
+                std::vector<pubname_t> pubnames_;
+                bool has_dies_;
+                pthread_mutex_t dies_lock_;
+                std::vector<die_t> dies_;
             };
 
             // close namespaces
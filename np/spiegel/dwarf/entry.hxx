@@ -37,9 +37,8 @@ namespace np
                     :  offset_(0),
                        level_(0),
                        abbrev_(0),
-                       latest_(0)
+                       nvalues_(0)
                 {
-                    memset(generation_, 0x0, sizeof(generation_));
                 }
 
                 void setup(size_t offset, unsigned level, const abbrev_t *a)
@@ -47,34 +46,31 @@ namespace np
                     offset_ = offset;
                     level_ = level;
                     abbrev_ = a;
-                    latest_++;
-                }
-                void partial_setup(const entry_t& o)
-                {
-                    offset_ = o.offset_;
-                    level_ = o.level_;
-                    abbrev_ = 0;
+                    clear_values();
                 }
                 void partial_setup(uint32_t off, uint32_t lev)
                 {
                     offset_ = off;
                     level_ = lev;
                     abbrev_ = 0;
+                    clear_values();
                 }
                 void partial_setup(uint32_t off, uint32_t lev, const abbrev_t *a)
                 {
                     offset_ = off;
                     level_ = lev;
                     abbrev_ = a;
+                    clear_values();
                 }
 
-                void add_attribute(uint32_t name, const value_t& val)
+                // values must be added in the abbrev's order
+                void add_attribute(const value_t& val)
                 {
-                    int i = name_to_index(name);
-                    if (i < 0)
-                        return;	// silently ignore this
-                    values_[i] = val;
-                    generation_[i] = latest_;
+                    if (nvalues_ < MAX_VALUES)
+                        values_[nvalues_] = val;
+                    else
+                        more_values_.push_back(val);
+                    nvalues_++;
                 }
 
                 unsigned get_offset() const
@@ -101,8 +97,13 @@ namespace np
 
                 const value_t *get_attribute(uint32_t name) const
                 {
-                    int i = name_to_index(name);
-                    return (i >= 0 && generation_[i] == latest_ ? &values_[i] : 0);
+                    int i = (abbrev_ ? abbrev_->find_slot(name) : -1);
+                    if (i < 0 || i >= (int)nvalues_)
+                        return 0;
+                    else if (i < MAX_VALUES)
+                        return &values_[i];
+                    else
+                        return &more_values_[i - MAX_VALUES];
                 }
                 const char *get_string_attribute(uint32_t name) const
                 {
@@ -153,27 +154,26 @@ namespace np
               private:
                 enum
                 {
-                    // we oversupply space, because entry_t is never
-                    // allocated and stored but handling a sparse mapping
-                    // was taking up too many cycles.
-                    MAX_VALUES = DW_AT_max_basic + (DW_AT_max_user - DW_AT_lo_user)
+                    // Only the attributes in the abbrev are stored, in
+                    // its order.  This many are kept in the entry itself,
+                    // which covers the abbrevs compilers usually emit and
+                    // keeps walkers cheap to copy; any more go in
+                    // more_values_.
+                    MAX_VALUES = 32
                 };
-                static int name_to_index(int name)
+
+                void clear_values()
                 {
-                    if (name < DW_AT_max_basic)
-                        return name;
-                    else if (name >= DW_AT_lo_user && name < DW_AT_max_user)
-                        return DW_AT_max_basic + name - DW_AT_lo_user;
-                    else
-                        return -1;
+                    nvalues_ = 0;
+                    more_values_.clear();
                 }
 
                 unsigned offset_;
                 unsigned level_;
                 const abbrev_t *abbrev_;
-                uint32_t latest_;
-                uint32_t generation_[MAX_VALUES];
+                unsigned nvalues_;
                 value_t values_[MAX_VALUES];
+                std::vector<value_t> more_values_;
             };
 
 
@@ -278,6 +278,12 @@ enum encoding_values
     //     DW_ATE_hi_user = 0xff,
 };
 
+enum location_ops
+{
+    // Only the one we need to find variables with static storage
+    DW_OP_addr = 0x03,
+};
+
 namespace np
 {
     namespace spiegel
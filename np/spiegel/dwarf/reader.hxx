@@ -17,6 +17,11 @@
 #define __np_spiegel_dwarf_reader_hxx__ 1
 
 #include "np/spiegel/common.hxx"
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 namespace np
 {
@@ -227,6 +232,99 @@ namespace np
                     return true;
                 }
 
+                /*
+                 * Bulk versions for runs of LEB128 values.  A value
+                 * ends at the first byte without its top bit set, and
+                 * most values in DWARF are short, so a vector compare
+                 * finds the run of 1-byte values at the front of a
+                 * window and we handle them all at once.  We fall back
+                 * to bytewise for longer values, near the end of the
+                 * data, and on platforms without SSE2.
+                 */
+                bool skip_leb128s(unsigned n)
+                {
+                    const unsigned char *pp = p_;
+                    while (n)
+                    {
+#if defined(__AVX2__)
+                        if (end_ - pp >= 32)
+                        {
+                            uint32_t more = _mm256_movemask_epi8(
+                                    _mm256_loadu_si256((const __m256i *)pp));
+                            unsigned run = (more ? __builtin_ctz(more) : 32);
+                            if (run > n)
+                                run = n;
+                            pp += run;
+                            n -= run;
+                            if (!n || run == 32)
+                                continue;
+                        }
+#elif defined(__SSE2__)
+                        if (end_ - pp >= 16)
+                        {
+                            uint32_t more = _mm_movemask_epi8(
+                                    _mm_loadu_si128((const __m128i *)pp));
+                            unsigned run = (more ? __builtin_ctz(more) : 16);
+                            if (run > n)
+                                run = n;
+                            pp += run;
+                            n -= run;
+                            if (!n || run == 16)
+                                continue;
+                        }
+#endif
+                        do
+                        {
+                            if (pp == end_)
+                                return false;
+                        }
+                        while ((*pp++) & 0x80);
+                        n--;
+                    }
+                    p_ = pp;
+                    return true;
+                }
+
+                bool read_uleb128s(uint32_t *v, unsigned n)
+                {
+                    const unsigned char *pp = p_;
+                    while (n)
+                    {
+#if defined(__SSE2__)
+                        if (end_ - pp >= 16)
+                        {
+                            // copy out the leading run of 1-byte values
+                            uint32_t more = _mm_movemask_epi8(
+                                    _mm_loadu_si128((const __m128i *)pp));
+                            unsigned run = (more ? __builtin_ctz(more) : 16);
+                            if (run > n)
+                                run = n;
+                            for (unsigned i = 0 ; i < run ; i++)
+                                v[i] = pp[i];
+                            v += run;
+                            pp += run;
+                            n -= run;
+                            if (!n || run == 16)
+                                continue;
+                        }
+#endif
+                        uint32_t vv = 0;
+                        unsigned shift = 0;
+                        do
+                        {
+                            if (pp == end_)
+                                return false;
+                            vv |= ((*pp) & 0x7f) << shift;
+                            shift += 7;
+                        }
+                        while ((*pp++) & 0x80);
+                        *v++ = vv;
+                        n--;
+                    }
+                    p_ = pp;
+                    return true;
+                }
+
                 bool read_u16(uint16_t& v)
                 {
                     if (p_ + 2 > end_)
@@ -15,12 +15,15 @@
  */
 #include "np/spiegel/common.hxx"
 #include <sys/fcntl.h>
-#include <bfd.h>
+#include <algorithm>
 #include "state.hxx"
 #include "reader.hxx"
 #include "compile_unit.hxx"
+#include "abbrev.hxx"
 #include "walker.hxx"
 #include "np/spiegel/platform/common.hxx"
+#include "np/spiegel/elf.hxx"
+#include "np/util/parallel.hxx"
 
 namespace np
 {
@@ -36,6 +39,8 @@ namespace np
             state_t *state_t::instance_ = 0;
 
             state_t::state_t()
+             :  deferred_(false),
+                aranges_read_(false)
             {
                 assert(!instance_);
                 instance_ = this;
@@ -49,11 +54,23 @@ namespace np
                     delete *i;
                 }
                 address_index_.clear();
+                aranges_.clear();
 
                 assert(instance_ == this);
                 instance_ = 0;
             }
 
+            state_t::linkobj_t::~linkobj_t()
+            {
+                unmap_sections();
+                free(filename_);
+                map<pair<uint32_t, bool>, abbrev_table_t *>::iterator i;
+                for(i = abbrev_tables_.begin() ; i != abbrev_tables_.end() ; ++i)
+                {
+                    delete i->second;
+                }
+            }
+
             bool
             state_t::linkobj_t::map_sections()
             {
@@ -63,44 +80,39 @@ namespace np
                 int nsec = 0;   /* number of DWARF sections to be explicitly mapped herein */
                 int ndwarf = 0; /* number of DWARF sections in the linkobj */
 
-                bfd_init();
-
                 #if _NP_DEBUG
-                fprintf(stderr, "np: opening bfd %s\n", filename_);
+                fprintf(stderr, "np: reading ELF sections of %s\n", filename_);
                 #endif
-                /* Open a BFD */
-                bfd *b = bfd_openr(filename_, NULL);
-                if(!b)
+                vector<np::spiegel::elf_section_t> secs;
+                if(!np::spiegel::read_elf_sections(filename_, secs))
                 {
-                    bfd_perror(filename_);
                     return false;
                 }
-                if(!bfd_check_format(b, bfd_object))
-                {
-                    fprintf(stderr, "np: %s: not an object\n", filename_);
-                    goto error;
-                }
 
                 /* Extract the file shape of the DWARF sections */
                 #if _NP_DEBUG
                 fprintf(stderr, "np: sections:\n");
                 #endif
-                asection *sec;
-                for(sec = b->sections ; sec ; sec = sec->next)
+                vector<np::spiegel::elf_section_t>::iterator sec;
+                for(sec = secs.begin() ; sec != secs.end() ; ++sec)
                 {
-                    int idx = secnames.to_index(sec->name);
+                    int idx = secnames.to_index(sec->name_.c_str());
                     #if _NP_DEBUG
                     fprintf(stderr, "np: section name %s size %lx filepos %lx index %d\n",
-                            sec->name, (unsigned long)sec->size,
-                            (unsigned long)sec->filepos, idx);
+                            sec->name_.c_str(), sec->size_, sec->offset_, idx);
                     #endif
                     if(idx == DW_sec_none)
                     {
                         continue;
                     }
+                    if(sec->compressed_)
+                    {
+                        fprintf(stderr, "np: WARNING: cannot read compressed section %s in %s\n",
+                                sec->name_.c_str(), filename_);
+                        continue;
+                    }
                     ndwarf++;
-                    sections_[idx].set_range((unsigned long)sec->filepos,
-                                             (unsigned long)sec->size);
+                    sections_[idx].set_range(sec->offset_, sec->size_);
 
                     /* See if the section can be satisfied out of
                      * existing system mappings */
@@ -182,6 +194,8 @@ namespace np
                             perror("mmap");
                             goto error;
                         }
+                        /* start reading ahead while we do other setup */
+                        m->prefetch();
                     }
 
                     /* setup sections[].map */
@@ -224,7 +238,6 @@ out:
                 {
                     close(fd);
                 }
-                bfd_close(b);
                 return r;
             }
 
@@ -245,25 +258,163 @@ out:
                 fprintf(stderr, "np: reading compile units for linkobj %s\n", lo->filename_);
                 #endif
                 reader_t infor = lo->sections_[DW_sec_info].get_contents();
-                reader_t abbrevr = lo->sections_[DW_sec_abbrev].get_contents();
 
+                /* the abbrevs are read later by read_abbrevs() */
                 compile_unit_t *cu = 0;
                 for(;;)
                 {
+                    if(compile_unit_t::skip_unsupported(infor))
+                    {
+                        continue;
+                    }
                     cu = new compile_unit_t(compile_units_.size(), lo->index_);
                     if(!cu->read_header(infor))
                     {
                         break;
                     }
-
-                    cu->read_abbrevs(abbrevr);
-
                     compile_units_.push_back(cu);
                 }
                 delete cu;
                 return true;
             }
 
+            /*
+             * Compilers emit a .debug_pubnames section when asked
+             * (e.g. gcc -gpubnames), with a set of (DIE offset, name)
+             * pairs for each compile unit naming all its functions and
+             * variables.  Units with a set can be searched for functions
+             * without walking all their DIEs.  Errors here just mean
+             * we fall back to walking.
+             */
+            void
+            state_t::read_pubnames(linkobj_t *lo, unsigned int first)
+            {
+                reader_t pubr = lo->sections_[DW_sec_pubnames].get_contents();
+                if(!pubr.get_remains())
+                {
+                    return;
+                }
+                #if _NP_DEBUG
+                fprintf(stderr, "np: reading pubnames for linkobj %s\n", lo->filename_);
+                #endif
+
+                map<unsigned long, compile_unit_t *> by_offset;
+                for(unsigned int i = first ; i < compile_units_.size() ; i++)
+                {
+                    by_offset[compile_units_[i]->get_offset()] = compile_units_[i];
+                }
+
+                for(;;)
+                {
+                    uint32_t length32;
+                    np::spiegel::offset_t length;
+                    bool is64 = false;
+                    if(!pubr.read_u32(length32))
+                    {
+                        break;
+                    }
+                    length = length32;
+                    if(length32 == 0xffffffff)
+                    {
+                        uint64_t length64;
+                        if(!pubr.read_u64(length64))
+                        {
+                            break;
+                        }
+                        length = length64;
+                        is64 = true;
+                    }
+                    if(length > pubr.get_remains())
+                    {
+                        break;
+                    }
+                    reader_t setr = pubr.initial_subset(length);
+                    setr.set_is64(is64);
+                    pubr.skip(length);
+
+                    uint16_t version;
+                    np::spiegel::offset_t info_offset;
+                    if(!setr.read_u16(version) ||
+                            version != 2 ||
+                            !setr.read_offset(info_offset) ||
+                            !setr.skip_offset()/*info length*/)
+                    {
+                        continue;
+                    }
+                    map<unsigned long, compile_unit_t *>::iterator cui = by_offset.find(info_offset);
+                    if(cui == by_offset.end())
+                    {
+                        continue;
+                    }
+
+                    vector<compile_unit_t::pubname_t> pns;
+                    for(;;)
+                    {
+                        np::spiegel::offset_t off;
+                        compile_unit_t::pubname_t pn;
+                        if(!setr.read_offset(off) || !off ||
+                                !setr.read_string(pn.name_))
+                        {
+                            break;
+                        }
+                        pn.offset_ = off;
+                        pns.push_back(pn);
+                    }
+                    sort(pns.begin(), pns.end());
+                    cui->second->set_pubnames(pns);
+                }
+            }
+
+            /* Once the headers are read, the abbrev tables are independent */
+            class abbrev_reader_t : public np::util::parallel_t
+            {
+              public:
+                void add(abbrev_table_t *t, const section_t *sec)
+                {
+                    tables_.push_back(t);
+                    sections_.push_back(sec);
+                }
+                unsigned int size() const
+                {
+                    return tables_.size();
+                }
+
+                void work(unsigned int i)
+                {
+                    tables_[i]->read(sections_[i]->get_contents());
+                }
+
+              private:
+                vector<abbrev_table_t *> tables_;
+                vector<const section_t *> sections_;
+            };
+
+            /* Gives each new unit its abbrev table, reading each table once */
+            void
+            state_t::read_abbrevs(unsigned int first)
+            {
+                abbrev_reader_t reader;
+                vector<compile_unit_t *>::iterator i;
+                for(i = compile_units_.begin() + first ; i != compile_units_.end() ; ++i)
+                {
+                    compile_unit_t *cu = *i;
+                    linkobj_t *lo = linkobjs_[cu->get_link_object_index()];
+                    pair<uint32_t, bool> key(cu->get_abbrevs_offset(), cu->is64());
+                    abbrev_table_t *&t = lo->abbrev_tables_[key];
+                    if(!t)
+                    {
+                        t = new abbrev_table_t(key.first, key.second);
+                        reader.add(t, &lo->sections_[DW_sec_abbrev]);
+                    }
+                    cu->set_abbrevs(t);
+                }
+                #if _NP_DEBUG
+                fprintf(stderr, "np: reading %u abbrev tables for %u compile units\n",
+                        reader.size(), (unsigned)(compile_units_.size() - first));
+                #endif
+                reader.run(reader.size());
+            }
+
             static bool
             filename_is_ignored(const char *filename)
             {
@@ -323,18 +474,26 @@ out:
                         fprintf(stderr, "np: state_t::add_self: have spiegel linkobj\n");
                         #endif
                         lo->system_mappings_ = i->mappings;
+                        lo->build_id_ = i->build_id;
                     }
                 }
 
                 r = read_linkobjs();
-                if(r)
-                {
-                    prepare_address_index();
-                }
                 free(exe);
                 return r;
             }
 
+            void
+            state_t::add_deferred()
+            {
+                #if _NP_DEBUG
+                fprintf(stderr, "np: [%s] reading deferred DWARF info\n",
+                        np::util::rel_timestamp());
+                #endif
+                deferred_ = false;
+                add_self();
+            }
+
             bool
             state_t::add_executable(const char *filename)
             {
@@ -343,12 +502,25 @@ out:
                 {
                     return false;
                 }
-                bool r = read_linkobjs();
-                if(r)
+                return read_linkobjs();
+            }
+
+            string
+            state_t::get_build_ids() const
+            {
+                string ids;
+
+                vector<linkobj_t *>::const_iterator i;
+                for(i = linkobjs_.begin() ; i != linkobjs_.end() ; ++i)
                 {
-                    prepare_address_index();
+                    if(!(*i)->build_id_.length())
+                    {
+                        return string();
+                    }
+                    ids += (*i)->build_id_;
+                    ids += "\n";
                 }
-                return r;
+                return ids;
             }
 
             state_t::linkobj_t *
@@ -376,15 +548,19 @@ out:
             bool
             state_t::read_linkobjs()
             {
+                unsigned int first = compile_units_.size();
                 vector<linkobj_t *>::iterator i;
                 for(i = linkobjs_.begin() ; i != linkobjs_.end() ; ++i)
                 {
+                    unsigned int lofirst = compile_units_.size();
                     if(!(*i)->map_sections() ||
                             !read_compile_units(*i))
                     {
                         return false;
                     }
+                    read_pubnames(*i, lofirst);
                 }
+                read_abbrevs(first);
                 return true;
             }
 
@@ -734,7 +910,8 @@ out:
             }
 
             void
-            state_t::insert_ranges(const walker_t &w, reference_t funcref)
+            state_t::get_ranges(const walker_t &w, reference_t funcref,
+                                vector<address_range_t> &res) const
             {
                 const entry_t *e = w.get_entry();
                 bool has_lo = (e->get_attribute(DW_AT_low_pc) != 0);
@@ -754,7 +931,7 @@ out:
                     {
                         hi += lo;
                     }
-                    address_index_.insert(lo, hi, funcref);
+                    res.push_back(make_range(lo, hi, funcref));
                 }
                 else if(ranges)
                 {
@@ -781,25 +958,41 @@ out:
                         }
                         start += base;
                         end += base;
-                        address_index_.insert(start, end, funcref);
+                        res.push_back(make_range(start, end, funcref));
                     }
                 }
                 else if(has_lo)
                 {
-                    address_index_.insert(lo, funcref);
+                    res.push_back(make_range(lo, lo, funcref));
                 }
             }
 
-            void
-            state_t::prepare_address_index()
+            /* Functions with code are never defined inside these, so
+             * there's no need to walk their children to find ranges */
+            static const unsigned rangeless_scope_tags[] =
+            {
+                DW_TAG_class_type,
+                DW_TAG_enumeration_type,
+                DW_TAG_inlined_subroutine,
+                DW_TAG_structure_type,
+                DW_TAG_union_type,
+                0
+            };
+
+            /* Finds the ranges of each compile unit's functions into its own slot */
+            class range_finder_t : public np::util::parallel_t
             {
-                reference_t funcref;
+              public:
+                range_finder_t(const state_t *state, const vector<compile_unit_t *> &units)
+                    :  state_(state), units_(units), ranges_(units.size())
+                {}
 
-                vector<compile_unit_t *>::iterator i;
-                for(i = compile_units_.begin() ; i != compile_units_.end() ; ++i)
+                void work(unsigned int i)
                 {
-                    walker_t w(*i);
+                    reference_t funcref;
+                    walker_t w(units_[i]);
                     w.set_filter_tag(DW_TAG_subprogram);
+                    w.set_prune_tags(rangeless_scope_tags);
                     while(const entry_t *e = w.move_preorder())
                     {
                         assert(e->get_tag() == DW_TAG_subprogram);
@@ -811,74 +1004,226 @@ out:
                         {
                             funcref = w.get_reference();
                         }
-                        insert_ranges(w, funcref);
+                        state_->get_ranges(w, funcref, ranges_[i]);
                     }
                 }
-            }
+
+                const vector<state_t::address_range_t> &get_ranges(unsigned int i) const
+                {
+                    return ranges_[i];
+                }
+
+              private:
+                const state_t *state_;
+                const vector<compile_unit_t *> &units_;
+                vector<vector<state_t::address_range_t> > ranges_;
+            };
 
             bool
-            state_t::is_within(np::spiegel::addr_t addr, const walker_t &w,
-                               unsigned int &offset) const
+            state_t::get_function_symbols(vector<function_symbol_t> &res) const
             {
-                const entry_t *e = w.get_entry();
-                bool has_lo = (e->get_attribute(DW_AT_low_pc) != 0);
-                uint64_t lo = e->get_uint64_attribute(DW_AT_low_pc);
-                bool has_hi = (e->get_attribute(DW_AT_high_pc) != 0);
-                uint64_t hi = e->get_uint64_attribute(DW_AT_high_pc);
-                // DW_AT_ranges is a DWARF3 attribute, but g++ generates
-                // it (despite only claiming DWARF2 compliance).
-                uint64_t ranges = e->get_uint64_attribute(DW_AT_ranges);
-                if(has_lo && has_hi)
+                vector<linkobj_t *>::const_iterator i;
+                for(i = linkobjs_.begin() ; i != linkobjs_.end() ; ++i)
                 {
-                    if(addr >= lo && addr <= hi)
+                    vector<np::spiegel::elf_symbol_t> syms;
+                    if(!np::spiegel::read_elf_function_symbols((*i)->filename_, syms))
                     {
-                        offset = (addr - lo);
-                        return true;
+                        return false;
+                    }
+                    vector<np::spiegel::elf_symbol_t>::const_iterator j;
+                    for(j = syms.begin() ; j != syms.end() ; ++j)
+                    {
+                        function_symbol_t fs;
+                        fs.name_ = j->name_;
+                        fs.addr_ = j->value_;
+                        fs.linkobj_ = (*i)->index_;
+                        res.push_back(fs);
                     }
-                    return false;
                 }
-                if(ranges)
+                return true;
+            }
+
+            /* Adds the functions of any of the units not yet indexed */
+            void
+            state_t::index_compile_units(const vector<uint32_t> &cus)
+            {
+                indexed_.resize(compile_units_.size(), false);
+                vector<compile_unit_t *> units;
+                vector<uint32_t>::const_iterator i;
+                for(i = cus.begin() ; i != cus.end() ; ++i)
                 {
-                    reader_t r = w.get_section_contents(DW_sec_ranges);
-                    r.skip(ranges);
-                    np::spiegel::addr_t base = 0; // TODO: compile unit base
-                    np::spiegel::addr_t start, end;
+                    if(!indexed_[*i])
+                    {
+                        indexed_[*i] = true;
+                        units.push_back(compile_units_[*i]);
+                    }
+                }
+                if(!units.size())
+                {
+                    return;
+                }
+                #if _NP_DEBUG
+                fprintf(stderr, "np: [%s] indexing addresses of %u compile units\n",
+                        np::util::rel_timestamp(), (unsigned)units.size());
+                #endif
+
+                range_finder_t finder(this, units);
+                finder.run(units.size());
+
+                /* merge in compile unit order, so that where ranges
+                 * overlap the result is the same as a serial scan */
+                for(unsigned int j = 0 ; j < units.size() ; j++)
+                {
+                    const vector<address_range_t> &ranges = finder.get_ranges(j);
+                    vector<address_range_t>::const_iterator r;
+                    for(r = ranges.begin() ; r != ranges.end() ; ++r)
+                    {
+                        address_index_.insert(r->lo, r->hi, r->funcref);
+                    }
+                }
+            }
+
+            void
+            state_t::prepare_address_index()
+            {
+                vector<uint32_t> all;
+                for(uint32_t i = 0 ; i < compile_units_.size() ; i++)
+                {
+                    all.push_back(i);
+                }
+                index_compile_units(all);
+            }
+
+            /*
+             * Called before forking children, which then share the
+             * result instead of each doing the same work.
+             */
+            void
+            state_t::prewarm_address_index()
+            {
+                if(deferred_)
+                {
+                    return;     /* the children may not need DWARF at all */
+                }
+                read_aranges();
+                index_compile_units(unranged_);
+            }
+
+            /*
+             * Reads which address ranges belong to which compile unit
+             * from .debug_aranges, where the compiler provided it.
+             * Units which don't appear there are left in unranged_.
+             */
+            void
+            state_t::read_aranges()
+            {
+                if(aranges_read_)
+                {
+                    return;
+                }
+                aranges_read_ = true;
+
+                vector<bool> ranged(compile_units_.size(), false);
+                vector<linkobj_t *>::const_iterator li;
+                for(li = linkobjs_.begin() ; li != linkobjs_.end() ; ++li)
+                {
+                    reader_t ar = (*li)->sections_[DW_sec_aranges].get_contents();
+                    if(!ar.get_remains())
+                    {
+                        continue;
+                    }
+
+                    map<unsigned long, uint32_t> by_offset;
+                    for(uint32_t i = 0 ; i < compile_units_.size() ; i++)
+                    {
+                        if(compile_units_[i]->get_link_object_index() == (*li)->index_)
+                        {
+                            by_offset[compile_units_[i]->get_offset()] = i;
+                        }
+                    }
+
                     for(;;)
                     {
-                        if(!r.read_addr(start) || !r.read_addr(end))
+                        uint32_t length32;
+                        np::spiegel::offset_t length;
+                        bool is64 = false;
+                        if(!ar.read_u32(length32))
                         {
                             break;
                         }
-                        /* (0,0) marks the end of the list */
-                        if(!start && !end)
+                        length = length32;
+                        if(length32 == 0xffffffff)
+                        {
+                            uint64_t length64;
+                            if(!ar.read_u64(length64))
+                            {
+                                break;
+                            }
+                            length = length64;
+                            is64 = true;
+                        }
+                        if(length > ar.get_remains())
                         {
                             break;
                         }
-                        /* (~0,base) marks a new base address */
-                        if(start == _NP_MAXADDR)
+                        reader_t setr = ar.initial_subset(length);
+                        setr.set_is64(is64);
+                        ar.skip(length);
+
+                        /* the tuples are aligned to twice the address
+                         * size, counting from the start of the set */
+                        np::spiegel::offset_t hdrlen = (is64 ? 12 : 4) + 2 + (is64 ? 8 : 4) + 2;
+                        uint16_t version;
+                        np::spiegel::offset_t info_offset;
+                        uint8_t addrsize;
+                        uint8_t segsize;
+                        if(!setr.read_u16(version) ||
+                                version != 2 ||
+                                !setr.read_offset(info_offset) ||
+                                !setr.read_u8(addrsize) ||
+                                !setr.read_u8(segsize) ||
+                                addrsize != sizeof(np::spiegel::addr_t) ||
+                                segsize != 0)
                         {
-                            base = end;
                             continue;
                         }
-                        start += base;
-                        end += base;
-                        if(addr >= start && addr < end)
+                        map<unsigned long, uint32_t>::iterator cui = by_offset.find(info_offset);
+                        if(cui == by_offset.end())
+                        {
+                            continue;
+                        }
+                        setr.skip((2*addrsize - hdrlen % (2*addrsize)) % (2*addrsize));
+
+                        for(;;)
                         {
-                            offset = addr - base;
-                            return true;
+                            np::spiegel::addr_t addr, len;
+                            if(!setr.read_addr(addr) || !setr.read_addr(len) ||
+                                    (!addr && !len))
+                            {
+                                break;
+                            }
+                            /* ranges of discarded code have no length
+                             * or have been moved down to zero */
+                            if(len && addr)
+                            {
+                                aranges_.insert(addr, addr+len, cui->second);
+                            }
                         }
+                        ranged[cui->second] = true;
                     }
                 }
-                if(has_lo)
+
+                for(uint32_t i = 0 ; i < compile_units_.size() ; i++)
                 {
-                    if(addr == lo)
+                    if(!ranged[i])
                     {
-                        offset = 0;
-                        return true;
+                        unranged_.push_back(i);
                     }
-                    return false;
                 }
-                return false;
+                #if _NP_DEBUG
+                fprintf(stderr, "np: [%s] read %u address ranges, %u compile units not covered\n",
+                        np::util::rel_timestamp(), aranges_.size(), (unsigned)unranged_.size());
+                #endif
             }
 
             bool
@@ -886,7 +1231,7 @@ out:
                                       reference_t &curef,
                                       unsigned int &lineno,
                                       reference_t &funcref,
-                                      unsigned int &offset) const
+                                      unsigned int &offset)
             {
                 // initialise all the results to the "dunno" case
                 curef = reference_t::null;
@@ -894,51 +1239,30 @@ out:
                 funcref = reference_t::null;
                 offset = 0;
 
-                if(address_index_.size())
+                np::util::rangetree<addr_t, reference_t>::const_iterator i = address_index_.find(addr);
+                if(i == address_index_.end())
                 {
-                    np::util::rangetree<addr_t, reference_t>::const_iterator i = address_index_.find(addr);
-                    if(i == address_index_.end())
+                    /* index the unit which owns the address, or failing
+                     * that all the units we can't tell about */
+                    read_aranges();
+                    np::util::rangetree<addr_t, uint32_t>::const_iterator a = aranges_.find(addr);
+                    if(a != aranges_.end())
                     {
-                        return false;
+                        index_compile_units(vector<uint32_t>(1, a->second));
                     }
-                    offset = addr - i->first.lo;
-                    funcref = i->second;
-                    return true;
-                }
-
-                vector<compile_unit_t *>::const_iterator i;
-                for(i = compile_units_.begin() ; i != compile_units_.end() ; ++i)
-                {
-                    walker_t w((*i)->make_root_reference());
-                    const entry_t *e = w.move_next();
-                    for(; e ; e = w.move_next())
+                    else
                     {
-                        if(is_within(addr, w, offset))
-                        {
-                            switch(e->get_tag())
-                            {
-                                case DW_TAG_compile_unit:
-                                    curef = w.get_reference();
-                                    e = w.move_down();
-                                    break;
-                                case DW_TAG_subprogram:
-                                    if(e->get_attribute(DW_AT_specification))
-                                    {
-                                        e = w.move_to(e->get_reference_attribute(DW_AT_specification));
-                                    }
-                                    funcref = w.get_reference();
-                                    return true;
-                                case DW_TAG_class_type:
-                                case DW_TAG_structure_type:
-                                case DW_TAG_union_type:
-                                case DW_TAG_namespace_type:
-                                    e = w.move_down();
-                                    break;
-                            }
-                        }
+                        index_compile_units(unranged_);
+                    }
+                    i = address_index_.find(addr);
+                    if(i == address_index_.end())
+                    {
+                        return false;
                     }
                 }
-                return false;
+                offset = addr - i->first.lo;
+                funcref = i->second;
+                return true;
             }
 
             string
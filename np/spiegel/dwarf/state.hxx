@@ -32,6 +32,7 @@ namespace np
 
             class walker_t;
             class compile_unit_t;
+            class abbrev_table_t;
 
             class state_t
             {
@@ -40,7 +41,41 @@ namespace np
                 ~state_t();
 
                 bool add_self();
+                /* Like add_self() but waits until the first call to
+                 * instance(), for callers which may never need DWARF */
+                void add_self_deferred()
+                {
+                    deferred_ = true;
+                }
                 bool add_executable(const char *filename);
+                /* Identifies the DWARF we read, empty if we can't tell */
+                std::string get_build_ids() const;
+
+                /* A function from the ELF symbol table of a link object */
+                struct function_symbol_t
+                {
+                    std::string name_;
+                    np::spiegel::addr_t addr_;	// unrelocated, like the DWARF
+                    uint32_t linkobj_;
+                };
+                /* Returns false if any link object has no symbol table */
+                bool get_function_symbols(std::vector<function_symbol_t> &) const;
+
+                /*
+                 * describe_address() builds the address index as it
+                 * goes, one compile unit at a time, using .debug_aranges
+                 * to find which unit to index.  These build it ahead
+                 * of time: all of it, or just enough that no later
+                 * lookup has to index more than one compile unit.
+                 */
+                void prepare_address_index();
+                void prewarm_address_index();
+                struct address_range_t
+                {
+                    np::spiegel::addr_t lo;
+                    np::spiegel::addr_t hi;
+                    reference_t funcref;
+                };
 
                 void dump_structs();
                 void dump_functions();
@@ -52,12 +87,16 @@ namespace np
                                       reference_t& curef,
                                       unsigned int& lineno,
                                       reference_t& funcref,
-                                      unsigned int& offset) const;
+                                      unsigned int& offset);
                 std::string get_full_name(reference_t ref);
 
                 // state_t is a Singleton
                 static state_t *instance()
                 {
+                    if(instance_ && instance_->deferred_)
+                    {
+                        instance_->add_deferred();
+                    }
                     return instance_;
                 }
 
@@ -79,40 +118,57 @@ namespace np
                     {
                         memset(sections_, 0, sizeof(sections_));
                     }
-                    ~linkobj_t()
-                    {
-                        unmap_sections();
-                        free(filename_);
-                    }
+                    ~linkobj_t();
 
                     char *filename_;
                     uint32_t index_;
+                    std::string build_id_;
                     section_t sections_[DW_sec_num];
                     std::vector<section_t> mappings_;
                     std::vector<np::spiegel::mapping_t> system_mappings_;
+                    // keyed by .debug_abbrev offset and 64-bit format
+                    std::map<std::pair<uint32_t, bool>, abbrev_table_t *> abbrev_tables_;
 
                     bool map_sections();
                     void unmap_sections();
                 };
 
+                void add_deferred();
                 linkobj_t *get_linkobj(const char *filename);
                 bool read_linkobjs();
                 bool read_compile_units(linkobj_t *);
-                /* Prepare an index which will speed up all later calls to describe_address(). */
-                void prepare_address_index();
-
-                void insert_ranges(const walker_t& w, reference_t funcref);
-                bool is_within(np::spiegel::addr_t addr, const walker_t& w,
-                               unsigned int& offset) const;
+                void read_abbrevs(unsigned int first);
+                void read_pubnames(linkobj_t *, unsigned int first);
+                void read_aranges();
+                void index_compile_units(const std::vector<uint32_t> &);
+
+                static address_range_t make_range(np::spiegel::addr_t lo,
+                                                  np::spiegel::addr_t hi,
+                                                  reference_t funcref)
+                {
+                    address_range_t ar;
+                    ar.lo = lo;
+                    ar.hi = hi;
+                    ar.funcref = funcref;
+                    return ar;
+                }
+                void get_ranges(const walker_t& w, reference_t funcref,
+                                std::vector<address_range_t>& res) const;
 
                 static state_t *instance_;
 
+                bool deferred_;
                 std::vector<linkobj_t *> linkobjs_;
                 std::vector<compile_unit_t *> compile_units_;
                 np::util::rangetree<addr_t, reference_t> address_index_;
+                std::vector<bool> indexed_;	// by compile unit
+                bool aranges_read_;
+                np::util::rangetree<addr_t, uint32_t> aranges_;	// to compile unit
+                std::vector<uint32_t> unranged_;	// units missing from aranges_
 
                 friend class walker_t;
                 friend class compile_unit_t;
+                friend class range_finder_t;
             };
 
 
@@ -41,6 +41,7 @@ namespace np
                 reader_ = compile_unit_->get_contents();
                 reader_.seek(ref.offset);
                 level_ = 0;
+                sibling_ = 0;
             }
 
             int walker_t::read_entry()
@@ -78,6 +79,7 @@ namespace np
                 }
 
                 int r = RE_OK;
+                sibling_ = 0;
 
                 if(filter_tag_ && a->tag != filter_tag_)
                 {
@@ -92,11 +94,20 @@ namespace np
                 {
                     entry_.setup(offset, level_, a);
                     r = read_attributes();
+                    const value_t *sib = entry_.get_attribute(DW_AT_sibling);
+                    if(sib && sib->type == value_t::T_REF)
+                    {
+                        sibling_ = sib->val.ref.offset;
+                    }
                 }
 
                 if(a->children)
                 {
                     level_++;
+                    if(r > 0 && prune_tags_ && is_pruned(a->tag))
+                    {
+                        skip_children();
+                    }
                 }
 
                 #if DEBUG_WALK
@@ -117,450 +128,203 @@ namespace np
                 vector<abbrev_t::attr_spec_t>::const_iterator i;
                 for(i = a->attr_specs.begin() ; i != a->attr_specs.end() ; ++i)
                 {
-                    switch(i->form)
+                    if(!i->decode)
                     {
-                        case DW_FORM_data1:
+                        // TODO: bad DWARF info - throw an exception
+                        fatal("Can't handle %s at %s:%d\n",
+                              formvals.to_name(i->form), __FILE__, __LINE__);
+                    }
+                    value_t v;
+                    if(!i->decode(reader_, compile_unit_, v))
+                    {
+                        return RE_EOF;
+                    }
+                    entry_.add_attribute(v);
+                }
+                return RE_OK;
+            }
+
+            int walker_t::skip_attributes()
+            {
+                const abbrev_t *a = entry_.get_abbrev();
+
+                if(a->sibling_at >= 0)
+                {
+                    reader_t r = reader_;
+                    uint64_t off = 0;
+                    r.skip(a->sibling_at);
+                    switch(a->sibling_size)
+                    {
+                        case 1:
                         {
                             uint8_t v;
-                            if(!reader_.read_u8(v))
+                            if(r.read_u8(v))
                             {
-                                return RE_EOF;
+                                off = v;
                             }
-                            entry_.add_attribute(i->name, value_t::make_uint32(v));
                             break;
                         }
-                        case DW_FORM_data2:
+                        case 2:
                         {
                             uint16_t v;
-                            if(!reader_.read_u16(v))
-                            {
-                                return RE_EOF;
-                            }
-                            entry_.add_attribute(i->name, value_t::make_uint32(v));
-                            break;
-                        }
-                        case DW_FORM_data4:
-                        {
-                            uint32_t v;
-                            if(!reader_.read_u32(v))
-                            {
-                                return RE_EOF;
-                            }
-                            entry_.add_attribute(i->name, value_t::make_uint32(v));
-                            break;
-                        }
-                        case DW_FORM_data8:
-                        case DW_FORM_ref_sig8:
-                        {
-                            uint64_t v;
-                            if(!reader_.read_u64(v))
-                            {
-                                return RE_EOF;
-                            }
-                            entry_.add_attribute(i->name, value_t::make_uint64(v));
-                            break;
-                        }
-                        case DW_FORM_udata:
-                        {
-                            uint32_t v;
-                            if(!reader_.read_uleb128(v))
-                            {
-                                return RE_EOF;
-                            }
-                            entry_.add_attribute(i->name, value_t::make_uint32(v));
-                            break;
-                        }
-                        case DW_FORM_sdata:
-                        {
-                            int32_t v;
-                            if(!reader_.read_sleb128(v))
-                            {
-                                return RE_EOF;
-                            }
-                            entry_.add_attribute(i->name, value_t::make_sint32(v));
-                            break;
-                        }
-                        case DW_FORM_addr:
-                        {
-                            np::spiegel::addr_t v;
-                            if(!reader_.read_addr(v))
-                            {
-                                return RE_EOF;
-                            }
-                            entry_.add_attribute(i->name, value_t::make_addr(v));
-                            break;
-                        }
-                        case DW_FORM_flag:
-                        {
-                            uint8_t v;
-                            if(!reader_.read_u8(v))
-                            {
-                                return RE_EOF;
-                            }
-                            entry_.add_attribute(i->name, value_t::make_uint32(v));
-                            break;
-                        }
-                        case DW_FORM_ref1:
-                        {
-                            uint8_t off;
-                            if(!reader_.read_u8(off))
-                            {
-                                return RE_EOF;
-                            }
-                            entry_.add_attribute(i->name,
-                                                 value_t::make_ref(compile_unit_->make_reference(off)));
-                            break;
-                        }
-                        case DW_FORM_ref2:
-                        {
-                            uint16_t off;
-                            if(!reader_.read_u16(off))
+                            if(r.read_u16(v))
                             {
-                                return RE_EOF;
+                                off = v;
                             }
-                            entry_.add_attribute(i->name,
-                                                 value_t::make_ref(compile_unit_->make_reference(off)));
                             break;
                         }
-                        case DW_FORM_ref4:
-                        {
-                            uint32_t off;
-                            if(!reader_.read_u32(off))
-                            {
-                                return RE_EOF;
-                            }
-                            entry_.add_attribute(i->name,
-                                                 value_t::make_ref(compile_unit_->make_reference(off)));
+                        case 4:
+                            r.read_u32(off);
                             break;
-                        }
-                        case DW_FORM_ref8:
-                        {
-                            uint64_t off;
-                            if(!reader_.read_u64(off))
-                            {
-                                return RE_EOF;
-                            }
-                            // TODO: detect truncation
-                            entry_.add_attribute(i->name,
-                                                 value_t::make_ref(compile_unit_->make_reference(off)));
+                    }
+                    sibling_ = off;
+                }
+
+                // the common case is a single pointer bump
+                if(a->fixed_size >= 0)
+                {
+                    return (reader_.skip(a->fixed_size) ? RE_OK : RE_EOF);
+                }
+
+                vector<abbrev_t::skip_op_t>::const_iterator i;
+                for(i = a->skip_ops.begin() ; i != a->skip_ops.end() ; ++i)
+                {
+                    bool ok = false;
+                    switch(i->kind)
+                    {
+                        case abbrev_t::skip_op_t::FIXED:
+                            ok = reader_.skip(i->size);
                             break;
-                        }
-                        case DW_FORM_string:
-                        {
-                            const char *v;
-                            if(!reader_.read_string(v))
-                            {
-                                return RE_EOF;
-                            }
-                            entry_.add_attribute(i->name, value_t::make_string(v));
+                        case abbrev_t::skip_op_t::LEB128:
+                            ok = reader_.skip_leb128s(i->size);
                             break;
-                        }
-                        case DW_FORM_strp:
-                        {
-                            np::spiegel::offset_t off;
-                            if(compile_unit_->get_version() == 2)
-                            {
-                                uint32_t o32;
-                                if(!reader_.read_u32(o32))
-                                {
-                                    return RE_EOF;
-                                }
-                                off = o32;
-                            }
-                            else
-                            {
-                                if(!reader_.read_offset(off))
-                                {
-                                    return RE_EOF;
-                                }
-                            }
-                            const char *v = compile_unit_->get_section(DW_sec_str)->offset_as_string(off);
-                            if(!v)
-                            {
-                                return RE_EOF;
-                            }
-                            entry_.add_attribute(i->name, value_t::make_string(v));
+                        case abbrev_t::skip_op_t::STRING:
+                            ok = reader_.skip_string();
                             break;
-                        }
-                        case DW_FORM_block1:
+                        case abbrev_t::skip_op_t::BLOCK1:
                         {
                             uint8_t len;
-                            const unsigned char *v;
-                            if(!reader_.read_u8(len) ||
-                                    !reader_.read_bytes(v, len))
-                            {
-                                return RE_EOF;
-                            }
-                            entry_.add_attribute(i->name, value_t::make_bytes(v, len));
+                            ok = reader_.read_u8(len) && reader_.skip_bytes(len);
                             break;
                         }
-                        case DW_FORM_block2:
+                        case abbrev_t::skip_op_t::BLOCK2:
                         {
                             uint16_t len;
-                            const unsigned char *v;
-                            if(!reader_.read_u16(len) ||
-                                    !reader_.read_bytes(v, len))
-                            {
-                                return RE_EOF;
-                            }
-                            entry_.add_attribute(i->name, value_t::make_bytes(v, len));
+                            ok = reader_.read_u16(len) && reader_.skip_bytes(len);
                             break;
                         }
-                        case DW_FORM_block4:
+                        case abbrev_t::skip_op_t::BLOCK4:
                         {
                             uint32_t len;
-                            const unsigned char *v;
-                            if(!reader_.read_u32(len) ||
-                                    !reader_.read_bytes(v, len))
-                            {
-                                return RE_EOF;
-                            }
-                            entry_.add_attribute(i->name, value_t::make_bytes(v, len));
+                            ok = reader_.read_u32(len) && reader_.skip_bytes(len);
                             break;
                         }
-                        case DW_FORM_block:
-                        case DW_FORM_exprloc:
+                        case abbrev_t::skip_op_t::BLOCK:
                         {
                             uint32_t len;
-                            const unsigned char *v;
-                            if(!reader_.read_uleb128(len) ||
-                                    !reader_.read_bytes(v, len))
-                            {
-                                return RE_EOF;
-                            }
-                            entry_.add_attribute(i->name, value_t::make_bytes(v, len));
+                            ok = reader_.read_uleb128(len) && reader_.skip_bytes(len);
                             break;
                         }
-                        case DW_FORM_sec_offset:
-                        {
-                            np::spiegel::offset_t v;
-                            if(!reader_.read_offset(v))
-                            {
-                                return RE_EOF;
-                            }
-                            entry_.add_attribute(i->name, value_t::make_offset(v));
-                            break;
-                        }
-                        case DW_FORM_flag_present:
-                            /* This form has no representation in the attribute
-                             * stream, it's always true.  Presumably this is
-                             * useful in combination with a careful choice of
-                             * abbrevs. */
-                            entry_.add_attribute(i->name, value_t::make_uint32(true));
-                            break;
                         default:
                             // TODO: bad DWARF info - throw an exception
                             fatal("Can't handle %s at %s:%d\n",
-                                  formvals.to_name(i->form), __FILE__, __LINE__);
+                                  formvals.to_name(i->size), __FILE__, __LINE__);
+                    }
+                    if(!ok)
+                    {
+                        return RE_EOF;
                     }
                 }
                 return RE_OK;
             }
 
-            int walker_t::skip_attributes()
+
+            bool walker_t::is_pruned(unsigned tag) const
             {
-                const abbrev_t *a = entry_.get_abbrev();
-                vector<abbrev_t::attr_spec_t>::const_iterator i;
-                for(i = a->attr_specs.begin() ; i != a->attr_specs.end() ; ++i)
+                for(const unsigned *t = prune_tags_ ; *t ; t++)
                 {
-                    switch(i->form)
+                    if(*t == tag)
                     {
-                        case DW_FORM_data1:
-                            if(!reader_.skip_u8())
-                            {
-                                return EOF;
-                            }
-                            break;
-                        case DW_FORM_data2:
-                            if(!reader_.skip_u16())
-                            {
-                                return EOF;
-                            }
-                            break;
-                        case DW_FORM_data4:
-                            if(!reader_.skip_u32())
-                            {
-                                return EOF;
-                            }
-                            break;
-                        case DW_FORM_data8:
-                            if(!reader_.skip_u64())
-                            {
-                                return EOF;
-                            }
-                            break;
-                        case DW_FORM_udata:
-                            if(!reader_.skip_uleb128())
-                            {
-                                return EOF;
-                            }
-                            break;
-                        case DW_FORM_sdata:
-                            if(!reader_.skip_sleb128())
-                            {
-                                return EOF;
-                            }
-                            break;
-                        case DW_FORM_addr:
-                            if(sizeof(unsigned long) == 4)
-                            {
-                                if(!reader_.skip_u32())
-                                {
-                                    return EOF;
-                                }
-                            }
-                            else if(sizeof(unsigned long) == 8)
-                            {
-                                if(!reader_.skip_u64())
-                                {
-                                    return EOF;
-                                }
-                            }
-                            else
-                            {
-                                fatal("Strange addrsize %u", (unsigned)sizeof(unsigned long));
-                            }
-                            break;
-                        case DW_FORM_flag:
-                            if(!reader_.skip_u8())
-                            {
-                                return EOF;
-                            }
-                            break;
-                        case DW_FORM_ref1:
-                            if(!reader_.skip_u8())
-                            {
-                                return EOF;
-                            }
-                            break;
-                        case DW_FORM_ref2:
-                            if(!reader_.skip_u16())
-                            {
-                                return EOF;
-                            }
-                            break;
-                        case DW_FORM_ref4:
-                            if(!reader_.skip_u32())
-                            {
-                                return EOF;
-                            }
-                            break;
-                        case DW_FORM_ref8:
-                            if(!reader_.skip_u64())
-                            {
-                                return EOF;
-                            }
-                            break;
-                        case DW_FORM_string:
-                            if(!reader_.skip_string())
-                            {
-                                return EOF;
-                            }
-                            break;
-                        case DW_FORM_strp:
-                            if(compile_unit_->get_version() == 2)
-                            {
-                                if(!reader_.skip_u32())
-                                {
-                                    return EOF;
-                                }
-                            }
-                            else
-                            {
-                                if(!reader_.skip_offset())
-                                {
-                                    return EOF;
-                                }
-                            }
-                            break;
-                        case DW_FORM_block1:
-                        {
-                            uint8_t len;
-                            if(!reader_.read_u8(len) ||
-                                    !reader_.skip_bytes(len))
-                            {
-                                return EOF;
-                            }
-                            break;
-                        }
-                        case DW_FORM_block2:
-                        {
-                            uint16_t len;
-                            if(!reader_.read_u16(len) ||
-                                    !reader_.skip_bytes(len))
-                            {
-                                return EOF;
-                            }
-                            break;
-                        }
-                        case DW_FORM_block4:
-                        {
-                            uint32_t len;
-                            if(!reader_.read_u32(len) ||
-                                    !reader_.skip_bytes(len))
-                            {
-                                return EOF;
-                            }
-                            break;
-                        }
-                        case DW_FORM_block:
-                        case DW_FORM_exprloc:
-                        {
-                            uint32_t len;
-                            if(!reader_.read_uleb128(len) ||
-                                    !reader_.skip_bytes(len))
-                            {
-                                return EOF;
-                            }
-                        }
-                        break;
-                        case DW_FORM_sec_offset:
-                            reader_.skip_offset();
-                            break;
-                        case DW_FORM_flag_present:
-                            /* Nothing to skip */
-                            break;
-                        case DW_FORM_ref_sig8:
-                            reader_.skip_u64();
-                            break;
-                        default:
-                            // TODO: bad DWARF info - throw an exception
-                            fatal("Can't handle %s at %s:%d\n",
-                                  formvals.to_name(i->form), __FILE__, __LINE__);
+                        return true;
                     }
                 }
-                return RE_OK;
+                return false;
             }
 
+            void walker_t::skip_children()
+            {
+                if(level_ <= entry_.get_level())
+                {
+                    return;    // no children, or we already left them
+                }
+                uint32_t end = sibling_;
+                if(!end)
+                {
+                    const compile_unit_t::die_t *d = compile_unit_->find_die(entry_.get_offset());
+                    if(!d)
+                    {
+                        return;
+                    }
+                    end = d->end_;
+                }
+                reader_.seek(end);
+                level_ = entry_.get_level();
+            }
 
-            vector<reference_t> walker_t::get_path() const
+            void walker_t::index_dies(vector<compile_unit_t::die_t> &dies)
             {
-                walker_t w2(compile_unit_);
-                vector<reference_t> path;
+                vector<uint32_t> parents;
 
                 for(;;)
                 {
-                    int r = w2.read_entry();
-                    if(r == RE_EOF)
+                    uint32_t offset = reader_.get_offset();
+                    uint32_t acode;
+                    if(!reader_.read_uleb128(acode))
                     {
                         break;
                     }
-                    if(r == RE_EOL)
+                    if(!acode)
                     {
-                        path.pop_back();
+                        if(parents.empty())
+                        {
+                            break;
+                        }
+                        dies[parents.back()].end_ = reader_.get_offset();
+                        parents.pop_back();
                         continue;
                     }
-                    // treat RE_FILTERED like RE_OK
-                    path.push_back(w2.get_reference());
-                    if(get_reference() == w2.get_reference())
+
+                    const abbrev_t *a = compile_unit_->get_abbrev(acode);
+                    if(!a)
+                    {
+                        fatal("XXX wtf - no abbrev for code 0x%x\n", acode);
+                    }
+                    entry_.partial_setup(offset, parents.size(), a);
+                    if(skip_attributes() != RE_OK)
                     {
                         break;
                     }
-                    if(!w2.entry_.has_children())
+
+                    compile_unit_t::die_t d;
+                    d.offset_ = offset;
+                    d.end_ = reader_.get_offset();
+                    d.parent_ = (parents.empty() ? (uint32_t)compile_unit_t::no_parent : parents.back());
+                    dies.push_back(d);
+                    if(a->children)
                     {
-                        path.pop_back();
+                        parents.push_back(dies.size() - 1);
                     }
                 }
+            }
+
+            vector<reference_t> walker_t::get_path() const
+            {
+                vector<reference_t> path;
+                const compile_unit_t::die_t *d = compile_unit_->find_die(entry_.get_offset());
+                for( ; d ; d = compile_unit_->get_parent(d))
+                {
+                    path.insert(path.begin(), compile_unit_->make_reference(d->offset_));
+                }
                 return path;
             }
 
@@ -600,11 +364,7 @@ namespace np
 
             const entry_t *walker_t::move_next()
             {
-                const value_t *sib = entry_.get_attribute(DW_AT_sibling);
-                if(sib && sib->type == value_t::T_REF)
-                {
-                    return move_to(sib->val.ref);
-                }
+                skip_children();
 
                 unsigned target_level = entry_.get_level();
                 int r = 0;
@@ -622,9 +382,13 @@ namespace np
                     {
                         RETURN(0);
                     }
-                    if(r == RE_OK && entry_.get_level() == target_level)
+                    if(entry_.get_level() == target_level)
                     {
-                        RETURN(&entry_);
+                        if(r == RE_OK)
+                        {
+                            RETURN(&entry_);
+                        }
+                        skip_children();
                     }
                 }
             }
@@ -632,9 +396,9 @@ namespace np
             const entry_t *walker_t::move_down()
             {
                 int r = 0;
-                if(!entry_.has_children())
+                if(level_ <= entry_.get_level())
                 {
-                    RETURN(0);
+                    RETURN(0);    // no children, or they were pruned
                 }
                 r = read_entry();
                 RETURN(r == RE_OK ? &entry_ : 0);
@@ -649,10 +413,10 @@ namespace np
 
             const entry_t *walker_t::move_up()
             {
-                vector<reference_t> path = get_path();
-                if(path.size() > 1)
+                const compile_unit_t::die_t *d = compile_unit_->find_die(entry_.get_offset());
+                if(d && (d = compile_unit_->get_parent(d)))
                 {
-                    return move_to(path[path.size() - 2]);
+                    return move_to(compile_unit_->make_reference(d->offset_));
                 }
                 return 0;
             }
@@ -32,31 +32,33 @@ namespace np
             {
               public:
                 walker_t(compile_unit_t *cu)
-                    :  id_(next_id_++),
+                    :  id_(__sync_fetch_and_add(&next_id_, 1)),
                        compile_unit_(cu),
                        reader_(cu->get_contents()),
                        level_(0),
-                       filter_tag_(0)
+                       filter_tag_(0),
+                       prune_tags_(0),
+                       sibling_(0)
                 {
                 }
 
                 walker_t(const walker_t& o)
-                    :  id_(next_id_++),
+                    :  id_(__sync_fetch_and_add(&next_id_, 1)),
                        compile_unit_(o.compile_unit_),
                        reader_(o.reader_),
-                       // Note: we don't clone the entry, on the assumption
-                       // that it's about to be clobbered anyway
+                       entry_(o.entry_),
                        level_(o.level_),
-                       filter_tag_(o.filter_tag_)
+                       filter_tag_(o.filter_tag_),
+                       prune_tags_(o.prune_tags_),
+                       sibling_(o.sibling_)
                 {
-                    // but we need the entry's level for the move
-                    // operations to work correctly
-                    entry_.partial_setup(o.entry_);
                 }
 
                 walker_t(reference_t ref)
-                    :  id_(next_id_++),
-                       filter_tag_(0)
+                    :  id_(__sync_fetch_and_add(&next_id_, 1)),
+                       filter_tag_(0),
+                       prune_tags_(0),
+                       sibling_(0)
                 {
                     seek(ref);
                 }
@@ -94,6 +96,19 @@ namespace np
                 {
                     filter_tag_ = tag;
                 }
+                // move_preorder() will not descend into the children
+                // of entries with any of these tags; the array is
+                // terminated by a 0 and must outlive the walker
+                void set_prune_tags(const unsigned *tags)
+                {
+                    prune_tags_ = tags;
+                }
+                // jump over the children of the current entry, so
+                // that the next move is to its next sibling
+                void skip_children();
+
+                // skim the whole compile unit to build its DIE index
+                void index_dies(std::vector<compile_unit_t::die_t> &dies);
 
               private:
                 enum read_entry_results_t
@@ -108,6 +123,7 @@ namespace np
                 int read_entry();
                 int read_attributes();
                 int skip_attributes();
+                bool is_pruned(unsigned tag) const;
 
                 // for debugging only
                 static uint32_t next_id_;
@@ -118,6 +134,8 @@ namespace np
                 entry_t entry_;
                 unsigned level_;
                 unsigned filter_tag_;
+                const unsigned *prune_tags_;
+                uint32_t sibling_;	// DW_AT_sibling of entry_, or 0
             };
 
 
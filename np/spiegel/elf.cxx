@@ -0,0 +1,280 @@
+/*
+ * Copyright 2011-2012 Gregory Banks
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "np/spiegel/elf.hxx"
+#include <elf.h>
+#include <fcntl.h>
+
+namespace np
+{
+    namespace spiegel
+    {
+        using namespace std;
+        using namespace np::util;
+
+        static bool read_at(int fd, const char *filename,
+                            void *buf, size_t len, unsigned long off)
+        {
+            ssize_t r = pread(fd, buf, len, off);
+            if(r < 0)
+            {
+                perror(filename);
+                return false;
+            }
+            if((size_t)r != len)
+            {
+                fprintf(stderr, "np: %s: truncated ELF object\n", filename);
+                return false;
+            }
+            return true;
+        }
+
+        /* Reads the section headers and the section name table */
+        template<class Ehdr, class Shdr>
+        static bool read_headers(int fd, const char *filename,
+                                 vector<Shdr> &shdrs, vector<char> &strtab)
+        {
+            Ehdr eh;
+            if(!read_at(fd, filename, &eh, sizeof(eh), 0))
+            {
+                return false;
+            }
+            if(!eh.e_shoff)
+            {
+                return true;    /* no sections at all */
+            }
+            if(eh.e_shentsize != sizeof(Shdr))
+            {
+                fprintf(stderr, "np: %s: bad ELF section header size %u\n",
+                        filename, (unsigned)eh.e_shentsize);
+                return false;
+            }
+
+            /* Large counts and indexes live in the first section header */
+            Shdr sh0;
+            if(!read_at(fd, filename, &sh0, sizeof(sh0), eh.e_shoff))
+            {
+                return false;
+            }
+            unsigned long nsec = (eh.e_shnum ? eh.e_shnum : sh0.sh_size);
+            unsigned long stridx = (eh.e_shstrndx == SHN_XINDEX ? sh0.sh_link : eh.e_shstrndx);
+            if(stridx >= nsec)
+            {
+                fprintf(stderr, "np: %s: bad ELF section name table index %lu\n",
+                        filename, stridx);
+                return false;
+            }
+
+            shdrs.resize(nsec);
+            if(!read_at(fd, filename, &shdrs[0], nsec * sizeof(Shdr), eh.e_shoff))
+            {
+                return false;
+            }
+
+            const Shdr &strsh = shdrs[stridx];
+            strtab.assign(strsh.sh_size + 1, '\0');
+            if(strsh.sh_size &&
+                    !read_at(fd, filename, &strtab[0], strsh.sh_size, strsh.sh_offset))
+            {
+                return false;
+            }
+            return true;
+        }
+
+        template<class Ehdr, class Shdr>
+        static bool read_sections(int fd, const char *filename,
+                                  vector<elf_section_t> &sections)
+        {
+            vector<Shdr> shdrs;
+            vector<char> strtab;
+            if(!read_headers<Ehdr, Shdr>(fd, filename, shdrs, strtab))
+            {
+                return false;
+            }
+
+            for(unsigned long i = 1 ; i < shdrs.size() ; i++)
+            {
+                const Shdr &sh = shdrs[i];
+                if(sh.sh_type == SHT_NOBITS || sh.sh_type == SHT_NULL ||
+                        sh.sh_name >= strtab.size() - 1)
+                {
+                    continue;
+                }
+                elf_section_t sec;
+                sec.name_ = &strtab[sh.sh_name];
+                sec.offset_ = sh.sh_offset;
+                sec.size_ = sh.sh_size;
+                sec.compressed_ = !!(sh.sh_flags & SHF_COMPRESSED);
+                sections.push_back(sec);
+            }
+            return true;
+        }
+
+        template<class Ehdr, class Shdr, class Sym>
+        static bool read_symbols(int fd, const char *filename,
+                                 vector<elf_symbol_t> &symbols)
+        {
+            vector<Shdr> shdrs;
+            vector<char> shstrtab;
+            if(!read_headers<Ehdr, Shdr>(fd, filename, shdrs, shstrtab))
+            {
+                return false;
+            }
+
+            unsigned long i;
+            for(i = 1 ; i < shdrs.size() ; i++)
+            {
+                if(shdrs[i].sh_type == SHT_SYMTAB)
+                {
+                    break;
+                }
+            }
+            if(i >= shdrs.size())
+            {
+                return false;   /* stripped */
+            }
+            const Shdr &symsh = shdrs[i];
+            if(symsh.sh_entsize != sizeof(Sym) || symsh.sh_link >= shdrs.size())
+            {
+                fprintf(stderr, "np: %s: bad ELF symbol table\n", filename);
+                return false;
+            }
+
+            const Shdr &strsh = shdrs[symsh.sh_link];
+            vector<char> strtab(strsh.sh_size + 1, '\0');
+            if(strsh.sh_size &&
+                    !read_at(fd, filename, &strtab[0], strsh.sh_size, strsh.sh_offset))
+            {
+                return false;
+            }
+            unsigned long nsyms = symsh.sh_size / sizeof(Sym);
+            if(!nsyms)
+            {
+                return true;
+            }
+            vector<Sym> syms(nsyms);
+            if(!read_at(fd, filename, &syms[0], nsyms * sizeof(Sym), symsh.sh_offset))
+            {
+                return false;
+            }
+
+            for(unsigned long j = 1 ; j < nsyms ; j++)
+            {
+                const Sym &s = syms[j];
+                if(ELF64_ST_TYPE(s.st_info) != STT_FUNC ||
+                        s.st_shndx == SHN_UNDEF ||
+                        !s.st_name || s.st_name >= strsh.sh_size)
+                {
+                    continue;
+                }
+                elf_symbol_t sym;
+                sym.name_ = &strtab[s.st_name];
+                sym.value_ = s.st_value;
+                symbols.push_back(sym);
+            }
+            return true;
+        }
+
+        /*
+         * Opens the file and checks it is a native ELF object,
+         * returning the descriptor and the ELF class or -1.
+         */
+        static int open_elf(const char *filename, unsigned char &elfclass)
+        {
+            int fd = open(filename, O_RDONLY|O_CLOEXEC, 0);
+            if(fd < 0)
+            {
+                perror(filename);
+                return -1;
+            }
+
+            unsigned char ident[EI_NIDENT];
+            if(!read_at(fd, filename, ident, sizeof(ident), 0))
+            {
+                goto fail;
+            }
+            if(memcmp(ident, ELFMAG, SELFMAG))
+            {
+                fprintf(stderr, "np: %s: not an object\n", filename);
+                goto fail;
+            }
+            #if __BYTE_ORDER == __LITTLE_ENDIAN
+            if(ident[EI_DATA] != ELFDATA2LSB)
+            #else
+            if(ident[EI_DATA] != ELFDATA2MSB)
+            #endif
+            {
+                fprintf(stderr, "np: %s: ELF object has foreign byte order\n", filename);
+                goto fail;
+            }
+            if(ident[EI_CLASS] != ELFCLASS32 && ident[EI_CLASS] != ELFCLASS64)
+            {
+                fprintf(stderr, "np: %s: unknown ELF class %u\n",
+                        filename, (unsigned)ident[EI_CLASS]);
+                goto fail;
+            }
+            elfclass = ident[EI_CLASS];
+            return fd;
+
+        fail:
+            close(fd);
+            return -1;
+        }
+
+        bool read_elf_sections(const char *filename, vector<elf_section_t> &sections)
+        {
+            unsigned char elfclass;
+            int fd = open_elf(filename, elfclass);
+            if(fd < 0)
+            {
+                return false;
+            }
+            bool r;
+            if(elfclass == ELFCLASS32)
+            {
+                r = read_sections<Elf32_Ehdr, Elf32_Shdr>(fd, filename, sections);
+            }
+            else
+            {
+                r = read_sections<Elf64_Ehdr, Elf64_Shdr>(fd, filename, sections);
+            }
+            close(fd);
+            return r;
+        }
+
+        bool read_elf_function_symbols(const char *filename, vector<elf_symbol_t> &symbols)
+        {
+            unsigned char elfclass;
+            int fd = open_elf(filename, elfclass);
+            if(fd < 0)
+            {
+                return false;
+            }
+            bool r;
+            if(elfclass == ELFCLASS32)
+            {
+                r = read_symbols<Elf32_Ehdr, Elf32_Shdr, Elf32_Sym>(fd, filename, symbols);
+            }
+            else
+            {
+                r = read_symbols<Elf64_Ehdr, Elf64_Shdr, Elf64_Sym>(fd, filename, symbols);
+            }
+            close(fd);
+            return r;
+        }
+
+        // close namespaces
+    };
+};
@@ -0,0 +1,65 @@
+/*
+ * Copyright 2011-2012 Gregory Banks
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef __np_spiegel_elf_hxx__
+#define __np_spiegel_elf_hxx__ 1
+
+#include "np/spiegel/common.hxx"
+
+namespace np
+{
+    namespace spiegel
+    {
+
+        /* The file shape of one section of an ELF object */
+        struct elf_section_t
+        {
+            std::string name_;
+            unsigned long offset_;
+            unsigned long size_;
+            bool compressed_;	// SHF_COMPRESSED, can't be read in place
+        };
+
+        /*
+         * Just enough of an ELF reader to list the sections of an
+         * object in either ELF class, without the weight of libbfd.
+         * Sections which take no space in the file are left out.
+         * Returns false, having complained on stderr, if the file
+         * can't be read or isn't a native ELF object.
+         */
+        extern bool read_elf_sections(const char *filename,
+                                      std::vector<elf_section_t> &sections);
+
+        /* A function defined in an ELF object */
+        struct elf_symbol_t
+        {
+            std::string name_;
+            unsigned long value_;	// link time address
+        };
+
+        /*
+         * Lists the defined function symbols, local ones included,
+         * from the object's .symtab.  Returns false if the file
+         * can't be read or has been stripped; .dynsym is no use as
+         * a substitute since it lacks the static functions.
+         */
+        extern bool read_elf_function_symbols(const char *filename,
+                                              std::vector<elf_symbol_t> &symbols);
+
+        // close namespaces
+    };
+};
+
+#endif // __np_spiegel_elf_hxx__
@@ -49,6 +49,14 @@ namespace np
             return 0;
         }
 
+        void mapping_t::prefetch() const
+        {
+            if(map_)
+            {
+                madvise(map_, size_, MADV_WILLNEED);
+            }
+        }
+
         void mapping_t::expand_to_pages()
         {
             unsigned long end = page_round_up(offset_ + size_);
@@ -96,6 +96,8 @@ namespace np
 
             int mmap(int fd, bool rw);
             int munmap();
+            /* hint that all of the mapping will be read soon */
+            void prefetch() const;
 
             void expand_to_pages();
 
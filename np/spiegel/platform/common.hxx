@@ -34,6 +34,7 @@ namespace np
             {
                 const char *name;
                 std::vector<np::spiegel::mapping_t> mappings;
+                std::string build_id;	/* in hex, empty if none */
             };
             extern std::vector<linkobj_t> get_linkobjs();
 
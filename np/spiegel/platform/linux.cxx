@@ -135,6 +135,37 @@ namespace np
                 return xstrdup(buf);
             }
 
+            /* Find the GNU build-id note in a loaded PT_NOTE segment */
+            static string get_build_id(const char *p, size_t len)
+            {
+                static const char hex[] = "0123456789abcdef";
+                const char *end = p + len;
+
+                while(p + sizeof(ElfW(Nhdr)) <= end)
+                {
+                    const ElfW(Nhdr) *nh = (const ElfW(Nhdr) *)p;
+                    const char *name = p + sizeof(ElfW(Nhdr));
+                    const char *desc = name + ((nh->n_namesz + 3) & ~3);
+                    p = desc + ((nh->n_descsz + 3) & ~3);
+                    if(p > end)
+                    {
+                        break;
+                    }
+                    if(nh->n_type == NT_GNU_BUILD_ID &&
+                       nh->n_namesz == 4 && !memcmp(name, "GNU", 4))
+                    {
+                        string id;
+                        for(unsigned int i = 0 ; i < nh->n_descsz ; i++)
+                        {
+                            id += hex[(desc[i] >> 4) & 0xf];
+                            id += hex[desc[i] & 0xf];
+                        }
+                        return id;
+                    }
+                }
+                return string();
+            }
+
             static int add_one_linkobj(struct dl_phdr_info *info,
                                        size_t size __attribute__((unused)), // sizeof(*info)
                                        void *closure)
@@ -175,6 +206,12 @@ namespace np
                     lo.mappings.push_back(mapping_t(
                                                           (unsigned long)ph->p_offset, (unsigned long)ph->p_memsz,
                                                           (void *)((unsigned long)info->dlpi_addr + ph->p_vaddr)));
+                    if(ph->p_type == PT_NOTE && !lo.build_id.length())
+                    {
+                        lo.build_id = get_build_id(
+                                (const char *)(info->dlpi_addr + ph->p_vaddr),
+                                ph->p_memsz);
+                    }
                 }
                 vec->push_back(lo);
 
@@ -94,6 +94,8 @@ namespace np
                 {
                     /* fake stack frame for the original function
                      *
+                     *  - padding (for intercept type OTHER only, to keep
+                     *       %rsp aligned as the function expects).
                      *  - saved RBP (for intercept type PUSHBP only, the result of
                      *       the simulated push %rbp instruction).
                      *  - return address
@@ -107,9 +109,10 @@ namespace np
                     x86_64_linux_call_t call;
                     addr_t addr;
                     unsigned long our_rsp;
-                } frame;
+                } frame __attribute__((aligned(16)));
                 unsigned long parent_size;
                 int nstack = 0;
+                int nbase = 0;
 
                 /* address of the breakpoint insn */
                 frame.addr = tramp_uc.uc_mcontext.gregs[REG_RIP] - (using_int3 ? 1 : 0);
@@ -209,6 +212,9 @@ namespace np
                         break;
 
                     case intstate_t::OTHER:
+                        /* the ABI wants %rsp 16-byte aligned before the
+                         * return address is pushed, so skip a word */
+                        nbase = nstack = 1;
                         /* replace the breakpoint with the original insn */
                         *(unsigned char *)frame.addr = tramp_intstate->orig_;
                         VALGRIND_DISCARD_TRANSLATIONS(frame.addr, 1);
@@ -234,7 +240,7 @@ namespace np
                        (void *)(tramp_uc.uc_mcontext.gregs[REG_RSP] + 8),
                        MIN(parent_size, sizeof(frame.stack) - nstack * sizeof(unsigned long)));
                 /* setup the ucontext's RSP register to point at the new stack frame */
-                tramp_uc.uc_mcontext.gregs[REG_RSP] = (unsigned long)&frame;
+                tramp_uc.uc_mcontext.gregs[REG_RSP] = (unsigned long)&frame.stack[nbase];
 
                 /*
                  * Call the BEFORE method.  This call happens late enough that
@@ -69,43 +69,107 @@ namespace np
             return v;
         }
 
-        unsigned int type_t::get_classification() const
+        // Reads the parameters of the function or function type
+        // whose entry the walker is at
+        static void
+        read_parameters(np::spiegel::dwarf::walker_t &w,
+                        vector<_parameter_t> &params,
+                        bool &unspecified)
+        {
+            for(const np::spiegel::dwarf::entry_t *e = w.move_down() ; e ; e = w.move_next())
+            {
+                if(e->get_tag() == DW_TAG_formal_parameter)
+                {
+                    _parameter_t p;
+                    p.type_ = e->get_reference_attribute(DW_AT_type);
+                    p.name_ = e->get_string_attribute(DW_AT_name);
+                    params.push_back(p);
+                }
+                else if(e->get_tag() == DW_TAG_unspecified_parameters)
+                {
+                    unspecified = true;
+                    break;
+                }
+            }
+        }
+
+        void type_t::populate()
         {
             if(ref_ == np::spiegel::dwarf::reference_t::null)
             {
-                return TC_VOID;
+                return;
             }
 
             np::spiegel::dwarf::walker_t w(ref_);
             const np::spiegel::dwarf::entry_t *e = w.move_next();
             if(!e)
+            {
+                return;
+            }
+            valid_ = true;
+            tag_ = e->get_tag();
+            name_ = e->get_string_attribute(DW_AT_name);
+            byte_size_ = e->get_uint32_attribute(DW_AT_byte_size);
+            encoding_ = e->get_uint32_attribute(DW_AT_encoding);
+            type_ = e->get_reference_attribute(DW_AT_type);
+
+            switch(tag_)
+            {
+                case DW_TAG_array_type:
+                    for(e = w.move_down() ; e ; e = w.move_next())
+                    {
+                        uint32_t count;
+                        if(e->get_tag() == DW_TAG_subrange_type &&
+                                ((count = e->get_uint32_attribute(DW_AT_count)) ||
+                                 (count = e->get_uint32_attribute(DW_AT_upper_bound))))
+                        {
+                            dims_.push_back(count);
+                        }
+                    }
+                    break;
+                case DW_TAG_subroutine_type:
+                    read_parameters(w, parameters_, has_unspecified_parameters_);
+                    break;
+            }
+        }
+
+        const type_t *type_t::get_type() const
+        {
+            return _cacher_t::make_type(type_);
+        }
+
+        unsigned int type_t::get_classification() const
+        {
+            if(ref_ == np::spiegel::dwarf::reference_t::null)
+            {
+                return TC_VOID;
+            }
+            if(!valid_)
             {
                 return TC_INVALID;    // TODO: exception
             }
 
-            switch(e->get_tag())
+            switch(tag_)
             {
                 case DW_TAG_base_type:
                 {
-                    uint32_t encoding = e->get_uint32_attribute(DW_AT_encoding);
-                    uint32_t byte_size = e->get_uint32_attribute(DW_AT_byte_size);
-                    switch(encoding)
+                    switch(encoding_)
                     {
                         case DW_ATE_float:
-                            return TC_MAJOR_FLOAT | byte_size;
+                            return TC_MAJOR_FLOAT | byte_size_;
                         case DW_ATE_signed:
                         case DW_ATE_signed_char:
-                            return TC_MAJOR_INTEGER | _TC_SIGNED | byte_size;
+                            return TC_MAJOR_INTEGER | _TC_SIGNED | byte_size_;
                         case DW_ATE_unsigned:
                         case DW_ATE_unsigned_char:
-                            return TC_MAJOR_INTEGER | _TC_UNSIGNED | byte_size;
+                            return TC_MAJOR_INTEGER | _TC_UNSIGNED | byte_size_;
                     }
                     break;
                 }
                 case DW_TAG_typedef:
                 case DW_TAG_volatile_type:
                 case DW_TAG_const_type:
-                    return type_t(e->get_reference_attribute(DW_AT_type)).get_classification();
+                    return get_type()->get_classification();
                 case DW_TAG_pointer_type:
                     return TC_POINTER;
                 case DW_TAG_reference_type:
@@ -117,14 +181,7 @@ namespace np
                 case DW_TAG_class_type:
                     return TC_CLASS;
                 case DW_TAG_enumeration_type:
-                {
-                    uint32_t byte_size = e->get_uint32_attribute(DW_AT_byte_size);
-                    if(!byte_size)
-                    {
-                        byte_size = sizeof(int);
-                    }
-                    return TC_MAJOR_INTEGER | _TC_SIGNED | byte_size;
-                }
+                    return TC_MAJOR_INTEGER | _TC_SIGNED | (byte_size_ ? byte_size_ : sizeof(int));
                 case DW_TAG_array_type:
                     return TC_ARRAY;
             }
@@ -163,39 +220,30 @@ namespace np
             {
                 return 0;    // sizeof(void)
             }
-
-            np::spiegel::dwarf::walker_t w(ref_);
-            const np::spiegel::dwarf::entry_t *e = w.move_next();
-            if(!e)
+            if(!valid_)
             {
                 return 0;    // TODO: exception
             }
 
-            uint32_t byte_size = e->get_uint32_attribute(DW_AT_byte_size);
+            uint32_t byte_size = byte_size_;
 
-            switch(e->get_tag())
+            switch(tag_)
             {
                 case DW_TAG_array_type:
                     if(!byte_size)
                     {
-                        uint32_t element_size = type_t(e->get_reference_attribute(DW_AT_type)).get_sizeof();
-                        for(e = w.move_down() ; e ; e = w.move_next())
+                        vector<uint32_t>::const_iterator i;
+                        for(i = dims_.begin() ; i != dims_.end() ; ++i)
                         {
-                            uint32_t count;
-                            if(e->get_tag() == DW_TAG_subrange_type &&
-                                    ((count = e->get_uint32_attribute(DW_AT_count)) ||
-                                     (count = e->get_uint32_attribute(DW_AT_upper_bound))))
-                            {
-                                byte_size = (byte_size ? byte_size : 1) * count;
-                            }
+                            byte_size = (byte_size ? byte_size : 1) * *i;
                         }
-                        byte_size *= element_size;
+                        byte_size *= get_type()->get_sizeof();
                     }
                     break;
                 case DW_TAG_typedef:
                 case DW_TAG_volatile_type:
                 case DW_TAG_const_type:
-                    return type_t(e->get_reference_attribute(DW_AT_type)).get_sizeof();
+                    return get_type()->get_sizeof();
                 case DW_TAG_pointer_type:
                 case DW_TAG_reference_type:
                     return _NP_ADDRSIZE;
@@ -209,16 +257,12 @@ namespace np
             {
                 return "";
             }
-
-            np::spiegel::dwarf::walker_t w(ref_);
-            const np::spiegel::dwarf::entry_t *e = w.move_next();
-            if(!e)
+            if(!valid_)
             {
                 return "wtf?";
             }
 
-            const char *name = e->get_string_attribute(DW_AT_name);
-            switch(e->get_tag())
+            switch(tag_)
             {
                 case DW_TAG_base_type:
                 case DW_TAG_typedef:
@@ -227,8 +271,7 @@ namespace np
                 case DW_TAG_class_type:
                 case DW_TAG_enumeration_type:
                 case DW_TAG_namespace_type:
-                    return (name ? name : "");
-                    break;
+                    return (name_ ? name_ : "");
                 case DW_TAG_pointer_type:
                 case DW_TAG_reference_type:
                 case DW_TAG_volatile_type:
@@ -237,7 +280,7 @@ namespace np
                 case DW_TAG_subroutine_type:
                     return "";
                 default:
-                    return np::spiegel::dwarf::tagnames.to_name(e->get_tag());
+                    return np::spiegel::dwarf::tagnames.to_name(tag_);
             }
         }
 
@@ -247,31 +290,27 @@ namespace np
             {
                 return (inner.length() ? "void " + inner : "void");
             }
-
-            np::spiegel::dwarf::walker_t w(ref_);
-            const np::spiegel::dwarf::entry_t *e = w.move_next();
-            if(!e)
+            if(!valid_)
             {
                 return (inner.length() ? "wtf? " + inner : "wtf?");
             }
 
             string s;
-
-            const char *name = e->get_string_attribute(DW_AT_name);
-            switch(e->get_tag())
+            const char *name = name_;
+            switch(tag_)
             {
                 case DW_TAG_base_type:
                 case DW_TAG_typedef:
                     s = (name ? name : "wtf?");
                     break;
                 case DW_TAG_pointer_type:
-                    return type_t(e->get_reference_attribute(DW_AT_type)).to_string("*" + inner);
+                    return get_type()->to_string("*" + inner);
                 case DW_TAG_reference_type:
-                    return type_t(e->get_reference_attribute(DW_AT_type)).to_string("&" + inner);
+                    return get_type()->to_string("&" + inner);
                 case DW_TAG_volatile_type:
-                    return type_t(e->get_reference_attribute(DW_AT_type)).to_string("volatile " + inner);
+                    return get_type()->to_string("volatile " + inner);
                 case DW_TAG_const_type:
-                    return type_t(e->get_reference_attribute(DW_AT_type)).to_string("const " + inner);
+                    return get_type()->to_string("const " + inner);
                 case DW_TAG_structure_type:
                     s = string("struct ") + (name ? name : "{...}");
                     break;
@@ -289,65 +328,46 @@ namespace np
                     break;
                 case DW_TAG_array_type:
                 {
-                    type_t element_type(e->get_reference_attribute(DW_AT_type));
-                    bool found = false;
-                    for(e = w.move_down() ; e ; e = w.move_next())
+                    vector<uint32_t>::const_iterator i;
+                    for(i = dims_.begin() ; i != dims_.end() ; ++i)
                     {
-                        uint32_t count;
-                        if(e->get_tag() == DW_TAG_subrange_type &&
-                                ((count = e->get_uint32_attribute(DW_AT_count)) ||
-                                 (count = e->get_uint32_attribute(DW_AT_upper_bound))))
-                        {
-                            // TODO: unuglify this
-                            char buf[32];
-                            snprintf(buf, sizeof(buf), "[%u]", count);
-                            inner += buf;
-                            found = true;
-                        }
+                        // TODO: unuglify this
+                        char buf[32];
+                        snprintf(buf, sizeof(buf), "[%u]", *i);
+                        inner += buf;
                     }
-                    if(!found)
+                    if(dims_.empty())
                     {
                         inner += "[]";
                     }
-                    return element_type.to_string(inner);
+                    return get_type()->to_string(inner);
                 }
                 case DW_TAG_subroutine_type:
                 {
                     // TODO: elide the parenethese around inner if it's an identifier
-                    type_t return_type(e->get_reference_attribute(DW_AT_type));
                     inner = "(" + inner + ")(";
-                    bool ellipsis = false;
-                    unsigned int nparam = 0;
-                    for(e = w.move_down() ; e ; e = w.move_next())
+                    vector<_parameter_t>::const_iterator i;
+                    for(i = parameters_.begin() ; i != parameters_.end() ; ++i)
                     {
-                        if(!ellipsis && e->get_tag() == DW_TAG_formal_parameter)
+                        if(i != parameters_.begin())
                         {
-                            if(nparam++)
-                            {
-                                inner += ", ";
-                            }
-                            const char *param = e->get_string_attribute(DW_AT_name);
-                            if(!param)
-                            {
-                                param = "";
-                            }
-                            inner += type_t(e->get_reference_attribute(DW_AT_type)).to_string(param);
+                            inner += ", ";
                         }
-                        else if(e->get_tag() == DW_TAG_unspecified_parameters)
+                        inner += _cacher_t::make_type(i->type_)->to_string(i->name_ ? i->name_ : "");
+                    }
+                    if(has_unspecified_parameters_)
+                    {
+                        if(parameters_.size())
                         {
-                            ellipsis = true;
-                            if(nparam++)
-                            {
-                                inner += ", ";
-                            }
-                            inner += "...";
+                            inner += ", ";
                         }
+                        inner += "...";
                     }
                     inner += ")";
-                    return return_type.to_string(inner);
+                    return get_type()->to_string(inner);
                 }
                 default:
-                    s = np::spiegel::dwarf::tagnames.to_name(e->get_tag());
+                    s = np::spiegel::dwarf::tagnames.to_name(tag_);
                     break;
             }
             if(inner.length())
@@ -400,6 +420,10 @@ namespace np
             low_pc_ = e->get_uint64_attribute(DW_AT_low_pc);
             high_pc_ = e->get_uint64_attribute(DW_AT_high_pc);
             language_ = e->get_uint32_attribute(DW_AT_language);
+            if(e->get_attribute(DW_AT_stmt_list))
+            {
+                read_file_names(w, e->get_uint64_attribute(DW_AT_stmt_list));
+            }
 
             #if _NP_DEBUG
             fprintf(stderr, "np: populated spiegel compile unit %s comp_dir %s "
@@ -414,6 +438,77 @@ namespace np
             return true;
         }
 
+        // Reads the file names from the header of the unit's line
+        // number program, which is all we need of it.  The header
+        // layout is the same for DWARF versions 2 to 4.
+        void compile_unit_t::read_file_names(np::spiegel::dwarf::walker_t &w,
+                                             uint64_t offset)
+        {
+            np::spiegel::dwarf::reader_t r = w.get_section_contents(DW_sec_line);
+            uint32_t length32;
+            uint64_t length;
+            uint16_t version;
+            np::spiegel::offset_t header_length;
+            uint8_t opcode_base;
+
+            if(!r.seek(offset) || !r.read_u32(length32))
+            {
+                return;
+            }
+            if(length32 == 0xffffffff)
+            {
+                if(!r.read_u64(length))
+                {
+                    return;
+                }
+                r.set_is64(true);
+            }
+            // skip minimum_instruction_length, maximum_operations_per_instruction
+            // (version 4 only), default_is_stmt, line_base and line_range,
+            // then the standard_opcode_lengths array
+            if(!r.read_u16(version) || version < 2 || version > 4 ||
+                    !r.read_offset(header_length) ||
+                    !r.skip(version >= 4 ? 5 : 4) ||
+                    !r.read_u8(opcode_base) || !opcode_base ||
+                    !r.skip(opcode_base - 1))
+            {
+                return;
+            }
+
+            vector<const char *> dirs;
+            const char *s;
+            while(r.read_string(s) && *s)
+            {
+                dirs.push_back(s);
+            }
+            while(r.read_string(s) && *s)
+            {
+                uint32_t dir;
+                if(!r.read_uleb128(dir) ||
+                        !r.skip_uleb128() ||    // modification time
+                        !r.skip_uleb128())      // length
+                {
+                    break;
+                }
+                _file_t f;
+                // directory 0 is the compilation directory
+                f.dir_ = (dir && dir <= dirs.size() ? dirs[dir-1] : comp_dir_);
+                f.name_ = s;
+                files_.push_back(f);
+            }
+        }
+
+        filename_t compile_unit_t::get_file_name(uint32_t i) const
+        {
+            if(!i || i > files_.size())
+            {
+                return filename_t();
+            }
+            const _file_t &f = files_[i-1];
+            filename_t dir = filename_t(f.dir_).make_absolute_to_dir(filename_t(comp_dir_));
+            return filename_t(f.name_).make_absolute_to_dir(dir);
+        }
+
         vector<function_t *> compile_unit_t::get_functions()
         {
             np::spiegel::dwarf::walker_t w(ref_);
@@ -436,6 +531,199 @@ namespace np
             return res;
         }
 
+        unsigned int compile_unit_t::num_pubnames_searches_ = 0;
+
+        vector<compile_unit_t::function_ref_t> compile_unit_t::get_function_refs() const
+        {
+            vector<function_ref_t> res;
+
+            // use the compiler's index of names when it made one
+            np::spiegel::dwarf::state_t *state = np::spiegel::dwarf::state_t::instance();
+            np::spiegel::dwarf::compile_unit_t *dcu = state->get_compile_unit(ref_);
+            if(dcu->has_pubnames())
+            {
+                __sync_fetch_and_add(&num_pubnames_searches_, 1);
+                const vector<np::spiegel::dwarf::compile_unit_t::pubname_t> &pns = dcu->get_pubnames();
+                vector<np::spiegel::dwarf::compile_unit_t::pubname_t>::const_iterator i;
+                for(i = pns.begin() ; i != pns.end() ; ++i)
+                {
+                    // qualified C++ names aren't children of DW_TAG_compile_unit
+                    if(strstr(i->name_, "::"))
+                    {
+                        continue;
+                    }
+                    np::spiegel::dwarf::walker_t w(dcu->make_reference(i->offset_));
+                    const np::spiegel::dwarf::entry_t *e = w.move_next();
+                    const char *name;
+                    if(!e || e->get_tag() != DW_TAG_subprogram ||
+                            !(name = e->get_string_attribute(DW_AT_name)))
+                    {
+                        continue;
+                    }
+
+                    function_ref_t fr;
+                    fr.name_ = name;
+                    fr.address_ = e->get_address_attribute(DW_AT_low_pc);
+                    fr.ref_ = w.get_reference();
+                    res.push_back(fr);
+                }
+                return res;
+            }
+
+            np::spiegel::dwarf::walker_t w(ref_);
+            // move to DW_TAG_compile_unit
+            w.move_next();
+
+            // scan children of DW_TAG_compile_unit for functions
+            for(const np::spiegel::dwarf::entry_t *e = w.move_down() ; e ; e = w.move_next())
+            {
+                const char *name;
+                if(e->get_tag() != DW_TAG_subprogram ||
+                        !(name = e->get_string_attribute(DW_AT_name)))
+                {
+                    continue;
+                }
+
+                function_ref_t fr;
+                fr.name_ = name;
+                fr.address_ = e->get_address_attribute(DW_AT_low_pc);
+                fr.ref_ = w.get_reference();
+                res.push_back(fr);
+            }
+            return res;
+        }
+
+        bool compile_unit_t::get_function_ref_at(addr_t addr, function_ref_t &fr)
+        {
+            np::spiegel::dwarf::state_t *state = np::spiegel::dwarf::state_t::instance();
+            np::spiegel::dwarf::reference_t curef;
+            np::spiegel::dwarf::reference_t funcref;
+            unsigned int lineno;
+            unsigned int offset;
+            if(!state->describe_address(addr, curef, lineno, funcref, offset) || offset)
+            {
+                return false;
+            }
+
+            np::spiegel::dwarf::walker_t w(funcref);
+            const np::spiegel::dwarf::entry_t *e = w.move_next();
+            const char *name;
+            if(!e || e->get_tag() != DW_TAG_subprogram ||
+                    !(name = e->get_string_attribute(DW_AT_name)))
+            {
+                return false;
+            }
+            fr.name_ = name;
+            fr.address_ = e->get_address_attribute(DW_AT_low_pc);
+            fr.ref_ = w.get_reference();
+            return true;
+        }
+
+        // Returns true if the type is const-qualified, so that a
+        // variable of that type will have been placed in a read-only
+        // section by the linker.
+        static bool is_readonly_type(np::spiegel::dwarf::reference_t ref)
+        {
+            while(!(ref == np::spiegel::dwarf::reference_t::null))
+            {
+                np::spiegel::dwarf::walker_t w(ref);
+                const np::spiegel::dwarf::entry_t *e = w.move_next();
+                if(!e)
+                {
+                    return false;
+                }
+                switch(e->get_tag())
+                {
+                    case DW_TAG_const_type:
+                        return true;
+                    case DW_TAG_typedef:
+                    case DW_TAG_volatile_type:
+                    case DW_TAG_array_type:
+                        ref = e->get_reference_attribute(DW_AT_type);
+                        break;
+                    default:
+                        return false;
+                }
+            }
+            return false;
+        }
+
+        /* Variables with a fixed address are never declared inside these */
+        static const unsigned addressless_scope_tags[] =
+        {
+            DW_TAG_class_type,
+            DW_TAG_enumeration_type,
+            DW_TAG_structure_type,
+            DW_TAG_subroutine_type,
+            DW_TAG_union_type,
+            0
+        };
+
+        vector<pair<addr_t, size_t> > compile_unit_t::get_variable_extents()
+        {
+            np::spiegel::dwarf::walker_t w(ref_);
+            // move to DW_TAG_compile_unit
+            w.move_next();
+            w.set_prune_tags(addressless_scope_tags);
+
+            vector<pair<addr_t, size_t> > res;
+
+            // scan all the DIEs, to catch static variables in
+            // function scope as well as at file scope
+            while(const np::spiegel::dwarf::entry_t *e = w.move_preorder())
+            {
+                if(e->get_tag() != DW_TAG_variable)
+                {
+                    continue;
+                }
+
+                // Only a location expression consisting of a single
+                // DW_OP_addr describes a fixed address; this excludes
+                // automatic, register and thread-local variables.
+                const np::spiegel::dwarf::value_t *loc = e->get_attribute(DW_AT_location);
+                if(!loc ||
+                        loc->type != np::spiegel::dwarf::value_t::T_BYTES ||
+                        loc->val.bytes.len != 1 + sizeof(addr_t) ||
+                        loc->val.bytes.buf[0] != DW_OP_addr)
+                {
+                    continue;
+                }
+                addr_t addr;
+                memcpy(&addr, loc->val.bytes.buf + 1, sizeof(addr));
+
+                // definitions of variables declared elsewhere, e.g.
+                // static class members, get their type from the
+                // declaration
+                np::spiegel::dwarf::reference_t tref = e->get_reference_attribute(DW_AT_type);
+                if(tref == np::spiegel::dwarf::reference_t::null)
+                {
+                    np::spiegel::dwarf::reference_t spec = e->get_reference_attribute(DW_AT_specification);
+                    if(!(spec == np::spiegel::dwarf::reference_t::null))
+                    {
+                        np::spiegel::dwarf::walker_t w2(spec);
+                        const np::spiegel::dwarf::entry_t *d = w2.move_next();
+                        if(d)
+                        {
+                            tref = d->get_reference_attribute(DW_AT_type);
+                        }
+                    }
+                }
+                if(tref == np::spiegel::dwarf::reference_t::null ||
+                        is_readonly_type(tref))
+                {
+                    continue;
+                }
+
+                size_t size = _cacher_t::make_type(tref)->get_sizeof();
+                if(!addr || !size)
+                {
+                    continue;
+                }
+                res.push_back(make_pair(addr, size));
+            }
+            return res;
+        }
+
         const char *compile_unit_t::get_executable() const
         {
             np::spiegel::dwarf::compile_unit_t *cu =
@@ -474,18 +762,20 @@ namespace np
                         continue;
                 }
                 printf("    Type %s at 0x%x\n", tagname, e->get_offset());
-                type_t type(w.get_reference());
-                printf("        to_string=\"%s\"\n", type.to_string().c_str());
-                printf("        sizeof=%u\n", type.get_sizeof());
+                const type_t *type = _cacher_t::make_type(w.get_reference());
+                printf("        to_string=\"%s\"\n", type->to_string().c_str());
+                printf("        sizeof=%u\n", type->get_sizeof());
                 printf("        classification=%u (%s)\n",
-                       type.get_classification(),
-                       type.get_classification_as_string().c_str());
+                       type->get_classification(),
+                       type->get_classification_as_string().c_str());
             }
         }
 
         member_t::member_t(np::spiegel::dwarf::walker_t &w)
             :  _cacheable_t(w.get_reference()),
-               name_(w.get_entry()->get_string_attribute(DW_AT_name))
+               name_(w.get_entry()->get_string_attribute(DW_AT_name)),
+               decl_file_(w.get_entry()->get_uint32_attribute(DW_AT_decl_file)),
+               decl_line_(w.get_entry()->get_uint32_attribute(DW_AT_decl_line))
         {
             if(!name_)
             {
@@ -493,6 +783,12 @@ namespace np
             }
         }
 
+        filename_t member_t::get_declaration_file() const
+        {
+            const compile_unit_t *cu = get_compile_unit();
+            return (cu ? cu->get_file_name(decl_file_) : filename_t());
+        }
+
         const compile_unit_t *member_t::get_compile_unit() const
         {
             np::spiegel::dwarf::state_t *state = np::spiegel::dwarf::state_t::instance();
@@ -506,29 +802,30 @@ namespace np
             return state->get_full_name(ref_);
         }
 
+        function_t::function_t(np::spiegel::dwarf::walker_t &w)
+            :  member_t(w),
+               has_unspecified_parameters_(false)
+        {
+            const np::spiegel::dwarf::entry_t *e = w.get_entry();
+            address_ = e->get_address_attribute(DW_AT_low_pc);
+            return_type_ = e->get_reference_attribute(DW_AT_type);
+            // don't disturb the caller's walk
+            np::spiegel::dwarf::walker_t w2(w);
+            read_parameters(w2, parameters_, has_unspecified_parameters_);
+        }
+
         type_t *function_t::get_return_type() const
         {
-            np::spiegel::dwarf::walker_t w(ref_);
-            const np::spiegel::dwarf::entry_t *e = w.move_next();
-            return _cacher_t::make_type(e->get_reference_attribute(DW_AT_type));
+            return _cacher_t::make_type(return_type_);
         }
 
         vector<type_t *> function_t::get_parameter_types() const
         {
             vector<type_t *> res;
-
-            np::spiegel::dwarf::walker_t w(ref_);
-            const np::spiegel::dwarf::entry_t *e = w.move_next();
-            for(e = w.move_down() ; e ; e = w.move_next())
+            vector<_parameter_t>::const_iterator i;
+            for(i = parameters_.begin() ; i != parameters_.end() ; ++i)
             {
-                if(e->get_tag() == DW_TAG_formal_parameter)
-                {
-                    res.push_back(_cacher_t::make_type(e->get_reference_attribute(DW_AT_type)));
-                }
-                else if(e->get_tag() == DW_TAG_unspecified_parameters)
-                {
-                    break;
-                }
+                res.push_back(_cacher_t::make_type(i->type_));
             }
             return res;
         }
@@ -536,77 +833,42 @@ namespace np
         vector<const char *> function_t::get_parameter_names() const
         {
             vector<const char *> res;
-
-            np::spiegel::dwarf::walker_t w(ref_);
-            const np::spiegel::dwarf::entry_t *e = w.move_next();
-            for(e = w.move_down() ; e ; e = w.move_next())
+            vector<_parameter_t>::const_iterator i;
+            for(i = parameters_.begin() ; i != parameters_.end() ; ++i)
             {
-                if(e->get_tag() == DW_TAG_formal_parameter)
-                {
-                    const char *name = e->get_string_attribute(DW_AT_name);
-                    if(!name || !*name)
-                    {
-                        name = "<unknown>";
-                    }
-                    res.push_back(name);
-                }
-                else if(e->get_tag() == DW_TAG_unspecified_parameters)
-                {
-                    break;
-                }
+                res.push_back(i->name_ && *i->name_ ? i->name_ : "<unknown>");
             }
             return res;
         }
 
         bool function_t::has_unspecified_parameters() const
         {
-            np::spiegel::dwarf::walker_t w(ref_);
-            const np::spiegel::dwarf::entry_t *e = w.move_next();
-            for(e = w.move_down() ; e ; e = w.move_next())
-            {
-                if(e->get_tag() == DW_TAG_unspecified_parameters)
-                {
-                    return true;
-                }
-            }
-            return false;
+            return has_unspecified_parameters_;
         }
 
         string function_t::to_string() const
         {
-            np::spiegel::dwarf::walker_t w(ref_);
-            const np::spiegel::dwarf::entry_t *e = w.move_next();
-            type_t return_type(e->get_reference_attribute(DW_AT_type));
             string inner = name_;
             inner += "(";
-            unsigned int nparam = 0;
-            for(e = w.move_down() ; e ; e = w.move_next())
+            vector<_parameter_t>::const_iterator i;
+            for(i = parameters_.begin() ; i != parameters_.end() ; ++i)
             {
-                if(e->get_tag() == DW_TAG_formal_parameter)
+                if(i != parameters_.begin())
                 {
-                    if(nparam++)
-                    {
-                        inner += ", ";
-                    }
-                    const char *param = e->get_string_attribute(DW_AT_name);
-                    if(!param)
-                    {
-                        param = "";
-                    }
-                    inner += type_t(e->get_reference_attribute(DW_AT_type)).to_string(param);
+                    inner += ", ";
                 }
-                else if(e->get_tag() == DW_TAG_unspecified_parameters)
+                inner += _cacher_t::make_type(i->type_)->to_string(i->name_ ? i->name_ : "");
+            }
+            if(has_unspecified_parameters_)
+            {
+                if(parameters_.size())
                 {
-                    if(nparam++)
-                    {
-                        inner += ", ";
-                    }
-                    inner += "...";
-                    break;
+                    inner += ", ";
                 }
+                inner += "...";
             }
             inner += ")";
-            return return_type.to_string(inner);
+            return get_return_type()->to_string(inner);
         }
 
         // Return the address of the function, or 0 if the function is not
@@ -614,9 +876,7 @@ namespace np
         // some other compile unit).
         addr_t function_t::get_address() const
         {
-            np::spiegel::dwarf::walker_t w(ref_);
-            const np::spiegel::dwarf::entry_t *e = w.move_next();
-            return e->get_address_attribute(DW_AT_low_pc);
+            return address_;
         }
 
         #if SPIEGEL_DYNAMIC
@@ -672,22 +932,83 @@ namespace np
             return true;
         }
 
-        map<np::spiegel::dwarf::reference_t, _cacheable_t *> _cacher_t::cache_;
+        vector<vector<_cacheable_t *> > _cacher_t::cache_;
+        vector<bool> _cacher_t::filled_;
+        type_t _cacher_t::void_type_(np::spiegel::dwarf::reference_t::null);
 
-        _cacheable_t *_cacher_t::find(np::spiegel::dwarf::reference_t ref)
+        // Returns the slot for the object made from the DIE, or 0
+        // if the reference doesn't point at a DIE
+        _cacheable_t **_cacher_t::find(np::spiegel::dwarf::reference_t ref)
         {
-            std::map<np::spiegel::dwarf::reference_t, _cacheable_t *>::const_iterator i = cache_.find(ref);
-            if(i == cache_.end())
+            np::spiegel::dwarf::state_t *state = np::spiegel::dwarf::state_t::instance();
+            np::spiegel::dwarf::compile_unit_t *dcu = state->get_compile_unit(ref);
+            int ord = dcu->get_die_ordinal(ref.offset);
+            if(ord < 0)
             {
                 return 0;
             }
-            return i->second;
+            if(ref.cu >= cache_.size())
+            {
+                cache_.resize(ref.cu + 1);
+            }
+            vector<_cacheable_t *> &table = cache_[ref.cu];
+            if(table.empty())
+            {
+                table.resize(dcu->get_num_dies(), 0);
+            }
+            return &table[ord];
         }
 
-        _cacheable_t *_cacher_t::add(_cacheable_t *cc)
+        // The first time a function or type is wanted from a compile
+        // unit, make the records for all the functions and types at
+        // the top level of that unit in a single walk, rather than
+        // walking to each one as it's asked for.
+        void _cacher_t::fill(np::spiegel::dwarf::reference_t ref)
         {
-            cache_[cc->ref_] = cc;
-            return cc;
+            if(ref.cu >= filled_.size())
+            {
+                filled_.resize(ref.cu + 1, false);
+            }
+            if(filled_[ref.cu])
+            {
+                return;
+            }
+            // the records made below come back through here
+            filled_[ref.cu] = true;
+
+            np::spiegel::dwarf::state_t *state = np::spiegel::dwarf::state_t::instance();
+            np::spiegel::dwarf::walker_t w(state->get_compile_unit(ref)->make_root_reference());
+            // move to DW_TAG_compile_unit
+            if(!w.move_next())
+            {
+                return;
+            }
+            for(const np::spiegel::dwarf::entry_t *e = w.move_down() ; e ; e = w.move_next())
+            {
+                switch(e->get_tag())
+                {
+                    case DW_TAG_subprogram:
+                        if(e->get_string_attribute(DW_AT_name))
+                        {
+                            make_function(w);
+                        }
+                        break;
+                    case DW_TAG_base_type:
+                    case DW_TAG_pointer_type:
+                    case DW_TAG_reference_type:
+                    case DW_TAG_const_type:
+                    case DW_TAG_volatile_type:
+                    case DW_TAG_typedef:
+                    case DW_TAG_structure_type:
+                    case DW_TAG_union_type:
+                    case DW_TAG_class_type:
+                    case DW_TAG_enumeration_type:
+                    case DW_TAG_array_type:
+                    case DW_TAG_subroutine_type:
+                        make_type(w.get_reference());
+                        break;
+                }
+            }
         }
 
         compile_unit_t *_cacher_t::make_compile_unit(np::spiegel::dwarf::reference_t ref)
@@ -696,38 +1017,59 @@ namespace np
             {
                 return 0;
             }
-            _cacheable_t *cc = find(ref);
-            if(!cc)
+            _cacheable_t **slot = find(ref);
+            if(!slot)
             {
-                cc = add(new compile_unit_t(ref));
+                return 0;
             }
-            compile_unit_t *cu = (compile_unit_t *)cc;
-            if(!cu->populate())
+            if(!*slot)
             {
-                delete cu;
-                return 0;
+                compile_unit_t *cu = new compile_unit_t(ref);
+                if(!cu->populate())
+                {
+                    delete cu;
+                    return 0;
+                }
+                *slot = cu;
             }
-            return cu;
+            return (compile_unit_t *)*slot;
         }
 
         type_t *_cacher_t::make_type(np::spiegel::dwarf::reference_t ref)
         {
-            _cacheable_t *cc = find(ref);
-            if(!cc)
+            if(ref == np::spiegel::dwarf::reference_t::null)
+            {
+                return &void_type_;
+            }
+            fill(ref);
+            _cacheable_t **slot = find(ref);
+            if(slot && *slot)
+            {
+                return (type_t *)*slot;
+            }
+            type_t *type = new type_t(ref);
+            type->populate();
+            if(slot)
             {
-                cc = add(new type_t(ref));
+                *slot = type;
             }
-            return (type_t *)cc;
+            return type;
         }
 
         function_t *_cacher_t::make_function(np::spiegel::dwarf::walker_t &w)
         {
-            _cacheable_t *cc = find(w.get_reference());
-            if(!cc)
+            fill(w.get_reference());
+            _cacheable_t **slot = find(w.get_reference());
+            if(slot && *slot)
             {
-                cc = add(new function_t(w));
+                return (function_t *)*slot;
             }
-            return (function_t *)cc;
+            function_t *fn = new function_t(w);
+            if(slot)
+            {
+                *slot = fn;
+            }
+            return fn;
         }
 
         function_t *_cacher_t::make_function(np::spiegel::dwarf::reference_t ref)
@@ -736,6 +1078,11 @@ namespace np
             {
                 return 0;
             }
+            _cacheable_t **slot = find(ref);
+            if(slot && *slot)
+            {
+                return (function_t *)*slot;
+            }
             np::spiegel::dwarf::walker_t w(ref);
             const np::spiegel::dwarf::entry_t *e = w.move_next();
             return (e ? make_function(w) : 0);
@@ -70,6 +70,10 @@ namespace np
           public:
             _cacheable_t(np::spiegel::dwarf::reference_t ref) : ref_(ref) {}
             ~_cacheable_t() {}
+            np::spiegel::dwarf::reference_t get_reference() const
+            {
+                return ref_;
+            }
 
           protected:
             np::spiegel::dwarf::reference_t ref_;
@@ -93,6 +97,26 @@ namespace np
             //     static compile_unit_t *for_name(const char *name);
 
             std::vector<function_t *> get_functions();
+            // Like get_functions() but makes no function_t objects, so
+            // it's safe to call from several threads at once.
+            struct function_ref_t
+            {
+                const char *name_;
+                addr_t address_;
+                np::spiegel::dwarf::reference_t ref_;
+            };
+            std::vector<function_ref_t> get_function_refs() const;
+            // The function whose code starts at the given link time
+            // address, found using the DWARF address index.
+            static bool get_function_ref_at(addr_t addr, function_ref_t &);
+            // How many units get_function_refs() searched through the
+            // compiler's index of names instead of walking their DIEs.
+            static unsigned int get_num_pubnames_searches()
+            {
+                return num_pubnames_searches_;
+            }
+            // address ranges of writable variables with static storage
+            std::vector<std::pair<addr_t, size_t> > get_variable_extents();
 
             void dump_types();
 
@@ -101,12 +125,24 @@ namespace np
             ~compile_unit_t() {}
 
             bool populate();
+            void read_file_names(np::spiegel::dwarf::walker_t &w, uint64_t offset);
+            np::util::filename_t get_file_name(uint32_t i) const;
 
             const char *name_;
             const char *comp_dir_;
             uint64_t low_pc_;	    // TODO: should be an addr_t
             uint64_t high_pc_;
             uint32_t language_;
+            // source files from the line number program header,
+            // numbered from 1 as DW_AT_decl_file counts them
+            struct _file_t
+            {
+                const char *dir_;
+                const char *name_;
+            };
+            std::vector<_file_t> files_;
+
+            static unsigned int num_pubnames_searches_;
 
             friend class member_t;
             friend class np::spiegel::dwarf::state_t;
@@ -115,6 +151,13 @@ namespace np
 
         std::vector<compile_unit_t *> get_compile_units();
 
+        // a parameter of a function or of a function type
+        struct _parameter_t
+        {
+            np::spiegel::dwarf::reference_t type_;
+            const char *name_;	    // may be 0
+        };
+
         class type_t : public _cacheable_t
         {
           public:
@@ -223,9 +266,34 @@ namespace np
 
           private:
             std::string to_string(std::string inner) const;
-            type_t(np::spiegel::dwarf::reference_t ref) : _cacheable_t(ref) {}
+            type_t(np::spiegel::dwarf::reference_t ref)
+                :  _cacheable_t(ref),
+                   tag_(0),
+                   name_(0),
+                   byte_size_(0),
+                   encoding_(0),
+                   has_unspecified_parameters_(false),
+                   valid_(ref == np::spiegel::dwarf::reference_t::null)
+            {
+                type_ = np::spiegel::dwarf::reference_t::null;
+            }
             ~type_t() {}
 
+            void populate();
+            const type_t *get_type() const;
+
+            // copied from the DIE by populate(), so that none
+            // of the accessors need to walk the DWARF info
+            uint32_t tag_;	    // 0 for void
+            const char *name_;
+            uint32_t byte_size_;
+            uint32_t encoding_;
+            np::spiegel::dwarf::reference_t type_;    // qualified, pointed to, etc
+            std::vector<uint32_t> dims_;	// known array bounds
+            std::vector<_parameter_t> parameters_;    // for function types
+            bool has_unspecified_parameters_;
+            bool valid_;	    // false if the DIE couldn't be read
+
             friend class function_t;
             friend class compile_unit_t;
             friend class _cacher_t;
@@ -239,6 +307,13 @@ namespace np
                 return name_;
             }
             const compile_unit_t *get_compile_unit() const;
+            // where the member was declared, or an empty
+            // filename and line 0 if the compiler didn't say
+            np::util::filename_t get_declaration_file() const;
+            unsigned int get_declaration_line() const
+            {
+                return decl_line_;
+            }
             //     type_t *get_declaring_class() const;
             //     int get_modifiers() const;
 
@@ -247,6 +322,8 @@ namespace np
             ~member_t() {}
 
             const char *name_;
+            uint32_t decl_file_;
+            uint32_t decl_line_;
             friend class _cacher_t;
         };
 
@@ -320,9 +397,14 @@ namespace np
             std::string to_string() const;
 
           private:
-            function_t(np::spiegel::dwarf::walker_t& w) : member_t(w) {}
+            function_t(np::spiegel::dwarf::walker_t& w);
             ~function_t() {}
 
+            addr_t address_;
+            np::spiegel::dwarf::reference_t return_type_;
+            std::vector<_parameter_t> parameters_;
+            bool has_unspecified_parameters_;
+
             friend class compile_unit_t;
             friend class _cacher_t;
         };
@@ -355,10 +437,14 @@ namespace np
             _cacher_t() {}
             ~_cacher_t() {}
 
-            static _cacheable_t *find(np::spiegel::dwarf::reference_t ref);
-            static _cacheable_t *add(_cacheable_t *cc);
+            static _cacheable_t **find(np::spiegel::dwarf::reference_t ref);
+            static void fill(np::spiegel::dwarf::reference_t ref);
 
-            static std::map<np::spiegel::dwarf::reference_t, _cacheable_t *> cache_;
+            // for each compile unit, indexed by the DIE ordinal
+            static std::vector<std::vector<_cacheable_t *> > cache_;
+            // for each compile unit, whether fill() has walked it
+            static std::vector<bool> filled_;
+            static type_t void_type_;
         };
 
         extern std::string describe_stacktrace();
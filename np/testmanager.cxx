@@ -17,14 +17,24 @@
 #include "np/testmanager.hxx"
 #include "np/testnode.hxx"
 #include "np/classifier.hxx"
+#include "np/cache.hxx"
 #include "np/spiegel/spiegel.hxx"
 #include "np/spiegel/dwarf/state.hxx"
+#include "np/spiegel/dwarf/compile_unit.hxx"
+#include "np/spiegel/dwarf/walker.hxx"
+#include "np/util/parallel.hxx"
+#include <algorithm>
+#include <map>
+#include <set>
+#include <fnmatch.h>
+#include <regex.h>
 
 namespace np
 {
     using namespace std;
 
     testmanager_t *testmanager_t::instance_ = 0;
+    vector<classifier_t *> testmanager_t::user_classifiers_;
 
     testmanager_t::testmanager_t()
     {
@@ -34,11 +44,7 @@ namespace np
 
     testmanager_t::~testmanager_t()
     {
-        while(classifiers_.size())
-        {
-            delete classifiers_.back();
-            classifiers_.pop_back();
-        }
+        delete classifiers_;
 
         delete root_;
         if(common_ != root_)
@@ -58,6 +64,8 @@ namespace np
     }
 
 
+    extern void ignore_leaks(bool);
+
     testmanager_t *testmanager_t::instance()
     {
         if(!instance_)
@@ -65,11 +73,14 @@ namespace np
             #if _NP_DEBUG
             fprintf(stderr, "np: creating testmanager_t instance\n");
             #endif
+            /* whatever discovery allocates isn't the tests' leak */
+            ignore_leaks(true);
             new testmanager_t();
             instance_->print_banner();
             instance_->setup_classifiers();
             instance_->discover_functions();
             instance_->setup_builtin_intercepts();
+            ignore_leaks(false);
             /* TODO: check tree for a) leaves without FT_TEST
              * and b) non-leaves with FT_TEST */
             //  instance_->root_->dump(0);
@@ -86,46 +97,76 @@ namespace np
 
     functype_t testmanager_t::classify_function(const char *func,
             char *match_return,
-            size_t maxmatch)
+            size_t maxmatch) const
     {
         if(match_return)
         {
             match_return[0] = '\0';
         }
 
-        vector<classifier_t *>::iterator i;
-        for(i = classifiers_.begin() ; i != classifiers_.end() ; ++i)
-        {
-            functype_t ft = (functype_t)(*i)->classify(func, match_return, maxmatch);
-            if(ft != FT_UNKNOWN)
-            {
-                return ft;
-            }
-            /* else, no match: just keep looking */
-        }
-        return FT_UNKNOWN;
+        return (functype_t)classifiers_->classify(func, match_return, maxmatch, FT_UNKNOWN);
     }
 
-    void testmanager_t::add_classifier(const char *re,
-                                       bool case_sensitive,
-                                       functype_t type)
+    static classifier_t *make_classifier(const char *re,
+                                         bool case_sensitive,
+                                         functype_t type)
     {
         classifier_t *cl = new classifier_t;
         if(!cl->set_regexp(re, case_sensitive))
         {
             delete cl;
-            return;
+            return 0;
         }
         cl->set_results(FT_UNKNOWN, type);
-        classifiers_.push_back(cl);
         #if _NP_DEBUG
         fprintf(stderr, "np: adding classifier /%s/%s -> %s\n",
                 re, (case_sensitive ? "i" : ""), np::as_string(type));
         #endif
+        return cl;
+    }
+
+    void testmanager_t::add_classifier(const char *re,
+                                       bool case_sensitive,
+                                       functype_t type)
+    {
+        classifier_t *cl = make_classifier(re, case_sensitive, type);
+        if(cl)
+        {
+            classifiers_->add(cl);
+        }
+    }
+
+    bool testmanager_t::add_user_classifier(const char *re,
+                                            bool case_sensitive,
+                                            functype_t type)
+    {
+        if(instance_)
+        {
+            fprintf(stderr, "np: classifier /%s/ added too late, "
+                    "tests have already been discovered\n", re);
+            return false;
+        }
+        classifier_t *cl = make_classifier(re, case_sensitive, type);
+        if(!cl)
+        {
+            return false;
+        }
+        user_classifiers_.push_back(cl);
+        return true;
     }
 
     void testmanager_t::setup_classifiers()
     {
+        classifiers_ = new classifier_set_t;
+
+        /* the user's conventions take precedence */
+        vector<classifier_t *>::iterator i;
+        for(i = user_classifiers_.begin() ; i != user_classifiers_.end() ; ++i)
+        {
+            classifiers_->add(*i);
+        }
+        user_classifiers_.clear();
+
         add_classifier("^test_([a-z0-9].*)", false, FT_TEST);
         add_classifier("^[tT]est([A-Z].*)", false, FT_TEST);
         add_classifier("^[sS]etup$", false, FT_BEFORE);
@@ -137,11 +178,12 @@ namespace np
         add_classifier("^mock_(.*)", false, FT_MOCK);
         add_classifier("^[mM]ock([A-Z].*)", false, FT_MOCK);
         add_classifier("^__np_parameter_(.*)", false, FT_PARAM);
+        add_classifier("^__np_valgrind$", false, FT_VALGRIND);
     }
 
-    static string test_name(np::spiegel::function_t *fn, char *submatch)
+    static string test_name(const string &path, const char *submatch)
     {
-        string name = fn->get_compile_unit()->get_absolute_path();
+        string name = path;
 
         /* strip the .c or .cxx extension */
         size_t p = name.find_last_of('.');
@@ -159,23 +201,146 @@ namespace np
         return name;
     }
 
-    np::spiegel::function_t *testmanager_t::find_mock_target(string name)
+    /*
+     * Adds the function whose entry the walker is at, by its plain
+     * name and, when @a qualified, by its full name too.
+     */
+    void testmanager_t::index_function(np::spiegel::dwarf::walker_t &w, bool qualified)
     {
-        vector<np::spiegel::compile_unit_t *> units = np::spiegel::get_compile_units();
-        vector<np::spiegel::compile_unit_t *>::iterator i;
+        const np::spiegel::dwarf::entry_t *e = w.get_entry();
+
+        // An out of line C++ member function definition has
+        // only a reference to its declaration in the class
+        const char *name = e->get_string_attribute(DW_AT_name);
+        if(!name && e->get_attribute(DW_AT_specification))
+        {
+            np::spiegel::dwarf::walker_t decl(e->get_reference_attribute(DW_AT_specification));
+            const np::spiegel::dwarf::entry_t *d = decl.move_next();
+            name = (d ? d->get_string_attribute(DW_AT_name) : 0);
+            qualified = true;
+        }
+        if(!name)
+        {
+            return;
+        }
+
+        named_function_t nf;
+        nf.ref_ = w.get_reference();
+        nf.defined_ = (e->get_address_attribute(DW_AT_low_pc) != 0);
+        functions_by_name_[name].push_back(nf);
+        if(qualified)
+        {
+            string full = spiegel_->get_full_name(nf.ref_);
+            if(full != name)
+            {
+                functions_by_name_[full].push_back(nf);
+            }
+        }
+    }
+
+    /*
+     * Adds the named functions which are children of the walker's
+     * current entry, and those in any namespaces nested inside it.
+     */
+    void testmanager_t::index_scope(np::spiegel::dwarf::walker_t &w, bool nested)
+    {
+        for(const np::spiegel::dwarf::entry_t *e = w.move_down() ; e ; e = w.move_next())
+        {
+            if(e->get_tag() == DW_TAG_namespace_type)
+            {
+                np::spiegel::dwarf::walker_t w2(w);
+                index_scope(w2, true);
+                continue;
+            }
+            if(e->get_tag() == DW_TAG_subprogram)
+            {
+                index_function(w, nested);
+            }
+        }
+    }
+
+    /*
+     * Adds the functions named in the compile unit's .debug_pubnames
+     * set, which lists the same functions index_scope() would find,
+     * declarations included, by the offsets of their DIEs.  Only
+     * those DIEs need to be read.
+     */
+    void testmanager_t::index_pubnames(np::spiegel::dwarf::compile_unit_t *cu)
+    {
+        const vector<np::spiegel::dwarf::compile_unit_t::pubname_t> &pns = cu->get_pubnames();
+        vector<np::spiegel::dwarf::compile_unit_t::pubname_t>::const_iterator i;
+        for(i = pns.begin() ; i != pns.end() ; ++i)
+        {
+            np::spiegel::dwarf::walker_t w(cu->make_reference(i->offset_));
+            const np::spiegel::dwarf::entry_t *e = w.move_next();
+            if(e && e->get_tag() == DW_TAG_subprogram)
+            {
+                index_function(w, (strstr(i->name_, "::") != 0));
+            }
+        }
+    }
+
+    /*
+     * Mock targets are looked up by name for every mock function
+     * and every np_mock_by_name() call, so index all the functions
+     * once rather than scanning every compile unit each time.  The
+     * compiler's index of names is used where there is one, and
+     * only the other units have all their DIEs walked.
+     */
+    void testmanager_t::index_functions()
+    {
+        np::spiegel::dwarf::state_t *state = np::spiegel::dwarf::state_t::instance();
+        const vector<np::spiegel::dwarf::compile_unit_t *> &units = state->get_compile_units();
+        vector<np::spiegel::dwarf::compile_unit_t *>::const_iterator i;
         for(i = units.begin() ; i != units.end() ; ++i)
         {
-            vector<np::spiegel::function_t *> fns = (*i)->get_functions();
-            vector<np::spiegel::function_t *>::iterator j;
-            for(j = fns.begin() ; j != fns.end() ; ++j)
+            if((*i)->has_pubnames())
             {
-                if((*j)->get_name() == name)
-                {
-                    return *j;
-                }
+                index_pubnames(*i);
+                continue;
+            }
+            np::spiegel::dwarf::walker_t w(*i);
+            // move to DW_TAG_compile_unit
+            if(w.move_next())
+            {
+                index_scope(w, false);
+            }
+        }
+        has_function_index_ = true;
+        #if _NP_DEBUG
+        fprintf(stderr, "np: [%s] indexed %u function names\n",
+                np::util::rel_timestamp(), (unsigned)functions_by_name_.size());
+        #endif
+    }
+
+    np::spiegel::function_t *testmanager_t::find_mock_target(string name, uint32_t cu)
+    {
+        if(!has_function_index_)
+        {
+            index_functions();
+        }
+        np::util::unordered_map<string, vector<named_function_t> >::const_iterator i =
+                                        functions_by_name_.find(name);
+        if(i == functions_by_name_.end())
+        {
+            return 0;
+        }
+
+        // Prefer a definition in the given compile unit, then the
+        // first definition, then the first declaration.
+        const named_function_t *best = 0;
+        int best_rank = -1;
+        vector<named_function_t>::const_iterator j;
+        for(j = i->second.begin() ; j != i->second.end() ; ++j)
+        {
+            int rank = (j->defined_ ? (j->ref_.cu == cu ? 2 : 1) : 0);
+            if(rank > best_rank)
+            {
+                best = &*j;
+                best_rank = rank;
             }
         }
-        return 0;
+        return np::spiegel::_cacher_t::make_function(best->ref_);
     }
 
     static const struct __np_param_dec *get_param_dec(np::spiegel::function_t *fn)
@@ -185,50 +350,252 @@ namespace np
         return (const struct __np_param_dec *)ret.val.vpointer;
     }
 
-    void testmanager_t::discover_functions()
+    static const struct __np_valgrind_dec *get_valgrind_dec(np::spiegel::function_t *fn)
     {
-        if(!spiegel_)
+        vector<np::spiegel::value_t> args;
+        np::spiegel::value_t ret = fn->invoke(args);
+        return (const struct __np_valgrind_dec *)ret.val.vpointer;
+    }
+
+    /*
+     * Everything the results of scan_functions() depend on, apart
+     * from the DWARF info itself which the build-ids stand in for.
+     * An empty key means we can't safely cache anything.
+     */
+    string testmanager_t::cache_key() const
+    {
+        string ids = spiegel_->get_build_ids();
+        if(!ids.length())
         {
-            #if _NP_DEBUG
-            fprintf(stderr, "np: creating np::spiegel::dwarf::state_t instance\n");
-            #endif
-            spiegel_ = new np::spiegel::dwarf::state_t();
-            spiegel_->add_self();
-            root_ = new testnode_t(0);
+            return string();
         }
-        // else: splice common_ and root_ back together
 
-        #if _NP_DEBUG
-        fprintf(stderr, "np: scanning for test functions\n");
-        #endif
-        vector<np::spiegel::compile_unit_t *> units = np::spiegel::get_compile_units();
-        vector<np::spiegel::compile_unit_t *>::iterator i;
-        unsigned int ntests = 0;
-        for(i = units.begin() ; i != units.end() ; ++i)
+        string key = "novaprova discovery " _NP_OS " " _NP_ARCH "\n";
+        key += ids;
+        key += classifiers_->as_string();
+        return key;
+    }
+
+    /*
+     * Classifies the functions in each compile unit into its own
+     * slot.  Only the matching functions are kept, as candidates
+     * for the more expensive checks in scan_functions().
+     */
+    class testmanager_t::scanner_t : public np::util::parallel_t
+    {
+      public:
+        struct candidate_t
+        {
+            functype_t type_;
+            np::spiegel::dwarf::reference_t ref_;
+            string submatch_;
+        };
+
+        scanner_t(const testmanager_t *tm,
+                  const vector<np::spiegel::compile_unit_t *> &units)
+            :  tm_(tm), units_(units), candidates_(units.size())
+        {}
+
+        void work(unsigned int i)
         {
             #if _NP_DEBUG
-            fprintf(stderr, "np: scanning compile unit %s\n", (*i)->get_absolute_path().c_str());
+            fprintf(stderr, "np: scanning compile unit %s\n", units_[i]->get_absolute_path().c_str());
             #endif
-            vector<np::spiegel::function_t *> fns = (*i)->get_functions();
-            vector<np::spiegel::function_t *>::iterator j;
+            vector<np::spiegel::compile_unit_t::function_ref_t> fns = units_[i]->get_function_refs();
+            vector<np::spiegel::compile_unit_t::function_ref_t>::iterator j;
             for(j = fns.begin() ; j != fns.end() ; ++j)
             {
-                np::spiegel::function_t *fn = *j;
-                functype_t type;
                 char submatch[512];
 
                 // We want functions which are defined in this compile unit
-                if(!fn->get_address())
+                if(!j->address_)
                 {
                     continue;
                 }
 
-                type = classify_function(fn->get_name().c_str(),
-                                         submatch, sizeof(submatch));
+                functype_t type = tm_->classify_function(j->name_, submatch, sizeof(submatch));
                 #if _NP_DEBUG
                 fprintf(stderr, "np: function %s classified %s submatch \"%s\"\n",
-                        fn->get_name().c_str(), np::as_string(type), submatch);
+                        j->name_, np::as_string(type), submatch);
                 #endif
+                if(type == FT_UNKNOWN)
+                {
+                    continue;
+                }
+                candidate_t c;
+                c.type_ = type;
+                c.ref_ = j->ref_;
+                c.submatch_ = submatch;
+                candidates_[i].push_back(c);
+            }
+        }
+
+        /*
+         * Instead of classifying every function in the DWARF info,
+         * classify only the names in the ELF symbol tables and look
+         * up the DWARF for the few which match.  Returns false when
+         * that can't be done reliably, and the caller should run()
+         * the full scan instead.
+         */
+        bool scan_symbols(np::spiegel::dwarf::state_t *state)
+        {
+            vector<np::spiegel::dwarf::state_t::function_symbol_t> syms;
+            if(!state->get_function_symbols(syms))
+            {
+                return false;
+            }
+
+            map<uint32_t, unsigned int> slots;
+            for(unsigned int i = 0 ; i < units_.size() ; i++)
+            {
+                slots[units_[i]->get_reference().cu] = i;
+            }
+
+            vector<np::spiegel::dwarf::state_t::function_symbol_t>::const_iterator j;
+            for(j = syms.begin() ; j != syms.end() ; ++j)
+            {
+                char submatch[512];
+                string name = unmangle(j->name_);
+                if(!name.length() ||
+                        tm_->classify_function(name.c_str(), submatch, sizeof(submatch)) == FT_UNKNOWN)
+                {
+                    continue;
+                }
+
+                np::spiegel::compile_unit_t::function_ref_t fr;
+                if(!np::spiegel::compile_unit_t::get_function_ref_at(j->addr_, fr))
+                {
+                    continue;   /* no DWARF info for it */
+                }
+                // The address index covers all the link objects at
+                // once, so it can't tell apart overlapping addresses
+                if(state->get_compile_unit(fr.ref_)->get_link_object_index() != j->linkobj_)
+                {
+                    #if _NP_DEBUG
+                    fprintf(stderr, "np: symbol %s found in the wrong link object\n",
+                            j->name_.c_str());
+                    #endif
+                    candidates_.assign(units_.size(), vector<candidate_t>());
+                    return false;
+                }
+                if(!fr.address_)
+                {
+                    continue;
+                }
+
+                // Classify what the DWARF calls it, like the full scan
+                functype_t type = tm_->classify_function(fr.name_, submatch, sizeof(submatch));
+                #if _NP_DEBUG
+                fprintf(stderr, "np: symbol %s classified %s submatch \"%s\"\n",
+                        j->name_.c_str(), np::as_string(type), submatch);
+                #endif
+                map<uint32_t, unsigned int>::const_iterator slot = slots.find(fr.ref_.cu);
+                if(type == FT_UNKNOWN || slot == slots.end())
+                {
+                    continue;
+                }
+                candidate_t c;
+                c.type_ = type;
+                c.ref_ = fr.ref_;
+                c.submatch_ = submatch;
+                candidates_[slot->second].push_back(c);
+            }
+
+            /* The symbol table has its own order, so restore the
+             * DWARF order which the full scan would have produced,
+             * dropping aliases of the same function. */
+            for(unsigned int i = 0 ; i < candidates_.size() ; i++)
+            {
+                vector<candidate_t> &cands = candidates_[i];
+                sort(cands.begin(), cands.end(), candidate_before);
+                cands.erase(unique(cands.begin(), cands.end(), candidate_same), cands.end());
+            }
+            return true;
+        }
+
+        const vector<candidate_t> &get_candidates(unsigned int i) const
+        {
+            return candidates_[i];
+        }
+
+      private:
+        /*
+         * Returns the name to classify for a symbol, or "" for a C++
+         * function which isn't at the top level of its compile unit
+         * and so would never be found by the full scan.  We only need
+         * to handle the simplest mangled form, e.g. _Z8test_foov.
+         */
+        static string unmangle(const string &sym)
+        {
+            if(sym.compare(0, 2, "_Z"))
+            {
+                return sym;
+            }
+            size_t p = 2;
+            if(sym[p] == 'L')
+            {
+                p++;    /* internal linkage */
+            }
+            if(!isdigit(sym[p]))
+            {
+                return string();
+            }
+            unsigned long len = strtoul(sym.c_str()+p, 0, 10);
+            while(isdigit(sym[p]))
+            {
+                p++;
+            }
+            if(!len || p + len > sym.length())
+            {
+                return string();
+            }
+            return sym.substr(p, len);
+        }
+
+        static bool candidate_before(const candidate_t &a, const candidate_t &b)
+        {
+            return a.ref_.offset < b.ref_.offset;
+        }
+
+        static bool candidate_same(const candidate_t &a, const candidate_t &b)
+        {
+            return a.ref_ == b.ref_;
+        }
+
+        const testmanager_t *tm_;
+        const vector<np::spiegel::compile_unit_t *> &units_;
+        vector<vector<candidate_t> > candidates_;
+    };
+
+    /*
+     * Walk the DWARF info to find and check all the interesting
+     * functions, remembering them in the cache in the order found.
+     */
+    void testmanager_t::scan_functions(cache_t &cache)
+    {
+        #if _NP_DEBUG
+        fprintf(stderr, "np: scanning for test functions\n");
+        #endif
+        vector<np::spiegel::compile_unit_t *> units = np::spiegel::get_compile_units();
+        scanner_t scanner(this, units);
+        const char *mode = getenv("NOVAPROVA_DISCOVERY");
+        if(!mode || strcmp(mode, "symtab") || !scanner.scan_symbols(spiegel_))
+        {
+            scanner.run(units.size());
+        }
+
+        /* The rest touches shared state, so is done serially and
+         * in compile unit order to keep the test order stable. */
+        for(unsigned int i = 0 ; i < units.size() ; i++)
+        {
+            const vector<scanner_t::candidate_t> &cands = scanner.get_candidates(i);
+            vector<scanner_t::candidate_t>::const_iterator j;
+            for(j = cands.begin() ; j != cands.end() ; ++j)
+            {
+                np::spiegel::function_t *fn = np::spiegel::_cacher_t::make_function(j->ref_);
+                functype_t type = j->type_;
+                const char *submatch = j->submatch_.c_str();
+
                 switch(type)
                 {
                     case FT_UNKNOWN:
@@ -249,13 +616,13 @@ namespace np
                         {
                             continue;
                         }
-                        root_->make_path(test_name(fn, submatch))->set_function(type, fn);
-                        ntests++;
+                        cache.add(type, fn->get_reference(), submatch);
                         break;
                     case FT_BEFORE:
                     case FT_AFTER:
-                        // Before/after functions go into the parent node
-                        assert(!submatch[0]);
+                        // Before/after functions go into the file's node,
+                        // whatever a user's classifier captured
+                        submatch = "";
                         // Before/after functions return int
                         if(fn->get_return_type()->get_classification() != np::spiegel::type_t::TC_SIGNED_INT)
                         {
@@ -266,7 +633,7 @@ namespace np
                         {
                             continue;
                         }
-                        root_->make_path(test_name(fn, submatch))->set_function(type, fn);
+                        cache.add(type, fn->get_reference(), submatch);
                         break;
                     case FT_MOCK:
                         // Mock functions need a target name
@@ -275,12 +642,13 @@ namespace np
                             continue;
                         }
                         {
-                            np::spiegel::function_t *target = find_mock_target(submatch);
+                            np::spiegel::function_t *target = find_mock_target(submatch, j->ref_.cu);
                             if(!target)
                             {
                                 continue;
                             }
-                            root_->make_path(test_name(fn, 0))->add_mock(target, fn);
+                            cache.add(type, fn->get_reference(), submatch,
+                                      target->get_reference());
                         }
                         break;
                     case FT_PARAM:
@@ -289,14 +657,255 @@ namespace np
                         {
                             continue;
                         }
-                        const struct __np_param_dec *dec = get_param_dec(fn);
-                        root_->make_path(test_name(fn, 0))->add_parameter(
-                                        submatch, dec->var, dec->values);
+                        cache.add(type, fn->get_reference(), submatch);
+                        break;
+                    case FT_VALGRIND:
+                        cache.add(type, fn->get_reference(), submatch);
                         break;
                 }
             }
         }
+    }
+
+    /*
+     * Finds the functions in the DWARF info, or in the cache, except
+     * in the given files whose functions were registered.
+     */
+    unsigned int testmanager_t::add_discovered_functions(const set<string> &registered_files)
+    {
+        cache_t cache(cache_key());
+        if(!cache.load())
+        {
+            scan_functions(cache);
+            cache.save();
+        }
+
+        unsigned int ntests = 0;
+        vector<cache_t::entry_t>::const_iterator i;
+        for(i = cache.get_entries().begin() ; i != cache.get_entries().end() ; ++i)
+        {
+            np::spiegel::function_t *fn = np::spiegel::_cacher_t::make_function(i->function_);
+            if(!fn)
+            {
+                continue;
+            }
+            string path = fn->get_compile_unit()->get_absolute_path();
+            if(registered_files.find(path) != registered_files.end())
+            {
+                continue;
+            }
+            const char *submatch = i->submatch_.c_str();
+            switch(i->type_)
+            {
+                case FT_TEST:
+                    ntests++;
+                    /* fall through */
+                case FT_BEFORE:
+                case FT_AFTER:
+                    root_->make_path(test_name(path, submatch))->set_function(i->type_,
+                                    new testfunc_t(i->type_, fn->get_address(),
+                                                   fn->get_name().c_str(), path.c_str()));
+                    break;
+                case FT_MOCK:
+                    {
+                        np::spiegel::function_t *target = np::spiegel::_cacher_t::make_function(i->target_);
+                        if(!target)
+                        {
+                            continue;
+                        }
+                        root_->make_path(test_name(path, 0))->add_mock(target, fn);
+                    }
+                    break;
+                case FT_PARAM:
+                    {
+                        const struct __np_param_dec *dec = get_param_dec(fn);
+                        root_->make_path(test_name(path, 0))->add_parameter(
+                                        submatch, dec->var, dec->values);
+                    }
+                    break;
+                case FT_VALGRIND:
+                    {
+                        const struct __np_valgrind_dec *vdec = get_valgrind_dec(fn);
+                        root_->make_path(test_name(path, 0))->set_valgrind(
+                                        vdec->tool, vdec->leak_check);
+                    }
+                    break;
+                default:
+                    break;
+            }
+        }
+        return ntests;
+    }
+
+    /*
+     * The descriptors emitted by NP_TEST and friends, bounded by
+     * symbols which the linker defines only when the section exists.
+     */
+    extern "C" const struct __np_registration __start_np_registry[] __attribute__((weak));
+    extern "C" const struct __np_registration __stop_np_registry[] __attribute__((weak));
+
+    static bool is_registered(int kind)
+    {
+        const struct __np_registration *r;
+        for(r = __start_np_registry ; r < __stop_np_registry ; r++)
+        {
+            if(r->kind == kind)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /*
+     * Sort descriptors into source order, as the DWARF would list
+     * them, keeping the files in link order.
+     */
+    struct registration_before
+    {
+        map<string, unsigned int> &files_;
+
+        registration_before(map<string, unsigned int> &files)
+            :  files_(files)
+        {}
+        bool operator()(const struct __np_registration *a,
+                        const struct __np_registration *b) const
+        {
+            unsigned int fa = files_[a->file];
+            unsigned int fb = files_[b->file];
+            if(fa != fb)
+            {
+                return fa < fb;
+            }
+            return a->line < b->line;
+        }
+    };
+
+    /*
+     * Uses the descriptors, without reading any DWARF info.  Each
+     * file is named by its __FILE__, which is relative to wherever
+     * the compiler ran, taken to be the current directory, made
+     * absolute and normalised just like a compile unit's name.
+     * Returns those paths in @a registered_files, for
+     * add_discovered_functions() to skip.
+     */
+    unsigned int testmanager_t::add_registered_functions(set<string> &registered_files)
+    {
+        /* NP_PARAMETER and NP_VALGRIND register too, but a file
+         * using only those has its tests discovered in the DWARF */
+        map<string, string> paths;
+        const struct __np_registration *r;
+        for(r = __start_np_registry ; r < __stop_np_registry ; r++)
+        {
+            if(r->kind != __NP_REG_PARAMETER && r->kind != __NP_REG_VALGRIND &&
+               r->kind != __NP_REG_DISCOVER && paths.find(r->file) == paths.end())
+            {
+                paths[r->file] = np::util::filename_t(r->file).make_absolute();
+                registered_files.insert(paths[r->file]);
+            }
+        }
+
+        vector<const struct __np_registration *> regs;
+        map<string, unsigned int> files;
+        for(r = __start_np_registry ; r < __stop_np_registry ; r++)
+        {
+            if(paths.find(r->file) == paths.end())
+            {
+                continue;
+            }
+            files.insert(make_pair(string(r->file), (unsigned int)files.size()));
+            regs.push_back(r);
+        }
+        stable_sort(regs.begin(), regs.end(), registration_before(files));
+
+        unsigned int ntests = 0;
+        vector<const struct __np_registration *>::const_iterator i;
+        for(i = regs.begin() ; i != regs.end() ; ++i)
+        {
+            r = *i;
+            #if _NP_DEBUG
+            fprintf(stderr, "np: registered %s:%d kind %d name \"%s\" function %s\n",
+                    r->file, r->line, r->kind, r->name, r->function_name);
+            #endif
+            np::spiegel::addr_t addr = (np::spiegel::addr_t)r->function;
+            const string &path = paths[r->file];
+            functype_t type;
+            switch(r->kind)
+            {
+                case __NP_REG_TEST:
+                    ntests++;
+                    type = FT_TEST;
+                    break;
+                case __NP_REG_SETUP:
+                    type = FT_BEFORE;
+                    break;
+                case __NP_REG_TEARDOWN:
+                    type = FT_AFTER;
+                    break;
+                case __NP_REG_MOCK:
+                    root_->make_path(test_name(path, 0))->add_mock(
+                                    (np::spiegel::addr_t)r->target, r->name, addr);
+                    continue;
+                case __NP_REG_PARAMETER:
+                    {
+                        const struct __np_param_dec *dec =
+                            ((const struct __np_param_dec *(*)(void))r->function)();
+                        root_->make_path(test_name(path, 0))->add_parameter(
+                                        r->name, dec->var, dec->values);
+                    }
+                    continue;
+                case __NP_REG_VALGRIND:
+                    {
+                        const struct __np_valgrind_dec *vdec =
+                            ((const struct __np_valgrind_dec *(*)(void))r->function)();
+                        root_->make_path(test_name(path, 0))->set_valgrind(
+                                        vdec->tool, vdec->leak_check);
+                    }
+                    continue;
+                default:
+                    continue;
+            }
+            root_->make_path(test_name(path, r->name))->set_function(type,
+                            new testfunc_t(type, addr, r->function_name, path.c_str()));
+        }
+        return ntests;
+    }
+
+    void testmanager_t::discover_functions()
+    {
+        bool registered = is_registered(__NP_REG_TEST);
+        bool discover = (!registered || is_registered(__NP_REG_DISCOVER));
+        if(!spiegel_)
+        {
+            #if _NP_DEBUG
+            fprintf(stderr, "np: creating np::spiegel::dwarf::state_t instance\n");
+            #endif
+            spiegel_ = new np::spiegel::dwarf::state_t();
+            if(discover)
+            {
+                spiegel_->add_self();
+            }
+            else
+            {
+                /* only for stack traces and mocks by name */
+                spiegel_->add_self_deferred();
+            }
+            root_ = new testnode_t(0);
+        }
+        // else: splice common_ and root_ back together
 
+        /* Registered functions first, then with NP_DISCOVER_TESTS
+         * those discovered in the DWARF info of the other files */
+        set<string> registered_files;
+        unsigned int ntests = 0;
+        if(registered)
+        {
+            ntests += add_registered_functions(registered_files);
+        }
+        if(discover)
+        {
+            ntests += add_discovered_functions(registered_files);
+        }
         if(!ntests)
         {
             fprintf(stderr, "np: WARNING: no tests discovered\n");
@@ -306,6 +915,142 @@ namespace np
         root_ = root_->detach_common();
     }
 
+    /*
+     * Lists the nodes in preorder with their full names, so that
+     * specs can be looked up without walking the tree or building
+     * the full name of every node for every spec.  The list is made
+     * again if nodes have been added since.
+     */
+    void testmanager_t::index_nodes()
+    {
+        if(has_node_index_ && node_index_generation_ == testnode_t::get_generation())
+        {
+            return;
+        }
+        nodes_.clear();
+        nodes_by_name_.clear();
+
+        vector<unsigned int> open;  // ancestors of the current node
+        testnode_t::preorder_iterator i;
+        for(i = root_->preorder_begin() ; i != root_->preorder_end() ; ++i)
+        {
+            testnode_t *tn = *i;
+            while(open.size() && nodes_[open.back()].node_ != tn->get_parent())
+            {
+                nodes_[open.back()].end_ = nodes_.size();
+                open.pop_back();
+            }
+
+            named_node_t nn;
+            nn.node_ = tn;
+            if(open.size())
+            {
+                nn.fullname_ = nodes_[open.back()].fullname_;
+            }
+            if(tn->get_name())
+            {
+                if(nn.fullname_.length())
+                {
+                    nn.fullname_ += ".";
+                }
+                nn.fullname_ += tn->get_name();
+                // the first node in preorder wins, as in testnode_t::find()
+                nodes_by_name_.insert(make_pair(nn.fullname_, (unsigned int)nodes_.size()));
+            }
+            open.push_back(nodes_.size());
+            nodes_.push_back(nn);
+        }
+        while(open.size())
+        {
+            nodes_[open.back()].end_ = nodes_.size();
+            open.pop_back();
+        }
+        node_index_generation_ = testnode_t::get_generation();
+        has_node_index_ = true;
+    }
+
+    testnode_t *testmanager_t::find_node(const char *nm)
+    {
+        if(!root_)
+        {
+            return 0;
+        }
+        index_nodes();
+        np::util::unordered_map<string, unsigned int>::const_iterator i =
+                                        nodes_by_name_.find(nm);
+        return (i == nodes_by_name_.end() ? 0 : nodes_[i->second].node_);
+    }
+
+    bool testmanager_t::find_nodes(const char *pattern, vector<testnode_t *> &nodes)
+    {
+        if(!root_)
+        {
+            return false;
+        }
+        index_nodes();
+
+        regex_t re;
+        size_t len = strlen(pattern);
+        bool is_regex = (len > 2 && pattern[0] == '/' && pattern[len-1] == '/');
+        if(is_regex)
+        {
+            string s(pattern+1, len-2);
+            int r = regcomp(&re, s.c_str(), REG_EXTENDED|REG_NOSUB);
+            if(r)
+            {
+                char buf[1024];
+                regerror(r, &re, buf, sizeof(buf));
+                fprintf(stderr, "np: bad test specification %s: %s\n", pattern, buf);
+                return false;
+            }
+        }
+
+        // a match covers its whole subtree, so skip over it
+        unsigned int nfound = 0;
+        for(unsigned int i = 0 ; i < nodes_.size() ; )
+        {
+            const named_node_t &nn = nodes_[i];
+            bool matched;
+            if(!nn.node_->get_name())
+            {
+                matched = false;
+            }
+            else if(is_regex)
+            {
+                matched = !regexec(&re, nn.fullname_.c_str(), 0, 0, 0);
+            }
+            else
+            {
+                matched = !fnmatch(pattern, nn.fullname_.c_str(), 0);
+            }
+            if(matched)
+            {
+                nodes.push_back(nn.node_);
+                nfound++;
+                i = nn.end_;
+            }
+            else
+            {
+                i++;
+            }
+        }
+
+        if(is_regex)
+        {
+            regfree(&re);
+        }
+        return nfound > 0;
+    }
+
+    /*
+     * Do the DWARF work which test children would otherwise each
+     * repeat, so that they share the result copy-on-write.
+     */
+    void testmanager_t::prepare_for_fork()
+    {
+        spiegel_->prewarm_address_index();
+    }
+
     extern void init_syslog_intercepts(testnode_t *);
     extern void init_exit_intercepts(testnode_t *);
 
@@ -320,15 +1065,86 @@ namespace np
 
 /*-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-*/
 
+/*
+ * The compile unit of the code which called us, so that a name
+ * finds the static function in the test's own file first.
+ */
+static uint32_t caller_cu(void *addr)
+{
+    np::spiegel::dwarf::reference_t curef;
+    np::spiegel::dwarf::reference_t funcref;
+    unsigned int lineno;
+    unsigned int offset;
+    np::spiegel::dwarf::state_t *state = np::spiegel::dwarf::state_t::instance();
+    if(!state->describe_address((np::spiegel::addr_t)addr, curef, lineno, funcref, offset))
+    {
+        return ~0U;
+    }
+    return funcref.cu;
+}
+
 extern "C" void __np_mock_by_name(const char *fname, void (*to)(void))
 {
-    np::spiegel::function_t *f = np::testmanager_t::instance()->find_mock_target(fname);
+    np::spiegel::function_t *f = np::testmanager_t::instance()->find_mock_target(fname,
+                                        caller_cu(__builtin_return_address(0)));
     __np_mock((void(*)(void))f->get_address(), f->get_full_name().c_str(), to);
 }
 
 extern "C" void np_unmock_by_name(const char *fname)
 {
-    np::spiegel::function_t *f = np::testmanager_t::instance()->find_mock_target(fname);
+    np::spiegel::function_t *f = np::testmanager_t::instance()->find_mock_target(fname,
+                                        caller_cu(__builtin_return_address(0)));
     __np_unmock((void(*)(void))f->get_address());
 }
 
+/**
+ * Add a classifier for discovering functions by name.
+ *
+ * @param re		POSIX extended regular expression to match
+ *			function names against
+ * @param case_sensitive    whether the match is case sensitive
+ * @param kind		the kind of function a match is, one of
+ *			@c NP_CLASSIFY_TEST, @c NP_CLASSIFY_SETUP,
+ *			@c NP_CLASSIFY_TEARDOWN or @c NP_CLASSIFY_MOCK
+ * @return		false if the classifier could not be added
+ *
+ * Lets a project use its own naming conventions for test, fixture
+ * and mock functions alongside the built-in ones such as
+ * @c test_foo and @c mock_foo.  The first parenthesised group in
+ * @a re, if any, gives the test's name or the name of the function
+ * being mocked; for setup and teardown functions it is ignored.
+ * Classifiers added this way are tried before the built-in ones,
+ * in the order they were added.  For example
+ * @code
+ * np_add_classifier("^should_(.*)", true, NP_CLASSIFY_TEST);
+ * @endcode
+ * Expressions which are anchored with ^ and otherwise use only
+ * literals, bracket expressions, one group and a final .* are
+ * matched without the regex engine, so cost almost nothing.
+ * Classifiers must be added before discovery, i.e. before
+ * calling @c np_init() or any @c np_plan_ function.
+ *
+ * \ingroup main
+ */
+extern "C" bool np_add_classifier(const char *re, bool case_sensitive, int kind)
+{
+    np::functype_t type;
+    switch(kind)
+    {
+        case NP_CLASSIFY_TEST:
+            type = np::FT_TEST;
+            break;
+        case NP_CLASSIFY_SETUP:
+            type = np::FT_BEFORE;
+            break;
+        case NP_CLASSIFY_TEARDOWN:
+            type = np::FT_AFTER;
+            break;
+        case NP_CLASSIFY_MOCK:
+            type = np::FT_MOCK;
+            break;
+        default:
+            return false;
+    }
+    return np::testmanager_t::add_user_classifier(re, case_sensitive, type);
+}
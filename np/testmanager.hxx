@@ -19,8 +19,10 @@
 #include "np/util/common.hxx"
 #include "np/types.hxx"
 #include "np/testnode.hxx"
+#include "np/spiegel/dwarf/reference.hxx"
 #include <string>
 #include <vector>
+#include <set>
 
 namespace np
 {
@@ -29,6 +31,8 @@ namespace np
         namespace dwarf
         {
             class state_t;
+            class walker_t;
+            class compile_unit_t;
         }
     }
 }
@@ -37,6 +41,8 @@ namespace np
 {
 
     class classifier_t;
+    class classifier_set_t;
+    class cache_t;
 
     class testmanager_t : public np::util::zalloc
     {
@@ -44,10 +50,11 @@ namespace np
         /* testmanager is a singleton */
         static testmanager_t *instance();
 
-        testnode_t *find_node(const char *nm) const
-        {
-            return root_ ? root_->find(nm) : 0;
-        }
+        testnode_t *find_node(const char *nm);
+        /* the nodes whose full names match a glob, or a regular
+         * expression written between slashes, in preorder and
+         * leaving out any node below another which matched */
+        bool find_nodes(const char *pattern, std::vector<testnode_t *> &nodes);
         testnode_t *get_root()
         {
             return root_;
@@ -58,25 +65,63 @@ namespace np
             delete instance_;
         }
 
-        spiegel::function_t *find_mock_target(std::string name);
+        /* prefers a function defined in compile unit cu, so
+         * that a static function can be mocked from its own file */
+        spiegel::function_t *find_mock_target(std::string name, uint32_t cu = ~0U);
+        void prepare_for_fork();
+
+        /* adds to the classifiers which the next instance() uses */
+        static bool add_user_classifier(const char *re, bool case_sensitive, functype_t type);
 
       private:
         testmanager_t();
         ~testmanager_t();
 
+        class scanner_t;
+
         void print_banner();
-        functype_t classify_function(const char *func, char *match_return, size_t maxmatch);
+        functype_t classify_function(const char *func, char *match_return, size_t maxmatch) const;
         void add_classifier(const char *re, bool case_sensitive, functype_t type);
         void setup_classifiers();
+        std::string cache_key() const;
+        void scan_functions(cache_t &);
+        unsigned int add_discovered_functions(const std::set<std::string> &registered_files);
+        unsigned int add_registered_functions(std::set<std::string> &registered_files);
         void discover_functions();
         void setup_builtin_intercepts();
+        void index_nodes();
+        void index_functions();
+        void index_scope(spiegel::dwarf::walker_t &w, bool nested);
+        void index_pubnames(spiegel::dwarf::compile_unit_t *cu);
+        void index_function(spiegel::dwarf::walker_t &w, bool qualified);
 
         static testmanager_t *instance_;
 
-        std::vector<classifier_t *> classifiers_;
+        static std::vector<classifier_t *> user_classifiers_;
+        classifier_set_t *classifiers_;
         spiegel::dwarf::state_t *spiegel_;
         testnode_t *root_;
         testnode_t *common_;	// nodes from filesystem root down to root_
+
+        struct named_node_t
+        {
+            testnode_t *node_;
+            std::string fullname_;
+            unsigned int end_;	// index in nodes_ just past the subtree
+        };
+        std::vector<named_node_t> nodes_;	// in preorder
+        np::util::unordered_map<std::string, unsigned int> nodes_by_name_;
+        unsigned int node_index_generation_;	// testnode_t's when indexed
+        bool has_node_index_;
+
+        struct named_function_t
+        {
+            spiegel::dwarf::reference_t ref_;
+            bool defined_;	// has code, not just a declaration
+        };
+        // by plain name and by full name, in compile unit order
+        np::util::unordered_map<std::string, std::vector<named_function_t> > functions_by_name_;
+        bool has_function_index_;
     };
 
     // close the namespaces
@@ -24,6 +24,33 @@ namespace np
     using namespace std;
     using namespace np::util;
 
+    testfunc_t::testfunc_t(functype_t type, np::spiegel::addr_t addr,
+                           const char *name, const char *filename)
+        :  type_(type),
+           addr_(addr),
+           name_(xstrdup(name)),
+           filename_(xstrdup(filename))
+    {
+    }
+
+    testfunc_t::~testfunc_t()
+    {
+        xfree(name_);
+        xfree(filename_);
+    }
+
+    int testfunc_t::invoke() const
+    {
+        if(type_ == FT_TEST)
+        {
+            ((void (*)(void))addr_)();
+            return 0;
+        }
+        return ((int (*)(void))addr_)();
+    }
+
+    unsigned int testnode_t::generation_ = 0;
+
     testnode_t::testnode_t(const char *name)
         :  name_(name ? xstrdup(name) : 0)
     {
@@ -37,16 +64,21 @@ namespace np
             children_ = child->next_;
             delete child;
         }
+        delete children_by_name_;
 
+        for(int type = 0 ; type < FT_NUM_SINGULAR ; type++)
+        {
+            delete funcs_[type];
+        }
         xfree(name_);
+        xfree(valgrind_tool_);
     }
 
     testnode_t *testnode_t::make_path(string name)
     {
         testnode_t *parent = this;
         const char *part;
-        testnode_t *child;
-        testnode_t **tailp;
+        testnode_t *child = 0;
         tok_t tok(name.c_str(), "/");
 
         #if _NP_DEBUG
@@ -54,20 +86,27 @@ namespace np
         #endif
         while((part = tok.next()))
         {
-            for(child = parent->children_, tailp = &parent->children_ ;
-                    child ;
-                    tailp = &child->next_, child = child->next_)
+            if(!parent->children_by_name_)
             {
-                if(!strcmp(child->name_, part))
-                {
-                    break;
-                }
+                parent->children_by_name_ = new np::util::unordered_map<string, testnode_t *>;
             }
+            testnode_t *&slot = (*parent->children_by_name_)[part];
+            child = slot;
             if(!child)
             {
                 child = new testnode_t(part);
-                *tailp = child;
+                if(parent->last_child_)
+                {
+                    parent->last_child_->next_ = child;
+                }
+                else
+                {
+                    parent->children_ = child;
+                }
+                parent->last_child_ = child;
                 child->parent_ = parent;
+                slot = child;
+                generation_++;
             }
 
             parent = child;
@@ -75,16 +114,19 @@ namespace np
         return child;
     }
 
-    void testnode_t::set_function(functype_t ft, np::spiegel::function_t *func)
+    void testnode_t::set_function(functype_t ft, testfunc_t *func)
     {
         if(funcs_[ft])
+        {
             fprintf(stderr, "np: WARNING: duplicate %s functions: "
                     "%s:%s and %s:%s\n",
                     as_string(ft),
-                    funcs_[ft]->get_compile_unit()->get_absolute_path().c_str(),
-                    funcs_[ft]->get_name().c_str(),
-                    func->get_compile_unit()->get_absolute_path().c_str(),
-                    func->get_name().c_str());
+                    funcs_[ft]->get_filename(),
+                    funcs_[ft]->get_name(),
+                    func->get_filename(),
+                    func->get_name());
+            delete func;
+        }
         else
         {
             funcs_[ft] = func;
@@ -108,6 +150,38 @@ namespace np
         intercepts_.push_back(new redirect_t(target, 0, mock));
     }
 
+    void testnode_t::set_valgrind(const char *tool, bool leak_check)
+    {
+        xfree(valgrind_tool_);
+        valgrind_tool_ = xstrdup(tool ? tool : "memcheck");
+        leak_check_ = leak_check;
+    }
+
+    /* The Valgrind settings of the nearest node which has any */
+    const char *testnode_t::get_valgrind_tool() const
+    {
+        for(const testnode_t *a = this ; a ; a = a->parent_)
+        {
+            if(a->valgrind_tool_)
+            {
+                return a->valgrind_tool_;
+            }
+        }
+        return "memcheck";
+    }
+
+    bool testnode_t::get_leak_check() const
+    {
+        for(const testnode_t *a = this ; a ; a = a->parent_)
+        {
+            if(a->valgrind_tool_)
+            {
+                return a->leak_check_;
+            }
+        }
+        return true;
+    }
+
     static void indent(int level)
     {
         for(; level ; level--)
@@ -132,8 +206,8 @@ namespace np
                 indent(level);
                 fprintf(stderr, "  %s=%s:%s\n",
                         as_string((functype_t)type),
-                        funcs_[type]->get_compile_unit()->get_absolute_path().c_str(),
-                        funcs_[type]->get_name().c_str());
+                        funcs_[type]->get_filename(),
+                        funcs_[type]->get_name());
             }
         }
 
@@ -207,16 +281,20 @@ namespace np
         if(tn->parent_)
         {
             tn->parent_->children_ = 0;
+            tn->parent_->last_child_ = 0;
+            delete tn->parent_->children_by_name_;
+            tn->parent_->children_by_name_ = 0;
             assert(!tn->next_);
             tn->parent_ = 0;
+            generation_++;
         }
 
         return tn;
     }
 
-    list<np::spiegel::function_t *> testnode_t::get_fixtures(functype_t type) const
+    list<testfunc_t *> testnode_t::get_fixtures(functype_t type) const
     {
-        list<np::spiegel::function_t *> fixtures;
+        list<testfunc_t *> fixtures;
 
         /* Run FT_BEFORE from outermost in, and FT_AFTER
          * from innermost out */
@@ -391,6 +469,41 @@ namespace np
         return true;
     }
 
+    // Return the ordinal of the assignment vector's current state in
+    // the sequence generated by bump(), so that the state can be
+    // communicated to another process as a single number.
+    unsigned int get_index(const std::vector<testnode_t::assignment_t> &a)
+    {
+        unsigned int idx = 0;
+        vector<testnode_t::assignment_t>::const_reverse_iterator i;
+        for(i = a.rbegin() ; i != a.rend() ; ++i)
+        {
+            unsigned int nvalues = i->param_->values_.size();
+            if(nvalues)
+            {
+                idx = idx * nvalues + i->idx_;
+            }
+        }
+        return idx;
+    }
+
+    // Set the assignment vector to the state whose ordinal was
+    // returned by get_index().
+    void set_index(std::vector<testnode_t::assignment_t> &a, unsigned int idx)
+    {
+        vector<testnode_t::assignment_t>::iterator i;
+        for(i = a.begin() ; i != a.end() ; ++i)
+        {
+            unsigned int nvalues = i->param_->values_.size();
+            if(!nvalues)
+            {
+                continue;
+            }
+            i->idx_ = idx % nvalues;
+            idx /= nvalues;
+        }
+    }
+
     int operator==(const std::vector<testnode_t::assignment_t> &a,
                    const std::vector<testnode_t::assignment_t> &b)
     {
@@ -24,12 +24,46 @@
 namespace np
 {
 
+    /*
+     * A test or fixture function, with what's needed to call it
+     * and to describe it in events, so that running tests doesn't
+     * depend on the DWARF info it may have been found in.
+     */
+    class testfunc_t : public np::util::zalloc
+    {
+      public:
+        testfunc_t(functype_t type, np::spiegel::addr_t addr,
+                   const char *name, const char *filename);
+        ~testfunc_t();
+
+        const char *get_name() const
+        {
+            return name_;
+        }
+        const char *get_filename() const
+        {
+            return filename_;
+        }
+        /* returns the fixture's result, or 0 for a test */
+        int invoke() const;
+
+      private:
+        functype_t type_;
+        np::spiegel::addr_t addr_;
+        char *name_;
+        char *filename_;
+    };
+
     class testnode_t : public np::util::zalloc
     {
       public:
         testnode_t(const char *);
         ~testnode_t();
 
+        const char *get_name() const
+        {
+            return name_;
+        }
         std::string get_fullname() const;
         testnode_t *get_parent()
         {
@@ -37,17 +71,26 @@ namespace np
         }
         testnode_t *find(const char *name);
         testnode_t *make_path(std::string name);
-        void set_function(functype_t, np::spiegel::function_t *);
+        // changes whenever a node is added to or cut from any tree,
+        // so indexes of the nodes can tell when they are stale
+        static unsigned int get_generation()
+        {
+            return generation_;
+        }
+        void set_function(functype_t, testfunc_t *);
         void add_mock(np::spiegel::function_t *target, np::spiegel::function_t *mock);
         void add_mock(np::spiegel::addr_t target, const char *name, np::spiegel::addr_t mock);
         void add_mock(np::spiegel::addr_t target, np::spiegel::addr_t mock);
+        void set_valgrind(const char *tool, bool leak_check);
+        const char *get_valgrind_tool() const;
+        bool get_leak_check() const;
 
         testnode_t *detach_common();
-        np::spiegel::function_t *get_function(functype_t type) const
+        testfunc_t *get_function(functype_t type) const
         {
             return funcs_[type];
         }
-        std::list<np::spiegel::function_t *> get_fixtures(functype_t type) const;
+        std::list<testfunc_t *> get_fixtures(functype_t type) const;
         void pre_run() const;
         void post_run() const;
 
@@ -80,6 +123,8 @@ namespace np
             unsigned int idx_;
 
             friend bool bump(std::vector<testnode_t::assignment_t>& a);
+            friend unsigned int get_index(const std::vector<testnode_t::assignment_t>& a);
+            friend void set_index(std::vector<testnode_t::assignment_t>& a, unsigned int idx);
             friend int operator==(const std::vector<testnode_t::assignment_t>& a,
                                   const std::vector<testnode_t::assignment_t>& b);
         };
@@ -131,15 +176,24 @@ namespace np
         testnode_t *next_;
         testnode_t *parent_;
         testnode_t *children_;
+        testnode_t *last_child_;
+        // children_ by name, made when the first child is added
+        np::util::unordered_map<std::string, testnode_t *> *children_by_name_;
         char *name_;
-        np::spiegel::function_t *funcs_[FT_NUM_SINGULAR];
+        testfunc_t *funcs_[FT_NUM_SINGULAR];
         std::vector<np::spiegel::intercept_t *> intercepts_;
         std::vector<parameter_t *> parameters_;
+        char *valgrind_tool_;	/* 0 to inherit from the parent */
+        bool leak_check_;
+
+        static unsigned int generation_;
 
         friend class preorder_iterator;
     };
 
     bool bump(std::vector<testnode_t::assignment_t>& a);
+    unsigned int get_index(const std::vector<testnode_t::assignment_t>& a);
+    void set_index(std::vector<testnode_t::assignment_t>& a, unsigned int idx);
     int operator==(const std::vector<testnode_t::assignment_t>& a,
                    const std::vector<testnode_t::assignment_t>& b);
 
@@ -27,13 +27,22 @@ namespace np
     {
         nrun_ = 0;
         nfailed_ = 0;
+        naborted_ = 0;
         fprintf(stderr, "np: running\n");
     }
 
     void text_listener_t::end()
     {
-        fprintf(stderr, "np: %u run %u failed\n",
-                nrun_, nfailed_);
+        if(naborted_)
+        {
+            fprintf(stderr, "np: %u run %u failed %u aborted\n",
+                    nrun_, nfailed_, naborted_);
+        }
+        else
+        {
+            fprintf(stderr, "np: %u run %u failed\n",
+                    nrun_, nfailed_);
+        }
     }
 
     void text_listener_t::begin_job(const job_t *j)
@@ -54,6 +63,10 @@ namespace np
             case R_NOTAPPLICABLE:
                 fprintf(stderr, "N/A %s\n", nm.c_str());
                 break;
+            case R_ABORTED:
+                naborted_++;
+                fprintf(stderr, "ABORT %s\n", nm.c_str());
+                break;
             case R_FAIL:
                 nfailed_++;
                 fprintf(stderr, "FAIL %s\n", nm.c_str());
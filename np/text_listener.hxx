@@ -36,6 +36,7 @@ namespace np
       private:
         unsigned int nrun_;
         unsigned int nfailed_;
+        unsigned int naborted_;
     };
 
     // close the namespace
@@ -34,6 +34,8 @@ namespace np
                 return "mock";
             case FT_PARAM:
                 return "param";
+            case FT_VALGRIND:
+                return "valgrind";
             default:
                 return "INTERNAL ERROR!";
         }
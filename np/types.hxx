@@ -26,6 +26,7 @@ namespace np
         R_UNKNOWN = 0,
         R_PASS,
         R_NOTAPPLICABLE,
+        R_ABORTED,	/* killed by --fail-fast, not counted as failed */
         R_FAIL
     };
 
@@ -43,7 +44,8 @@ namespace np
 #define FT_NUM_SINGULAR	(FT_AFTER+1)
         FT_MOCK,
         FT_PARAM,
-#define FT_NUM		(FT_PARAM+1)
+        FT_VALGRIND,
+#define FT_NUM		(FT_VALGRIND+1)
     };
 
     extern const char *as_string(functype_t);
@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 #include "np/util/common.hxx"
+#include <time.h>
 
 namespace np
 {
@@ -140,6 +141,18 @@ namespace np
             return string(buf);
         }
 
+        /* FNV-1a, which gives the same answer on every machine */
+        uint64_t hash_string(const string &s)
+        {
+            uint64_t h = 14695981039346656037ULL;
+            for(size_t i = 0 ; i < s.length() ; i++)
+            {
+                h ^= (unsigned char)s[i];
+                h *= 1099511628211ULL;
+            }
+            return h;
+        }
+
         /*-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-*/
 
         static int64_t posix_now(int clock)
@@ -54,6 +54,11 @@
 #include <map>
 #include <vector>
 #include <exception>
+#if __cplusplus >= 201103L
+    #include <unordered_map>
+#else
+    #include <tr1/unordered_map>
+#endif
 
 #include "np/util/profile.hxx"
 
@@ -74,6 +79,12 @@ namespace np
     namespace util
     {
 
+#if __cplusplus >= 201103L
+        using std::unordered_map;
+#else
+        using std::tr1::unordered_map;
+#endif
+
         extern int u32cmp(uint32_t ul1, uint32_t ul2);
         extern int u64cmp(uint64_t ull1, uint64_t ull2);
 
@@ -106,6 +117,7 @@ namespace np
         extern std::string hex(unsigned long x);
         extern std::string HEX(unsigned long x);
         extern std::string dec(unsigned int x);
+        extern uint64_t hash_string(const std::string &s);
 
 #define NANOSEC_PER_SEC	    (1000000000LL)
         extern int64_t rel_now();
@@ -0,0 +1,99 @@
+/*
+ * Copyright 2011-2012 Gregory Banks
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "np/util/parallel.hxx"
+#include <pthread.h>
+
+namespace np
+{
+    namespace util
+    {
+        using namespace std;
+
+        unsigned int parallel_t::max_threads()
+        {
+            const char *e = getenv("NOVAPROVA_THREADS");
+            if(e && *e)
+            {
+                int n = atoi(e);
+                return (n < 1 ? 1 : n);
+            }
+            long n = sysconf(_SC_NPROCESSORS_ONLN);
+            return (n < 1 ? 1 : n);
+        }
+
+        void parallel_t::drain()
+        {
+            for(;;)
+            {
+                unsigned int i = __sync_fetch_and_add(&next_, 1);
+                if(i >= n_)
+                {
+                    break;
+                }
+                work(i);
+            }
+        }
+
+        void *parallel_t::thread_main(void *closure)
+        {
+            ((parallel_t *)closure)->drain();
+            return 0;
+        }
+
+        void parallel_t::run(unsigned int n)
+        {
+            n_ = n;
+            next_ = 0;
+
+            unsigned int nthreads = max_threads();
+            if(nthreads > n)
+            {
+                nthreads = n;
+            }
+
+            /* the calling thread is one of the workers */
+            vector<pthread_t> threads;
+            for(unsigned int t = 1 ; t < nthreads ; t++)
+            {
+                pthread_t th;
+                int r = pthread_create(&th, 0, thread_main, this);
+                if(r)
+                {
+                    /* not fatal, we just have fewer workers */
+                    #if _NP_DEBUG
+                    fprintf(stderr, "np: pthread_create: %s\n", strerror(r));
+                    #endif
+                    break;
+                }
+                threads.push_back(th);
+            }
+            #if _NP_DEBUG
+            fprintf(stderr, "np: [%s] running %u work items on %u threads\n",
+                    rel_timestamp(), n, (unsigned)threads.size()+1);
+            #endif
+
+            drain();
+
+            vector<pthread_t>::iterator i;
+            for(i = threads.begin() ; i != threads.end() ; ++i)
+            {
+                pthread_join(*i, 0);
+            }
+        }
+
+        // close the namespaces
+    };
+};
@@ -0,0 +1,58 @@
+/*
+ * Copyright 2011-2012 Gregory Banks
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef __NP_UTIL_PARALLEL_H__
+#define __NP_UTIL_PARALLEL_H__ 1
+
+#include "np/util/common.hxx"
+
+namespace np
+{
+    namespace util
+    {
+
+        /*
+         * Runs work(0)..work(n-1) on a pool of threads, one per CPU,
+         * and waits for them all to finish.  The items are handed out
+         * in order but may complete in any order, so work() should
+         * store its results in a slot indexed by its argument and the
+         * caller should merge the slots afterwards.  No threads are
+         * left behind, so it's safe to fork() afterward.
+         */
+        class parallel_t
+        {
+          public:
+            parallel_t() {}
+            virtual ~parallel_t() {}
+
+            void run(unsigned int n);
+            virtual void work(unsigned int i) = 0;
+
+            /* $NOVAPROVA_THREADS, or the number of online CPUs */
+            static unsigned int max_threads();
+
+          private:
+            static void *thread_main(void *);
+            void drain();
+
+            unsigned int n_;
+            unsigned int next_;
+        };
+
+        // close the namespaces
+    };
+};
+
+#endif /* __NP_UTIL_PARALLEL_H__ */
@@ -0,0 +1,38 @@
+#!/bin/bash
+#
+#  Copyright 2011-2012 Gregory Banks
+#
+#  Licensed under the Apache License, Version 2.0 (the "License");
+#  you may not use this file except in compliance with the License.
+#  You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+#  Unless required by applicable law or agreed to in writing, software
+#  distributed under the License is distributed on an "AS IS" BASIS,
+#  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+#  See the License for the specific language governing permissions and
+#  limitations under the License.
+#
+
+
+TEST="$1"
+dir=$TEST.cachedir
+
+rm -rf $dir $TEST.run
+mkdir $dir
+export NOVAPROVA_CACHE=$PWD/$dir
+
+cp $TEST $TEST.run
+./$TEST.run --list | grep -v '^np: ' > $TEST.1
+./$TEST.run --list | grep -v '^np: ' > $TEST.2
+cmp -s $TEST.1 $TEST.2 && echo "MSG second run lists the same tests"
+[ $(ls $dir | wc -l) = 1 ] && echo "MSG discovery was cached"
+
+# rebuilt in place with another test
+cp -f ${TEST}2 $TEST.run
+./$TEST.run --list | grep -v '^np: ' > $TEST.3
+grep -q '^tncache\.banana$' $TEST.3 && echo "MSG rebuilt executable lists the new test"
+[ $(ls $dir | wc -l) = 2 ] && echo "MSG rebuilt executable was cached separately"
+
+rm -rf $dir $TEST.run $TEST.1 $TEST.2 $TEST.3
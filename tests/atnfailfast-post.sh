@@ -0,0 +1,31 @@
+#!/bin/bash
+#
+#  Copyright 2011-2012 Gregory Banks
+#
+#  Licensed under the Apache License, Version 2.0 (the "License");
+#  you may not use this file except in compliance with the License.
+#  You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+#  Unless required by applicable law or agreed to in writing, software
+#  distributed under the License is distributed on an "AS IS" BASIS,
+#  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+#  See the License for the specific language governing permissions and
+#  limitations under the License.
+#
+
+TEST="$1"
+shift
+
+# Only the run in parallel has a sibling to abort
+case " $* " in
+*" -fjunit "*) ;;
+*) exit ;;
+esac
+
+xml=reports/TEST-$TEST.xml
+[ "$(xmllint --xpath 'string(//testcase[@name="e"]/skipped/@message)' $xml)" = aborted ] && \
+    echo "MSG running sibling reported as aborted"
+[ "$(xmllint --xpath 'count(//testcase[@name="a" or @name="b"])' $xml)" = 0 ] && \
+    echo "MSG later tests never started"
@@ -0,0 +1,37 @@
+#!/bin/bash
+#
+#  Copyright 2011-2012 Gregory Banks
+#
+#  Licensed under the Apache License, Version 2.0 (the "License");
+#  you may not use this file except in compliance with the License.
+#  You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+#  Unless required by applicable law or agreed to in writing, software
+#  distributed under the License is distributed on an "AS IS" BASIS,
+#  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+#  See the License for the specific language governing permissions and
+#  limitations under the License.
+#
+
+TEST="$1"
+
+hist=$TEST.hist
+
+function duration()
+{
+    sed -n -e 's/^\([0-9]*\)\t'$TEST'\.'$1'$/\1/p' $hist
+}
+
+[ "$(stat -c %i $hist)" != "$(cat $hist.inode)" ] && \
+    [ -z "$(ls $hist.*.tmp 2>/dev/null)" ] && \
+    echo "MSG history file replaced by rename"
+[ "$(grep -c . $hist)" = 4 ] && [ "$(duration gone)" = 5000000 ] && \
+    echo "MSG history of tests not run is kept"
+early=$(duration early)
+[ -n "$early" ] && [ "$early" -lt 9000000000 ] && \
+    [ -n "$(duration middle)" ] && [ "$(duration middle)" != 1000000 ] && \
+    echo "MSG durations are updated"
+
+rm -f $hist $hist.inode
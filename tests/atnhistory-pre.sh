@@ -0,0 +1,28 @@
+#!/bin/bash
+#
+#  Copyright 2011-2012 Gregory Banks
+#
+#  Licensed under the Apache License, Version 2.0 (the "License");
+#  you may not use this file except in compliance with the License.
+#  You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+#  Unless required by applicable law or agreed to in writing, software
+#  distributed under the License is distributed on an "AS IS" BASIS,
+#  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+#  See the License for the specific language governing permissions and
+#  limitations under the License.
+#
+
+TEST="$1"
+
+# durations in nanoseconds, one stale entry, and some garbage
+hist=$TEST.hist
+rm -f $hist $hist.*.tmp
+printf '9000000000\t%s.early\n' $TEST > $hist
+printf '1000000\t%s.middle\n' $TEST >> $hist
+printf '2000000\t%s.late\n' $TEST >> $hist
+printf '5000000\t%s.gone\n' $TEST >> $hist
+printf 'garbage\n' >> $hist
+stat -c %i $hist > $hist.inode
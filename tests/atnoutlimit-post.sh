@@ -0,0 +1,43 @@
+#!/bin/bash
+#
+#  Copyright 2011-2012 Gregory Banks
+#
+#  Licensed under the Apache License, Version 2.0 (the "License");
+#  you may not use this file except in compliance with the License.
+#  You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+#  Unless required by applicable law or agreed to in writing, software
+#  distributed under the License is distributed on an "AS IS" BASIS,
+#  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+#  See the License for the specific language governing permissions and
+#  limitations under the License.
+#
+
+TEST="$1"
+
+xml=reports/TEST-$TEST.xml
+out=$(xmllint --xpath 'string(//system-out)' $xml)
+
+# the first 50000 bytes, the marker, then the last 50000 bytes
+echo "$out" | grep -q '^\[\.\.\. 200000 bytes omitted \.\.\.\]$' && \
+    echo "MSG omitted bytes are counted"
+[ "$(echo "$out" | grep -A1 '^===big===$' | tail -1)" = line00000 ] && \
+    [ "$(echo "$out" | grep -B2 'bytes omitted' | head -1)" = line04999 ] && \
+    [ "$(echo "$out" | grep -A1 'bytes omitted' | tail -1)" = line25000 ] && \
+    [ "$(echo "$out" | grep -B1 '^===small===$' | head -1)" = line29999 ] && \
+    echo "MSG head and tail are kept"
+[ "$(echo "$out" | grep -c '^line')" = 10000 ] && \
+    echo "MSG nothing else is kept"
+echo "$out" | grep -A1 '^===small===$' | grep -q '^small$' && \
+    echo "MSG small output is kept whole"
+
+# the spill file is gone once the run is over
+tmp=$TEST.tmp
+rm -rf $tmp
+mkdir $tmp
+TMPDIR=$PWD/$tmp ./$TEST --output-limit=100000 -fjunit > /dev/null 2>&1 && \
+    [ -z "$(ls -A $tmp)" ] && \
+    echo "MSG spill file is removed"
+rm -rf $tmp
@@ -0,0 +1,56 @@
+#!/bin/bash
+#
+#  Copyright 2011-2012 Gregory Banks
+#
+#  Licensed under the Apache License, Version 2.0 (the "License");
+#  you may not use this file except in compliance with the License.
+#  You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+#  Unless required by applicable law or agreed to in writing, software
+#  distributed under the License is distributed on an "AS IS" BASIS,
+#  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+#  See the License for the specific language governing permissions and
+#  limitations under the License.
+#
+
+TEST="$1"
+
+# The same run again without --prefork, in a directory of its own
+# so that it writes its own reports
+rm -rf $TEST.noprefork
+mkdir -p $TEST.noprefork/reports
+(cd $TEST.noprefork && ../$TEST -j2 -fjunit > /dev/null 2>&1)
+
+# Each test's name, result and message, without pids and the like
+function results()
+{
+    local xml="$1"
+    local t
+    for t in $(xmllint --xpath '//testcase/@name' $xml | sed -e 's/ name="\([^"]*\)"/\1 /g') ; do
+        echo "$t" \
+            $(xmllint --xpath "name(//testcase[@name='$t']/*[not(self::properties)])" $xml) \
+            $(xmllint --xpath "string(//testcase[@name='$t']/*[not(self::properties)]/@message)" $xml)
+    done | sed -e 's/[0-9][0-9]*/N/g' | sort
+}
+
+function output()
+{
+    xmllint --xpath 'string(//system-out)' $1
+    xmllint --xpath 'string(//system-err)' $1
+}
+
+xml=reports/TEST-$TEST.xml
+noxml=$TEST.noprefork/reports/TEST-$TEST.xml
+
+[ "$(xmllint --xpath 'count(//testcase)' $xml)" = 6 ] && \
+    echo "MSG every test reported"
+grep -q forkserver_t $xml && ! grep -q forkserver_t $noxml && \
+    echo "MSG tests ran in the fork server"
+[ "$(results $xml)" = "$(results $noxml)" ] && \
+    echo "MSG same results without --prefork"
+[ "$(output $xml)" = "$(output $noxml)" ] && \
+    echo "MSG same output without --prefork"
+
+rm -rf $TEST.noprefork
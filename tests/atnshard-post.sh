@@ -0,0 +1,37 @@
+#!/bin/bash
+#
+#  Copyright 2011-2012 Gregory Banks
+#
+#  Licensed under the Apache License, Version 2.0 (the "License");
+#  you may not use this file except in compliance with the License.
+#  You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+#  Unless required by applicable law or agreed to in writing, software
+#  distributed under the License is distributed on an "AS IS" BASIS,
+#  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+#  See the License for the specific language governing permissions and
+#  limitations under the License.
+#
+
+TEST="$1"
+
+./$TEST --list | grep -v '^np: ' | sort > $TEST.all
+./$TEST --list --shard 1/2 | grep -v '^np: ' | sort > $TEST.1
+./$TEST --list --shard 2/2 | grep -v '^np: ' | sort > $TEST.2
+./$TEST --shard 1/2 2>&1 | sed -n -e 's/^PASS //p' | sort > $TEST.run1
+
+[ -s $TEST.1 -a -s $TEST.2 ] && echo "MSG every shard has tests"
+[ -z "$(sort $TEST.1 $TEST.2 | uniq -d)" ] && echo "MSG shards do not overlap"
+sort $TEST.1 $TEST.2 | cmp -s - $TEST.all && echo "MSG shards cover every test"
+cmp -s $TEST.1 $TEST.run1 && echo "MSG shard runs the tests it lists"
+
+# without a history file the shards' sizes differ by at most one
+sizes=$(for i in 1 2 3 ; do
+    ./$TEST --list --shard $i/3 | grep -v '^np: ' | wc -l
+done | sort -n)
+[ $(echo "$sizes" | tail -1) -le $(( $(echo "$sizes" | head -1) + 1 )) ] && \
+    echo "MSG shard sizes differ by at most one"
+
+rm -f $TEST.all $TEST.1 $TEST.2 $TEST.run1
@@ -0,0 +1,39 @@
+#!/bin/bash
+#
+#  Copyright 2011-2012 Gregory Banks
+#
+#  Licensed under the Apache License, Version 2.0 (the "License");
+#  you may not use this file except in compliance with the License.
+#  You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+#  Unless required by applicable law or agreed to in writing, software
+#  distributed under the License is distributed on an "AS IS" BASIS,
+#  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+#  See the License for the specific language governing permissions and
+#  limitations under the License.
+#
+
+TEST="$1"
+
+function list()
+{
+    echo "MSG $*"
+    ./$TEST --list "$@" 2>&1 | grep -v '^np: ' | sort | sed -e 's/^/MSG     /'
+}
+
+function run()
+{
+    echo "MSG run $*"
+    ./$TEST "$@" 2>&1 | sed -n -e 's/^\(PASS\|FAIL\) /MSG     &/p' | sort
+}
+
+list 'tnspec.b*'
+list 'tnspec.[ace]*'
+list 'tnspec*'
+list '/^tnspec\.(ash|elm)$/'
+list '/h$/'
+list tnspec.elm tnspec.ash
+list 'tnspec.b*' tnspec.cedar '/m$/'
+run tnspec.cedar 'tnspec.b*' '/^tnspec\.ash$/'
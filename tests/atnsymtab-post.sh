@@ -0,0 +1,32 @@
+#!/bin/bash
+#
+#  Copyright 2011-2012 Gregory Banks
+#
+#  Licensed under the Apache License, Version 2.0 (the "License");
+#  you may not use this file except in compliance with the License.
+#  You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+#  Unless required by applicable law or agreed to in writing, software
+#  distributed under the License is distributed on an "AS IS" BASIS,
+#  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+#  See the License for the specific language governing permissions and
+#  limitations under the License.
+#
+
+
+TEST="$1"
+
+# make both runs really scan, rather than load the other's results
+export NOVAPROVA_CACHE=no
+
+./$TEST --list | grep -v '^np: ' > $TEST.dwarf
+NOVAPROVA_DISCOVERY=symtab ./$TEST --list | grep -v '^np: ' > $TEST.symtab
+./$TEST 2>&1 | egrep '^(PASS|FAIL) ' > $TEST.dwarfrun
+NOVAPROVA_DISCOVERY=symtab ./$TEST 2>&1 | egrep '^(PASS|FAIL) ' > $TEST.symtabrun
+
+[ -s $TEST.dwarf ] && cmp -s $TEST.dwarf $TEST.symtab && echo "MSG symtab discovery lists the same tests"
+[ -s $TEST.dwarfrun ] && cmp -s $TEST.dwarfrun $TEST.symtabrun && echo "MSG symtab discovery runs the same tests"
+
+rm -f $TEST.dwarf $TEST.symtab $TEST.dwarfrun $TEST.symtabrun
@@ -0,0 +1,35 @@
+#!/bin/bash
+#
+#  Copyright 2011-2012 Gregory Banks
+#
+#  Licensed under the Apache License, Version 2.0 (the "License");
+#  you may not use this file except in compliance with the License.
+#  You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+#  Unless required by applicable law or agreed to in writing, software
+#  distributed under the License is distributed on an "AS IS" BASIS,
+#  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+#  See the License for the specific language governing permissions and
+#  limitations under the License.
+#
+
+TEST="$1"
+
+xml=reports/TEST-$TEST.xml
+
+function property()
+{
+    xmllint --xpath "string(//testcase[@name='$1']/properties/property[@name='$2']/@value)" $xml
+}
+
+[ "$(xmllint --xpath 'count(//testcase)' $xml)" = 3 ] && \
+    echo "MSG 3 testcases"
+n=0
+for t in $(xmllint --xpath '//testcase/@name' $xml | sed -e 's/ name="\([^"]*\)"/\1 /g') ; do
+    utime=$(property $t utime)
+    maxrss=$(property $t maxrss)
+    [ -n "$utime" ] && [ -n "$maxrss" ] && [ "$maxrss" -gt 0 ] && n=$[n+1]
+done
+[ $n = 3 ] && echo "MSG every testcase has utime and maxrss properties"
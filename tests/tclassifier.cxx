@@ -0,0 +1,112 @@
+/*
+ * Copyright 2011-2012 Gregory Banks
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "np/classifier.hxx"
+#include "fw.h"
+#include <string>
+
+using namespace std;
+
+/*
+ * Checks that the matcher for simple classifiers agrees with the
+ * regex engine, on whether each name matches and on what the
+ * group captures, for the built-in classifiers and some others.
+ */
+static const struct
+{
+    const char *re;
+    bool case_sensitive;
+    bool simple;
+} patterns[] = {
+    /* the built-in ones, as in testmanager_t::setup_classifiers() */
+    { "^test_([a-z0-9].*)", false, true },
+    { "^[tT]est([A-Z].*)", false, true },
+    { "^[sS]etup$", false, true },
+    { "^set_up$", false, true },
+    { "^[iI]nit$", false, true },
+    { "^[tT]ear[dD]own$", false, true },
+    { "^tear_down$", false, true },
+    { "^[cC]leanup$", false, true },
+    { "^mock_(.*)", false, true },
+    { "^[mM]ock([A-Z].*)", false, true },
+    { "^__np_parameter_(.*)", false, true },
+    { "^__np_valgrind$", false, true },
+    /* the same, case sensitive */
+    { "^test_([a-z0-9].*)", true, true },
+    { "^[tT]est([A-Z].*)", true, true },
+    { "^[mM]ock([A-Z].*)", true, true },
+    /* anchored, with and without groups */
+    { "^should_(.*)", true, true },
+    { "^should_.*", true, true },
+    { "^(should)_.*", true, true },
+    { "^(sh[o0]uld_)", true, true },
+    { "^it_([a-z][a-z])_ok$", true, true },
+    { "^it_([a-z][a-z])_ok$", false, true },
+    { "^(.*)", true, true },
+    { "^spec$", true, true },
+    /* the regex engine does these for both */
+    { "should_(.*)", true, false },
+    { "^should_([a-z]*)$", true, false },
+    { "^(it|should)_(.*)", true, false },
+};
+
+static const char *names[] = {
+    "", "t", "te", "test", "test_", "test_1", "test_foo", "TEST_FOO",
+    "test_Foo", "xtest_foo", "testFoo", "TestFoo", "Testfoo", "testfoo",
+    "setup", "Setup", "SETUP", "setup_", "set_up", "init", "Init",
+    "teardown", "TearDown", "tear_down", "cleanup", "Cleanup",
+    "mock_", "mock_malloc", "MOCK_malloc", "MockFoo", "mockFoo", "mockfoo",
+    "__np_parameter_", "__np_parameter_x", "__np_valgrind", "__np_valgrindx",
+    "should", "should_", "should_pass", "Should_pass", "SHOULD_PASS",
+    "sh0uld_pass", "it_is_ok", "it_IS_ok", "it_is_okay", "it_isn_ok",
+    "spec", "spec_", "main",
+};
+
+int main(int argc, char **argv)
+{
+    for(unsigned i = 0 ; i < sizeof(patterns)/sizeof(patterns[0]) ; i++)
+    {
+        BEGIN("/%s/%s", patterns[i].re, (patterns[i].case_sensitive ? "" : "i"));
+        np::classifier_t *cl = new np::classifier_t;
+        CHECK(cl->set_regexp(patterns[i].re, patterns[i].case_sensitive));
+        CHECK(cl->is_simple() == patterns[i].simple);
+
+        regex_t re;
+        CHECK(!regcomp(&re, patterns[i].re,
+                       REG_EXTENDED | (patterns[i].case_sensitive ? 0 : REG_ICASE)));
+        for(unsigned j = 0 ; j < sizeof(names)/sizeof(names[0]) ; j++)
+        {
+            const char *name = names[j];
+            char submatch[256] = "";
+            regmatch_t match[2];
+            bool matched = cl->match(name, submatch, sizeof(submatch));
+            CHECK(matched == !regexec(&re, name, 2, match, 0));
+            if(matched)
+            {
+                string expected;
+                if(match[1].rm_so >= 0)
+                {
+                    expected = string(name + match[1].rm_so,
+                                      match[1].rm_eo - match[1].rm_so);
+                }
+                CHECK(expected == submatch);
+            }
+        }
+        regfree(&re);
+        delete cl;
+        END;
+    }
+    return 0;
+}
@@ -61,7 +61,14 @@ static void dump_functions(np::spiegel::dwarf::state_t &state)
             {
                 printf("/*0x%lx*/", addr);
             }
-            printf(" %s\n", (*j)->to_string().c_str());
+            printf(" %s", (*j)->to_string().c_str());
+            if((*j)->get_declaration_line())
+            {
+                printf(" /* %s:%u */",
+                       (*j)->get_declaration_file().basename().c_str(),
+                       (*j)->get_declaration_line());
+            }
+            printf("\n");
         }
     }
 
@@ -0,0 +1,55 @@
+/*
+ * Copyright 2011-2012 Gregory Banks
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <np.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Built with -fsanitize=address, so the sanitizers check memory
+ * instead of Valgrind, and each report fails the running test.
+ */
+void do_a_small_overrun(char *buf)
+{
+    strcpy(buf, "012345678901234567890123456789012");
+}
+
+static void test_heap_overrun_small(void)
+{
+    char *buf = malloc(32);
+
+    fprintf(stderr, "MSG about to overrun a buffer by a small amount\n");
+    do_a_small_overrun(buf);
+    fprintf(stderr, "MSG overran\n");
+    free(buf);
+}
+
+static void test_leak(void)
+{
+    char *buf = malloc(32);
+
+    strcpy(buf, "leaked");
+    buf = NULL;
+}
+
+static void test_clean(void)
+{
+    char *buf = malloc(32);
+
+    strcpy(buf, "clean");
+    NP_ASSERT_STR_EQUAL(buf, "clean");
+    free(buf);
+}
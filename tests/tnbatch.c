@@ -0,0 +1,65 @@
+/*
+ * Copyright 2011-2012 Gregory Banks
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <np.h>
+#include <string.h>
+#include <stdio.h>
+
+/*
+ * Run with --batch, so that several tests share a child process
+ * and each must still see the initial values of these variables.
+ */
+static int counter = 42;
+static char word[16] = "pristine";
+
+static void check_and_clobber(void)
+{
+    static int calls;
+
+    fprintf(stderr, "MSG counter=%d word=\"%s\" calls=%d\n",
+            counter, word, calls);
+    NP_ASSERT_EQUAL(counter, 42);
+    NP_ASSERT_STR_EQUAL(word, "pristine");
+    NP_ASSERT_EQUAL(calls, 0);
+    counter = 99;
+    strcpy(word, "clobbered");
+    calls++;
+}
+
+static void test_a(void)
+{
+    check_and_clobber();
+}
+
+static void test_b(void)
+{
+    check_and_clobber();
+}
+
+static void test_c(void)
+{
+    check_and_clobber();
+    NP_FAIL;
+}
+
+static void test_d(void)
+{
+    check_and_clobber();
+}
+
+static void test_e(void)
+{
+    check_and_clobber();
+}
@@ -0,0 +1,26 @@
+/*
+ * Copyright 2011-2012 Gregory Banks
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <np.h>
+
+/*
+ * Built twice, the second time with TNCACHE_MORE defined, so that
+ * atncache-post.sh can replace the executable with one containing
+ * another test and check the discovery cache doesn't hide it.
+ */
+static void test_apple(void) { }
+#ifdef TNCACHE_MORE
+static void test_banana(void) { }
+#endif
@@ -0,0 +1,95 @@
+/*
+ * Copyright 2011-2012 Gregory Banks
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <np.h>
+#include <stdio.h>
+
+/*
+ * Discovers tests, fixtures and mocks named by the project's own
+ * conventions, registered with np_add_classifier() before np_init().
+ */
+static int nprepared = 0;
+static int ncleaned = 0;
+
+static int arrange(void)
+{
+    nprepared++;
+    return 0;
+}
+
+static int clean_up_after(void)
+{
+    ncleaned++;
+    return 0;
+}
+
+static int carrot_cake(int x)
+{
+    return x + 1;
+}
+
+static int fake_carrot_cake(int x)
+{
+    return x - 1;
+}
+
+static void should_run_the_fixture(void)
+{
+    NP_ASSERT_EQUAL(nprepared, 1);
+    NP_ASSERT_EQUAL(ncleaned, 0);
+}
+
+static void should_use_the_mock(void)
+{
+    NP_ASSERT_EQUAL(carrot_cake(10), 9);
+}
+
+/* not tests: the classifier is case sensitive and wants an underscore */
+static void Should_not_be_run(void)
+{
+    NP_FAIL;
+}
+
+static void shouldnt_be_run(void)
+{
+    NP_FAIL;
+}
+
+int main(int argc, char **argv)
+{
+    np_runner_t *runner;
+    int ec;
+
+    if(!np_add_classifier("^should_(.*)", true, NP_CLASSIFY_TEST) ||
+       /* a group in a fixture classifier is ignored */
+       !np_add_classifier("^(arrange|prepare)$", true, NP_CLASSIFY_SETUP) ||
+       !np_add_classifier("^clean_up_after$", true, NP_CLASSIFY_TEARDOWN) ||
+       !np_add_classifier("^fake_(.*)", true, NP_CLASSIFY_MOCK))
+    {
+        printf("MSG np_add_classifier failed\n");
+        return 1;
+    }
+    if(np_add_classifier("^bad_(", true, NP_CLASSIFY_TEST) ||
+       np_add_classifier("^ok_(.*)", true, 0))
+    {
+        printf("MSG np_add_classifier accepted a bad classifier\n");
+        return 1;
+    }
+
+    runner = np_init();
+    ec = np_run_tests(runner, NULL);
+    np_done(runner);
+    return ec;
+}
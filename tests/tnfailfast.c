@@ -0,0 +1,45 @@
+/*
+ * Copyright 2011-2012 Gregory Banks
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <np.h>
+#include <unistd.h>
+
+/*
+ * Run with --fail-fast, so that the tests after the
+ * first failure are never started.  With -j2 the slow
+ * test is still running when its sibling fails, and is
+ * aborted instead.
+ */
+static void test_a(void)
+{
+}
+
+static void test_b(void)
+{
+}
+
+static void test_c(void)
+{
+    NP_FAIL;
+}
+
+static void test_d(void)
+{
+}
+
+static void test_e(void)
+{
+    sleep(5);
+}
@@ -0,0 +1,34 @@
+/*
+ * Copyright 2011-2012 Gregory Banks
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <np.h>
+
+/*
+ * Run with a history file seeded by atnhistory-pre.sh, which says
+ * that early takes much longer than the others, so it should be
+ * dispatched first even though it would otherwise run last.
+ * atnhistory-post.sh checks the file afterwards.
+ */
+static void test_early(void)
+{
+}
+
+static void test_middle(void)
+{
+}
+
+static void test_late(void)
+{
+}
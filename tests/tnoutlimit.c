@@ -0,0 +1,83 @@
+/*
+ * Copyright 2011-2012 Gregory Banks
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <np.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <limits.h>
+#include <dirent.h>
+
+/*
+ * Run with --output-limit=100000 and -fjunit, so that the runner
+ * keeps only the first and last 50000 bytes of the output, in a
+ * temporary file because that's more than 64KiB.  The JUnit
+ * report is checked by atnoutlimit-post.sh.
+ */
+
+/* whether the runner, our parent, has a deleted spill file open */
+static int parent_has_spill_file(void)
+{
+    char dir[64];
+    char path[PATH_MAX];
+    char target[PATH_MAX];
+    struct dirent *de;
+    DIR *d;
+    int found = 0;
+
+    snprintf(dir, sizeof(dir), "/proc/%d/fd", (int)getppid());
+    d = opendir(dir);
+    if(!d)
+    {
+        return 0;
+    }
+    while((de = readdir(d)))
+    {
+        ssize_t n;
+        snprintf(path, sizeof(path), "%s/%s", dir, de->d_name);
+        n = readlink(path, target, sizeof(target)-1);
+        if(n < 0)
+        {
+            continue;
+        }
+        target[n] = '\0';
+        if(strstr(target, "/novaprova.out.") && strstr(target, "(deleted)"))
+        {
+            found = 1;
+        }
+    }
+    closedir(d);
+    return found;
+}
+
+static void test_big(void)
+{
+    int i;
+
+    /* 300000 bytes, of which the pipe holds at most 64KiB, so
+     * the runner has read more than that when the loop ends */
+    for(i = 0 ; i < 30000 ; i++)
+    {
+        printf("line%05d\n", i);
+    }
+    fflush(stdout);
+    NP_ASSERT_TRUE(parent_has_spill_file());
+}
+
+static void test_small(void)
+{
+    printf("small\n");
+}
@@ -0,0 +1,53 @@
+/*
+ * Copyright 2011-2012 Gregory Banks
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <np.h>
+#include <stdio.h>
+#include <unistd.h>
+
+/*
+ * Run with --prefork, so each test is started by a worker from
+ * the fork server.  atnprefork-post.sh checks that the results
+ * are the same as without it.
+ */
+static void test_pass(void)
+{
+}
+
+static void test_fail(void)
+{
+    NP_FAIL;
+}
+
+static void test_notapplicable(void)
+{
+    NP_NOTAPPLICABLE;
+}
+
+static void test_output(void)
+{
+    printf("to stdout\n");
+    fprintf(stderr, "to stderr\n");
+}
+
+static void test_exit(void)
+{
+    _exit(3);
+}
+
+static void test_slow(void)
+{
+    usleep(200000);
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright 2011-2012 Gregory Banks
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <np.h>
+#include <np/spiegel/spiegel.hxx>
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ * Built with -gpubnames, so discovery and the lookup of mock
+ * targets use the name index.  The discovery cache is turned off
+ * so the index is searched every run.
+ */
+
+static int called = 0;
+static int fixtured = 0;
+
+static int cargo_basket(int x)
+{
+    return x + 1;
+}
+
+static int mock_cargo_basket(int x)
+{
+    called++;
+    return x - 1;
+}
+
+namespace weevil
+{
+    int larva(int x)
+    {
+        return x * 2;
+    }
+};
+
+static int not_larva(int x)
+{
+    return x;
+}
+
+static int setup(void)
+{
+    fixtured++;
+    return 0;
+}
+
+NP_PARAMETER(ryegrass, "vergil,poughkeepsie");
+
+static void test_index(void)
+{
+    NP_ASSERT_EQUAL(fixtured, 1);
+    NP_ASSERT_EQUAL(cargo_basket(42), 41);
+    NP_ASSERT_EQUAL(called, 1);
+    np_mock_by_name("weevil::larva", not_larva);
+    NP_ASSERT_EQUAL(weevil::larva(42), 42);
+    NP_ASSERT_NOT_NULL(ryegrass);
+    NP_ASSERT(np::spiegel::compile_unit_t::get_num_pubnames_searches() > 0);
+}
+
+int main(int argc, char **argv)
+{
+    np_runner_t *runner;
+    int ec;
+
+    setenv("NOVAPROVA_CACHE", "no", 1);
+    runner = np_init();
+    ec = np_run_tests(runner, NULL);
+    np_done(runner);
+    return ec;
+}
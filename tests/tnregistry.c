@@ -0,0 +1,61 @@
+/*
+ * Copyright 2011-2012 Gregory Banks
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <np.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Built without debugging info, so only the registry finds these */
+
+static int called = 0;
+static int fixtured = 0;
+
+static int cargo_basket(int x)
+{
+    return x + 1;
+}
+
+NP_MOCK(int, cargo_basket, (int x))
+{
+    called++;
+    return x - 1;
+}
+
+NP_SETUP()
+{
+    fixtured++;
+    return 0;
+}
+
+NP_TEARDOWN()
+{
+    fixtured--;
+    return 0;
+}
+
+NP_PARAMETER(ryegrass, "vergil,poughkeepsie");
+
+NP_TEST(registered)
+{
+    NP_ASSERT_EQUAL(fixtured, 1);
+    NP_ASSERT_EQUAL(cargo_basket(42), 41);
+    NP_ASSERT_EQUAL(called, 1);
+    NP_ASSERT_NOT_NULL(ryegrass);
+}
+
+NP_TEST(also_registered)
+{
+    NP_ASSERT_EQUAL(fixtured, 1);
+}
@@ -0,0 +1,36 @@
+/*
+ * Copyright 2011-2012 Gregory Banks
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <np.h>
+
+/*
+ * Linked with tnregmix_dwarf.c, whose tests are discovered from the
+ * DWARF info as asked here, and compiled as ../tests/tnregmix.c so
+ * the registered path has a ".." in it.
+ */
+NP_DISCOVER_TESTS();
+
+static int fixtured = 0;
+
+NP_SETUP()
+{
+    fixtured++;
+    return 0;
+}
+
+NP_TEST(registered)
+{
+    NP_ASSERT_EQUAL(fixtured, 1);
+}
@@ -0,0 +1,30 @@
+/*
+ * Copyright 2011-2012 Gregory Banks
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <np.h>
+
+/* Discovered in the DWARF info, alongside tnregmix.c's registered tests */
+static int fixtured = 0;
+
+static int setup(void)
+{
+    fixtured++;
+    return 0;
+}
+
+static void test_discovered(void)
+{
+    NP_ASSERT_EQUAL(fixtured, 1);
+}
@@ -0,0 +1,68 @@
+/*
+ * Copyright 2011-2012 Gregory Banks
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <np.h>
+#include <stdio.h>
+
+/*
+ * A bit of everything discovery finds, so that atnsymtab-post.sh
+ * can check that NOVAPROVA_DISCOVERY=symtab finds the same.
+ */
+static int fixtured = 0;
+
+static int plum_cordial(int x)
+{
+    return x + 1;
+}
+
+static int mock_plum_cordial(int x)
+{
+    return x - 1;
+}
+
+static int setup(void)
+{
+    fixtured++;
+    return 0;
+}
+
+static int teardown(void)
+{
+    return 0;
+}
+
+NP_PARAMETER(vintage, "1987,2003");
+
+static void test_static(void)
+{
+    NP_ASSERT_EQUAL(fixtured, 1);
+    NP_ASSERT_EQUAL(plum_cordial(10), 9);
+    NP_ASSERT_NOT_NULL(vintage);
+}
+
+void test_global(void)
+{
+    NP_ASSERT_EQUAL(fixtured, 1);
+}
+
+/* not tests: the wrong signature */
+static int test_returns(void)
+{
+    return 0;
+}
+
+static void test_takes(int x)
+{
+}
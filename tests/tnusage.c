@@ -0,0 +1,47 @@
+/*
+ * Copyright 2011-2012 Gregory Banks
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <np.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Run with -fjunit both forked and with --batch; atnusage-post.sh
+ * checks that every testcase in the report carries its resource
+ * usage as properties, including the one which fails.
+ */
+static void test_spin(void)
+{
+    volatile unsigned long x = 0;
+    unsigned long i;
+
+    for(i = 0 ; i < 10000000 ; i++)
+        x += i;
+}
+
+static void test_touch(void)
+{
+    size_t size = 4 << 20;
+    char *p = (char *)malloc(size);
+
+    NP_ASSERT_NOT_NULL(p);
+    memset(p, 0x5a, size);
+    free(p);
+}
+
+static void test_fail(void)
+{
+    NP_FAIL;
+}
@@ -0,0 +1,147 @@
+/*
+ * Copyright 2011-2012 Gregory Banks
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <np.h>
+#include <np/util/config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+#if HAVE_VALGRIND
+#include <valgrind/valgrind.h>
+#endif
+
+/*
+ * Run the tests with NOVAPROVA_VALGRIND=children, so the runner
+ * stays native and each test is started by a fork server running
+ * under Valgrind.  Linked with tnvgchildren_native.c, which asks
+ * for no Valgrind at all, tnvgchildren_noleak.c, which turns off
+ * the leak check, and tnvgchildren_fail.c, whose tests must each
+ * fail.  Skipped (passing trivially) when NovaProva was built
+ * without Valgrind or the Valgrind binary is missing.
+ */
+static void test_under_valgrind(void)
+{
+#if HAVE_VALGRIND
+    NP_ASSERT_TRUE(RUNNING_ON_VALGRIND);
+#endif
+}
+
+static void test_clean_memory(void)
+{
+    char *p = (char *)malloc(32);
+    NP_ASSERT_NOT_NULL(p);
+    strcpy(p, "clean");
+    NP_ASSERT_STR_EQUAL(p, "clean");
+    free(p);
+}
+
+static void test_timeout(void)
+{
+    /* the runner is known in the fork server too */
+    NP_ASSERT_NOT_EQUAL(np_get_timeout(), 0);
+}
+
+/*
+ * Run the tests matching @a nspec specs in a fresh runner in a
+ * child process, so each run's failures are counted separately,
+ * and return the runner's exit code.  With @a quiet the results
+ * are hidden from the test harness, which would otherwise expect
+ * the whole test to fail.
+ */
+static int run(int nspec, const char **specs, int quiet)
+{
+    pid_t pid;
+    int status;
+
+    fflush(stdout);
+    pid = fork();
+    if(pid < 0)
+    {
+        perror("fork");
+        exit(1);
+    }
+    if(pid == 0)
+    {
+        np_runner_t *runner;
+        np_plan_t *plan;
+        int ec;
+
+        if(quiet)
+        {
+            int fd = open("/dev/null", O_WRONLY);
+            dup2(fd, 1);
+            dup2(fd, 2);
+            close(fd);
+        }
+        runner = np_init();
+        np_set_concurrency(runner, 2);
+        plan = np_plan_new();
+        if(!np_plan_add_specs(plan, nspec, specs))
+        {
+            fprintf(stderr, "tnvgchildren: bad test specification\n");
+            exit(2);
+        }
+        ec = np_run_tests(runner, plan);
+        np_plan_delete(plan);
+        np_done(runner);
+        exit(ec);
+    }
+    if(waitpid(pid, &status, 0) < 0)
+    {
+        perror("waitpid");
+        exit(1);
+    }
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+int main(int argc, char **argv)
+{
+    static const char *passing[] = {
+        "tests.tnvgchildren",
+        "tests.tnvgchildren_native",
+        "tests.tnvgchildren_noleak"
+    };
+    static const char *failing[] = {
+        "tests.tnvgchildren_fail.fail",
+        "tests.tnvgchildren_fail.leak",
+        "tests.tnvgchildren_fail.syslog"
+    };
+    unsigned int i;
+    int ec = 0;
+
+#if HAVE_VALGRIND
+    if(access(VALGRIND_BINARY, X_OK) < 0)
+#endif
+    {
+        printf("MSG Valgrind not available, skipping\n");
+        return 0;
+    }
+
+    setenv("NOVAPROVA_VALGRIND", "children", 1);
+    if(run(sizeof(passing)/sizeof(passing[0]), passing, 0) != 0)
+        ec = 1;
+    for(i = 0 ; i < sizeof(failing)/sizeof(failing[0]) ; i++)
+    {
+        if(run(1, &failing[i], 1) != 1)
+        {
+            printf("MSG %s didn't fail\n", failing[i]);
+            ec = 1;
+        }
+    }
+    return ec;
+}
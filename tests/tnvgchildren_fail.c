@@ -0,0 +1,37 @@
+/*
+ * Copyright 2011-2012 Gregory Banks
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <np.h>
+#include <stdlib.h>
+#include <syslog.h>
+
+/* linked into tnvgchildren; each of these tests must fail */
+
+static void test_fail(void)
+{
+    NP_FAIL;
+}
+
+static void test_leak(void)
+{
+    /* the default memcheck reports this as a failure */
+    malloc(32);
+}
+
+static void test_syslog(void)
+{
+    /* an unexpected message is raised as a failure */
+    syslog(LOG_ERR, "fnarp");
+}
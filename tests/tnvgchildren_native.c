@@ -0,0 +1,30 @@
+/*
+ * Copyright 2011-2012 Gregory Banks
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <np.h>
+#include <np/util/config.h>
+#if HAVE_VALGRIND
+#include <valgrind/valgrind.h>
+#endif
+
+/* linked into tnvgchildren; these tests are run natively */
+NP_VALGRIND("no", 1);
+
+static void test_native(void)
+{
+#if HAVE_VALGRIND
+    NP_ASSERT_FALSE(RUNNING_ON_VALGRIND);
+#endif
+}
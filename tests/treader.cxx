@@ -15,14 +15,148 @@
  */
 #include "np/spiegel/spiegel.hxx"
 #include "np/spiegel/dwarf/state.hxx"
+#include "np/spiegel/dwarf/entry.hxx"
+#include "np/spiegel/elf.hxx"
 #include "fw.h"
+#include <fcntl.h>
+#include <time.h>
 
 using namespace std;
 using namespace np::util;
 
-int main(int argc __attribute__((unused)),
-         char **argv __attribute__((unused)))
+static void
+append_uleb128(string &buf, uint32_t v)
 {
+    do
+    {
+        unsigned char c = v & 0x7f;
+        v >>= 7;
+        if(v)
+        {
+            c |= 0x80;
+        }
+        buf += (char)c;
+    } while(v);
+}
+
+static double
+now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ * Compares the bytewise and bulk LEB128 decoders on the
+ * .debug_abbrev section of a real object, which is nearly all
+ * LEB128 values and mostly short ones.
+ */
+static int
+bench(const char *filename)
+{
+    vector<np::spiegel::elf_section_t> sections;
+    if(!np::spiegel::read_elf_sections(filename, sections))
+    {
+        return 1;
+    }
+    string data;
+    vector<np::spiegel::elf_section_t>::iterator i;
+    for(i = sections.begin() ; i != sections.end() ; ++i)
+    {
+        if(i->name_ == ".debug_abbrev" && !i->compressed_)
+        {
+            int fd = open(filename, O_RDONLY);
+            data.resize(i->size_);
+            if(fd < 0 || pread(fd, &data[0], i->size_, i->offset_) != (ssize_t)i->size_)
+            {
+                perror(filename);
+                return 1;
+            }
+            close(fd);
+        }
+    }
+    if(!data.length())
+    {
+        fprintf(stderr, "%s: no .debug_abbrev section\n", filename);
+        return 1;
+    }
+
+    enum { REPEATS = 2000, CHUNK = 16 };
+    unsigned long n1 = 0, n2 = 0, sum1 = 0, sum2 = 0;
+    double t0 = now();
+    for(int rep = 0 ; rep < REPEATS ; rep++)
+    {
+        np::spiegel::dwarf::reader_t r(data.data(), data.length());
+        while(r.skip_uleb128())
+        {
+            n1++;
+        }
+    }
+    double t1 = now();
+    for(int rep = 0 ; rep < REPEATS ; rep++)
+    {
+        np::spiegel::dwarf::reader_t r(data.data(), data.length());
+        while(r.skip_leb128s(CHUNK))
+        {
+            n2 += CHUNK;
+        }
+        while(r.skip_uleb128())
+        {
+            n2++;
+        }
+    }
+    double t2 = now();
+    for(int rep = 0 ; rep < REPEATS ; rep++)
+    {
+        np::spiegel::dwarf::reader_t r(data.data(), data.length());
+        uint32_t v;
+        while(r.read_uleb128(v))
+        {
+            sum1 += v;
+        }
+    }
+    double t3 = now();
+    for(int rep = 0 ; rep < REPEATS ; rep++)
+    {
+        np::spiegel::dwarf::reader_t r(data.data(), data.length());
+        uint32_t v[CHUNK];
+        while(r.read_uleb128s(v, CHUNK))
+        {
+            for(int j = 0 ; j < CHUNK ; j++)
+            {
+                sum2 += v[j];
+            }
+        }
+        while(r.read_uleb128(v[0]))
+        {
+            sum2 += v[0];
+        }
+    }
+    double t4 = now();
+
+    if(n1 != n2 || sum1 != sum2)
+    {
+        fprintf(stderr, "bulk and bytewise decoders disagree\n");
+        return 1;
+    }
+    n1 /= REPEATS;
+    printf("%lu LEB128 values in %lu bytes, %d passes\n",
+           n1, (unsigned long)data.length(), REPEATS);
+    printf("skip bytewise %.2f ns/value, bulk %.2f ns/value\n",
+           (t1 - t0) * 1e9 / (n1 * REPEATS), (t2 - t1) * 1e9 / (n1 * REPEATS));
+    printf("read bytewise %.2f ns/value, bulk %.2f ns/value\n",
+           (t3 - t2) * 1e9 / (n1 * REPEATS), (t4 - t3) * 1e9 / (n1 * REPEATS));
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if(argc == 3 && !strcmp(argv[1], "--bench"))
+    {
+        return bench(argv[2]);
+    }
+
 #define TESTCASE(in, out) \
     { \
         BEGIN("read_sleb128(%d)", out); \
@@ -60,5 +194,86 @@ int main(int argc __attribute__((unused)),
     TESTCASE("\xb9\x64", 12857);
 
 #undef TESTCASE
+
+    /* enough values of mixed lengths to span several vector windows */
+    string buf;
+    vector<uint32_t> values;
+    vector<size_t> ends;
+    for(uint32_t i = 0 ; i < 100 ; i++)
+    {
+        uint32_t v = (i % 7 == 3 ? i * 40503 : i % 5 == 1 ? i * 129 : i);
+        append_uleb128(buf, v);
+        values.push_back(v);
+        ends.push_back(buf.length());
+    }
+
+    static const unsigned counts[] = { 1, 2, 15, 16, 17, 33, 99, 100 };
+    for(unsigned i = 0 ; i < sizeof(counts)/sizeof(counts[0]) ; i++)
+    {
+        unsigned n = counts[i];
+
+        BEGIN("skip_leb128s(%u)", n);
+        np::spiegel::dwarf::reader_t r(buf.data(), buf.length());
+        CHECK(r.skip_uleb128());
+        CHECK(r.skip_leb128s(n - 1));
+        CHECK(r.get_offset() == ends[n-1]);
+        END;
+
+        BEGIN("read_uleb128s(%u)", n);
+        np::spiegel::dwarf::reader_t r(buf.data(), buf.length());
+        vector<uint32_t> v(n + 1, 0xdeadbeef);
+        CHECK(r.read_uleb128s(&v[0], n));
+        CHECK(r.get_offset() == ends[n-1]);
+        for(unsigned j = 0 ; j < n ; j++)
+        {
+            CHECK(v[j] == values[j]);
+        }
+        CHECK(v[n] == 0xdeadbeef);
+        END;
+    }
+
+    BEGIN("skip_leb128s past the end");
+    np::spiegel::dwarf::reader_t r(buf.data(), buf.length());
+    CHECK(!r.skip_leb128s(101));
+    CHECK(r.get_offset() == 0);
+    END;
+
+    BEGIN("read_uleb128s past the end");
+    np::spiegel::dwarf::reader_t r(buf.data(), buf.length() - 1);
+    vector<uint32_t> v(100);
+    CHECK(!r.read_uleb128s(&v[0], 100));
+    CHECK(r.get_offset() == 0);
+    END;
+
+    /* an abbrev with more attributes than an entry keeps inline */
+    np::spiegel::dwarf::abbrev_t a(1);
+    for(uint32_t i = 0 ; i < 40 ; i++)
+    {
+        np::spiegel::dwarf::abbrev_t::attr_spec_t spec;
+        spec.name = DW_AT_lo_user + i;
+        spec.form = DW_FORM_data4;
+        spec.decode = 0;
+        a.attr_specs.push_back(spec);
+    }
+
+    BEGIN("entry with %u attributes", (unsigned)a.attr_specs.size());
+    np::spiegel::dwarf::entry_t e;
+    e.setup(0, 0, &a);
+    for(uint32_t i = 0 ; i < a.attr_specs.size() ; i++)
+    {
+        e.add_attribute(np::spiegel::dwarf::value_t::make_uint32(1000 + i));
+    }
+    np::spiegel::dwarf::entry_t e2 = e;
+    for(uint32_t i = 0 ; i < a.attr_specs.size() ; i++)
+    {
+        CHECK(e.get_uint32_attribute(DW_AT_lo_user + i) == 1000 + i);
+        CHECK(e2.get_uint32_attribute(DW_AT_lo_user + i) == 1000 + i);
+    }
+    CHECK(!e.get_attribute(DW_AT_lo_user + a.attr_specs.size()));
+    e.setup(0, 0, &a);
+    CHECK(!e.get_attribute(DW_AT_lo_user));
+    CHECK(!e.get_attribute(DW_AT_lo_user + a.attr_specs.size() - 1));
+    END;
+
     return 0;
 }
@@ -0,0 +1,129 @@
+#!/usr/bin/perl
+#
+# Copyright 2011-2012 Gregory Banks
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+# Merge several reports/ directories written by the junit output
+# format, e.g. by running each shard of a test executable with
+# --shard=i/n on a different machine, into one reports/ directory
+# which looks like it came from a single run.  Only understands the
+# XML which NovaProva itself writes.
+#
+
+use strict;
+use warnings;
+use Getopt::Long;
+
+sub usage
+{
+    print STDERR "Usage: $0 [--output dir] reports-dir...\n";
+    exit 1;
+}
+
+my $outdir = 'reports';
+GetOptions('output|o=s' => \$outdir) or usage;
+usage unless scalar(@ARGV);
+
+my %suites;
+my @suitenames;
+
+sub parse_attrs
+{
+    my ($s) = @_;
+    my %attrs;
+    while ($s =~ m/([a-zA-Z_:][-a-zA-Z0-9_:.]*)="([^"]*)"/g)
+    {
+	$attrs{$1} = $2;
+    }
+    return \%attrs;
+}
+
+sub read_report
+{
+    my ($filename) = @_;
+
+    open XML, '<', $filename
+	or die "Cannot open $filename for reading: $!";
+    my $xml = do { local $/; <XML> };
+    close XML;
+
+    my ($attrstr, $body) = ($xml =~ m/<testsuite\b([^>]*)>(.*)<\/testsuite>/s)
+	or die "$filename: not a JUnit XML report";
+    my $attrs = parse_attrs($attrstr);
+    my $name = $attrs->{name};
+
+    my $suite = $suites{$name};
+    if (!defined $suite)
+    {
+	$suite = {
+	    hostname => $attrs->{hostname},
+	    timestamp => $attrs->{timestamp},
+	    tests => 0,
+	    failures => 0,
+	    errors => 0,
+	    time => 0,
+	    cases => {},
+	    stdout => '',
+	    stderr => '',
+	};
+	$suites{$name} = $suite;
+	push(@suitenames, $name);
+    }
+    # ISO 8601 timestamps sort as strings
+    $suite->{timestamp} = $attrs->{timestamp}
+	if ($attrs->{timestamp} lt $suite->{timestamp});
+    $suite->{$_} += ($attrs->{$_} || 0) for (qw(tests failures errors time));
+
+    while ($body =~ m/(<testcase\b([^>]*?)(?:\/>|>.*?<\/testcase>))/gs)
+    {
+	my ($case, $cattrs) = ($1, parse_attrs($2));
+	die "$filename: test $cattrs->{name} is in more than one report"
+	    if defined $suite->{cases}->{$cattrs->{name}};
+	$suite->{cases}->{$cattrs->{name}} = $case;
+    }
+    $suite->{stdout} .= $1 if ($body =~ m/<system-out>(.*?)<\/system-out>/s);
+    $suite->{stderr} .= $1 if ($body =~ m/<system-err>(.*?)<\/system-err>/s);
+}
+
+foreach my $dir (@ARGV)
+{
+    opendir DIR, $dir
+	or die "Cannot open directory $dir: $!";
+    my @files = sort grep { m/^TEST-.*\.xml$/ } readdir DIR;
+    closedir DIR;
+    read_report("$dir/$_") for (@files);
+}
+
+mkdir $outdir unless -d $outdir;
+foreach my $name (@suitenames)
+{
+    my $suite = $suites{$name};
+    my $filename = "$outdir/TEST-$name.xml";
+
+    open XML, '>', $filename
+	or die "Cannot open $filename for writing: $!";
+    print XML "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
+    printf XML "<testsuite name=\"%s\" failures=\"%d\" tests=\"%d\" " .
+	       "hostname=\"%s\" timestamp=\"%s\" errors=\"%d\" time=\"%.3f\">",
+	       $name, $suite->{failures}, $suite->{tests},
+	       $suite->{hostname}, $suite->{timestamp},
+	       $suite->{errors}, $suite->{time};
+    print XML "<properties/>";
+    # the junit output format writes testcases sorted by name
+    print XML $suite->{cases}->{$_} for (sort keys %{$suite->{cases}});
+    print XML "<system-out>$suite->{stdout}</system-out>";
+    print XML "<system-err>$suite->{stderr}</system-err>";
+    print XML "</testsuite>\n";
+    close XML;
+}